@@ -0,0 +1,409 @@
+// Batch simulator: plays games with first-playable bots (BOT_FIRST) 16 at a
+// time, one game per byte lane of a GCC vector. Every game of a batch keeps its
+// hands, pile top, direction and turn in parallel arrays (struct of arrays),
+// and all of them take their turn together: the playable test of
+// playable_card(), the bot's pick, taking the card out of the hand and the
+// effects of execute_card_effect() work on all 16 lanes at once, masked by
+// which games are still running. Only drawing from a lane's own deck is done
+// lane by lane. A lane whose game ends is dealt the next game straight away.
+//
+//   ./batchsim -n 1000000 -p 4 -w 8     (a million 4-player games on 8 threads)
+//   ./batchsim -n 100000 -c 10000       (and replay 10000 of them on server.c)
+//
+// Game g is dealt from seed -s + g exactly as play_game() in tournament.c
+// would deal it, so -c can check every winner and turn count against the
+// scalar rules in server.c.
+
+#define ONO_NO_MAIN
+#include "server.c"
+
+#define BATCH_LANES 16
+#define BATCH_MAX_SEATS PLAYERS_PER_DECK  // one deck between them, as deck_count() gives
+#define BATCH_HAND_CAP 128                // a game with a bigger hand is dropped
+#define BATCH_MAX_TURNS 2000              // as MAX_GAME_TURNS in tournament.c
+#define BATCH_CAPPED (-1)                 // results: no winner within the turn cap
+#define BATCH_OVERFLOW (-2)               // a hand outgrew BATCH_HAND_CAP
+
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+
+// One game per lane; cards are bytes, colour << 4 | value as in history.h
+typedef struct {
+    v16u8 hand[BATCH_MAX_SEATS][BATCH_HAND_CAP]; // [seat][slot], in hand_cards order
+    v16u8 hand_size[BATCH_MAX_SEATS];
+    v16u8 colours[BATCH_MAX_SEATS][4];  // coloured cards held, the bots' wild colour pick
+    v16u8 top;                          // top of the pile
+    v16u8 current;
+    v16u8 next;
+    v16u8 reversed;                     // 0xff while play goes anti-clockwise
+    v16u8 live;                         // 0xff while the lane has a game running
+    int num_players;
+    uint16_t turns[BATCH_LANES];
+    long game[BATCH_LANES];             // game number in the lane
+    int deck_top[BATCH_LANES];
+    unsigned int seed[BATCH_LANES];     // rand_r() state of the lane's deck
+    uint8_t deck[BATCH_LANES][DECK_SIZE];
+} Batch;
+
+typedef struct {
+    int8_t winner;                      // seat, BATCH_CAPPED or BATCH_OVERFLOW
+    uint16_t turns;
+} BatchResult;
+
+typedef struct {
+    pthread_t tid;
+    Batch *batch;
+    unsigned long turns;
+    unsigned long steps;                // lockstep turns, each for 16 lanes
+    unsigned long games;
+    unsigned long wins[BATCH_MAX_SEATS];
+    unsigned long capped, overflowed;
+} BatchWorker;
+
+static uint8_t base_deck[DECK_SIZE];    // deckInit()'s unshuffled order
+static int num_players = 4;
+static long num_games = 100000;
+static unsigned int base_seed = 1;
+static atomic_long next_game;
+static BatchResult *results;            // kept for the games -c checks
+static long checked_games = 0;
+
+static inline v16u8 splat(uint8_t x) {
+    return (v16u8){0} + x;
+}
+
+// Lanes of `a` where the mask is set, of `b` elsewhere
+static inline v16u8 select_lanes(v16u8 mask, v16u8 a, v16u8 b) {
+    return (a & mask) | (b & ~mask);
+}
+
+// seat_step() with every seat still at the table
+static inline v16u8 batch_seat_step(v16u8 seat, v16u8 reversed, int n) {
+    v16u8 forward = select_lanes((v16u8)(seat == splat(n - 1)), splat(0), seat + 1);
+    v16u8 back = select_lanes((v16u8)(seat == splat(0)), splat(n - 1), seat - 1);
+    return select_lanes(reversed, back, forward);
+}
+
+static inline unsigned lane_bits(v16u8 mask) {
+    unsigned bits = 0;
+    for (int l = 0; l < BATCH_LANES; l++) bits |= (mask[l] & 1u) << l;
+    return bits;
+}
+
+// deckShuffle() on the lane's deck, the same swaps for the same seed
+static void lane_shuffle(uint8_t *deck, unsigned int *seed) {
+    for (int i = DECK_SIZE - 1; i > 0; i--) {
+        int j = rand_r(seed) % (i + 1);
+        uint8_t tmp = deck[i];
+        deck[i] = deck[j];
+        deck[j] = tmp;
+    }
+}
+
+// Deal `count` cards to a seat as deckDraw() and player_add_card() would, false if the hand is full
+static bool lane_give(Batch *b, int l, int seat, int count) {
+    for (int i = 0; i < count; i++) {
+        int size = b->hand_size[seat][l];
+        if (size == BATCH_HAND_CAP) return false;
+        if (b->deck_top[l] >= DECK_SIZE) {
+            b->deck_top[l] = 0;
+            lane_shuffle(b->deck[l], &b->seed[l]);
+        }
+
+        uint8_t card = b->deck[l][b->deck_top[l]++];
+        b->hand[seat][size][l] = card;
+        b->hand_size[seat][l] = size + 1;
+        if ((card >> 4) < 4) b->colours[seat][card >> 4][l]++;
+    }
+    return true;
+}
+
+static unsigned int game_seed(long game) {
+    unsigned int seed = base_seed + (unsigned int)game;
+    return seed ? seed : 1; // deckInit() would pick its own for 0
+}
+
+// Start game `game` in lane l, as game_deal() starts a memset() GameState
+static void lane_deal(Batch *b, int l, long game) {
+    for (int p = 0; p < b->num_players; p++) {
+        b->hand_size[p][l] = 0;
+        for (int c = 0; c < 4; c++) b->colours[p][c][l] = 0;
+    }
+    memcpy(b->deck[l], base_deck, DECK_SIZE);
+    b->seed[l] = game_seed(game);
+    b->deck_top[l] = 0;
+    lane_shuffle(b->deck[l], &b->seed[l]);
+    for (int p = 0; p < b->num_players; p++) lane_give(b, l, p, START_CARD_DECK);
+
+    b->top[l] = 0; // the zeroed pile: a red 0
+    b->current[l] = 0;
+    b->next[l] = 1;
+    b->reversed[l] = 0;
+    b->live[l] = 0xff;
+    b->turns[l] = 0;
+    b->game[l] = game;
+}
+
+// One turn in every live lane, returns the lanes whose game ended in `winner`
+static unsigned batch_step(Batch *b, int8_t winner[BATCH_LANES]) {
+    int n = b->num_players;
+    v16u8 live = b->live;
+    v16u8 at[BATCH_MAX_SEATS];          // lanes where seat p is to play
+    v16u8 size = splat(0);
+    v16u8 colours[4] = { splat(0), splat(0), splat(0), splat(0) };
+
+    for (int p = 0; p < n; p++) {
+        at[p] = (v16u8)(b->current == splat(p));
+        size |= b->hand_size[p] & at[p];
+        for (int c = 0; c < 4; c++) colours[c] |= b->colours[p][c] & at[p];
+    }
+    int longest = 0;
+    for (int l = 0; l < BATCH_LANES; l++) {
+        if (live[l] && size[l] > longest) longest = size[l];
+    }
+
+    // the bot's pick: the first card playable_card() allows, and the last card
+    // of the hand, which player_remove_card() moves into its place
+    v16u8 top_colour = b->top >> 4;
+    v16u8 top_value = b->top & 15;
+    v16u8 any_colour = (v16u8)(top_colour == splat(CARD_COLOUR_BLACK));
+    v16u8 found = splat(0), pick = splat(0), card = splat(0), last = splat(0);
+
+    for (int s = 0; s < longest; s++) {
+        v16u8 c = splat(0);
+        for (int p = 0; p < n; p++) c |= b->hand[p][s] & at[p];
+
+        v16u8 colour = c >> 4;
+        v16u8 playable = (v16u8)((c & 15) == top_value) | (v16u8)(colour == top_colour) |
+            (v16u8)(colour == splat(CARD_COLOUR_BLACK)) | any_colour;
+        v16u8 first = playable & (v16u8)(splat(s) < size) & ~found;
+        pick = select_lanes(first, splat(s), pick);
+        card = select_lanes(first, c, card);
+        found |= first;
+        last = select_lanes((v16u8)(splat(s) == size - 1), c, last);
+    }
+    v16u8 play = live & found;
+    v16u8 draw = live & ~found;
+
+    // the wild colour is the colour held most, or red with two cards left
+    // (the bot's second number is then the uno declaration)
+    v16u8 best = splat(0), best_count = colours[0];
+    for (int c = 1; c < 4; c++) {
+        v16u8 more = (v16u8)(colours[c] > best_count);
+        best = select_lanes(more, splat(c), best);
+        best_count = select_lanes(more, colours[c], best_count);
+    }
+    best = select_lanes((v16u8)(size == splat(2)), splat(CARD_COLOUR_RED), best);
+
+    // player_remove_card()
+    v16u8 value = card & 15;
+    v16u8 colour = card >> 4;
+    for (int p = 0; p < n; p++) {
+        v16u8 mine = play & at[p];
+        for (int s = 0; s < longest; s++)
+            b->hand[p][s] = select_lanes(mine & (v16u8)(pick == splat(s)), last, b->hand[p][s]);
+        b->hand_size[p] -= mine & 1;
+        for (int c = 0; c < 4; c++) b->colours[p][c] -= mine & (v16u8)(colour == splat(c)) & 1;
+    }
+    v16u8 wild = (v16u8)(value >= splat(CARD_VALUE_WILD));
+    b->top = select_lanes(play, select_lanes(wild, (best << 4) | value, card), b->top);
+
+    // check_for_winner(); declaring uno with two cards means check_for_uno() never deals a penalty
+    v16u8 won = play & (v16u8)(size == splat(1));
+    v16u8 on = play & ~won;
+
+    // execute_card_effect(): a skip passes over the next seat, a reverse turns
+    // play round, draw two and wild draw four deal to the next seat (who still plays)
+    v16u8 skip = on & (v16u8)(value == splat(CARD_VALUE_SKIP));
+    v16u8 reverse = on & (v16u8)(value == splat(CARD_VALUE_REVERSE));
+    v16u8 deal = (on & (v16u8)(value == splat(CARD_VALUE_DRAW_TWO)) & 2) |
+        (on & (v16u8)(value == splat(CARD_VALUE_WILD_DRAW_FOUR)) & 4);
+    b->next = select_lanes(skip, batch_seat_step(b->next, b->reversed, n), b->next);
+    b->reversed ^= reverse;
+    b->next = select_lanes(reverse, batch_seat_step(b->current, b->reversed, n), b->next);
+
+    unsigned ended = lane_bits(won);
+    unsigned dealing = lane_bits(draw | (v16u8)(deal != splat(0)));
+    for (int l = 0; l < BATCH_LANES; l++) {
+        if (won[l]) winner[l] = b->current[l];
+        if (!(dealing >> l & 1)) continue;
+
+        bool fits = draw[l] ? lane_give(b, l, b->current[l], 1) : lane_give(b, l, b->next[l], deal[l]);
+        if (!fits) {
+            winner[l] = BATCH_OVERFLOW;
+            ended |= 1u << l;
+        }
+    }
+
+    // decide_next_player()
+    v16u8 going = live & ~won;
+    b->current = select_lanes(going, b->next, b->current);
+    b->next = select_lanes(going, batch_seat_step(b->current, b->reversed, n), b->next);
+
+    for (int l = 0; l < BATCH_LANES; l++) {
+        if (live[l] && ++b->turns[l] == BATCH_MAX_TURNS && !(ended >> l & 1)) {
+            winner[l] = BATCH_CAPPED;
+            ended |= 1u << l;
+        }
+        if (ended >> l & 1) b->live[l] = 0;
+    }
+    return ended;
+}
+
+void *batch_worker_func(void *arg) {
+    BatchWorker *w = (BatchWorker *)arg;
+    Batch *b = w->batch;
+    int8_t winner[BATCH_LANES];
+
+    b->num_players = num_players;
+    b->live = splat(0);
+    for (int l = 0; l < BATCH_LANES; l++) {
+        long game = atomic_fetch_add(&next_game, 1);
+        if (game < num_games) lane_deal(b, l, game);
+    }
+
+    while (lane_bits(b->live) != 0) {
+        w->steps++;
+        w->turns += __builtin_popcount(lane_bits(b->live));
+        unsigned ended = batch_step(b, winner);
+
+        for (int l = 0; ended; l++, ended >>= 1) {
+            if (!(ended & 1)) continue;
+            w->games++;
+            if (winner[l] >= 0) w->wins[winner[l]]++;
+            else if (winner[l] == BATCH_CAPPED) w->capped++;
+            else w->overflowed++;
+            if (b->game[l] < checked_games) results[b->game[l]] = (BatchResult){ winner[l], b->turns[l] };
+
+            long game = atomic_fetch_add(&next_game, 1);
+            if (game < num_games) lane_deal(b, l, game);
+        }
+    }
+    return NULL;
+}
+
+// Game `game` on the scalar rules, as play_game() plays it with BOT_FIRST on every seat
+static BatchResult scalar_game(GameState *game, long number, unsigned long *turns_total) {
+    unsigned int bot_seed = 0;
+    int turns = 0;
+
+    memset(game, 0, sizeof(*game));
+    game->quiet = 1;
+    game->num_players = num_players;
+    game->deck.seed = game_seed(number);
+    for (int i = 0; i < num_players; i++) game->players[i].pid = i + 1;
+    game_deal(game, deck_count(num_players));
+
+    while (!game->game_over && turns < BATCH_MAX_TURNS) {
+        bot_choose_move(game, game->current_player, BOT_FIRST, &bot_seed, game->stored_move, sizeof(game->stored_move));
+        game_apply_move(game, game->current_player);
+        turns++;
+    }
+    *turns_total += turns;
+
+    BatchResult r = { game->game_over ? game->winner_pid - 1 : BATCH_CAPPED, turns };
+    game_free(game);
+    return r;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int num_workers = cores;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:w:s:c:")) != -1) {
+        switch (opt) {
+        case 'n': num_games = atol(optarg); break;
+        case 'p': num_players = atoi(optarg); break;
+        case 'w': num_workers = atoi(optarg); break;
+        case 's': base_seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 'c': checked_games = atol(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-n games] [-p players 2-%d] [-w workers] [-s seed] [-c games to check]\n",
+                argv[0], BATCH_MAX_SEATS);
+            return 1;
+        }
+    }
+    if (num_players < 2 || num_players > BATCH_MAX_SEATS) {
+        fprintf(stderr, "batchsim: 2 to %d players per game\n", BATCH_MAX_SEATS);
+        return 1;
+    }
+    if (num_workers < 1) num_workers = 1;
+    if (cores < 1 || cores > num_workers) cores = num_workers;
+    if (checked_games > num_games) checked_games = num_games;
+
+    Deck deck = {0};
+    deck.seed = 1;
+    deckInit(&deck, 1);
+    for (int i = 0; i < DECK_SIZE; i++) base_deck[i] = history_card_byte(deck.deckCards[i].colour, deck.deckCards[i].value);
+    deckFree(&deck);
+
+    results = calloc(checked_games > 0 ? checked_games : 1, sizeof(BatchResult));
+    BatchWorker *workers = calloc(num_workers, sizeof(BatchWorker));
+    for (int i = 0; i < num_workers; i++) {
+        if (posix_memalign((void **)&workers[i].batch, 64, sizeof(Batch)) != 0) {
+            perror("batchsim: batch");
+            return 1;
+        }
+    }
+
+    double start = now_s();
+    for (int i = 0; i < num_workers; i++) pthread_create(&workers[i].tid, NULL, batch_worker_func, &workers[i]);
+    for (int i = 0; i < num_workers; i++) pthread_join(workers[i].tid, NULL);
+    double elapsed = now_s() - start;
+
+    BatchWorker total = {0};
+    for (int i = 0; i < num_workers; i++) {
+        total.turns += workers[i].turns;
+        total.steps += workers[i].steps;
+        total.games += workers[i].games;
+        total.capped += workers[i].capped;
+        total.overflowed += workers[i].overflowed;
+        for (int p = 0; p < num_players; p++) total.wins[p] += workers[i].wins[p];
+    }
+
+    printf("%lu games of %d players, %d lanes on %d worker(s), seed %u\n", total.games, num_players, BATCH_LANES,
+        num_workers, base_seed);
+    printf("  %lu turns in %.2f s: %.1f M turns/s, %.1f M turns/s per core, lanes %.0f%% busy\n", total.turns,
+        elapsed, total.turns / elapsed / 1e6, total.turns / elapsed / 1e6 / cores,
+        total.steps ? 100.0 * total.turns / (total.steps * BATCH_LANES) : 0);
+    printf("  %.1f turns per game, %lu hit the %d-turn cap, %lu dropped for a hand over %d cards\n",
+        total.games ? (double)total.turns / total.games : 0, total.capped, BATCH_MAX_TURNS, total.overflowed,
+        BATCH_HAND_CAP);
+    printf("  wins by seat:");
+    for (int p = 0; p < num_players; p++) printf(" %.1f%%", total.games ? 100.0 * total.wins[p] / total.games : 0);
+    printf("\n");
+
+    int status = 0;
+    if (checked_games > 0) {
+        GameState *game = malloc(sizeof(GameState));
+        unsigned long turns = 0;
+        long mismatched = 0, skipped = 0;
+
+        start = now_s();
+        for (long g = 0; g < checked_games; g++) {
+            BatchResult r = scalar_game(game, g, &turns);
+            if (results[g].winner == BATCH_OVERFLOW) {
+                skipped++;
+            } else if (r.winner != results[g].winner || r.turns != results[g].turns) {
+                if (mismatched++ < 5) printf("  game %ld: scalar seat %d after %d turns, batch seat %d after %d\n",
+                    g, r.winner, r.turns, results[g].winner, results[g].turns);
+            }
+        }
+        elapsed = now_s() - start;
+        printf("  scalar check: %ld of %ld games differ (%ld skipped), scalar engine %.1f M turns/s\n",
+            mismatched, checked_games, skipped, turns / elapsed / 1e6);
+        free(game);
+        if (mismatched > 0) status = 2;
+    }
+
+    for (int i = 0; i < num_workers; i++) free(workers[i].batch);
+    free(workers);
+    free(results);
+    return status;
+}
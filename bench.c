@@ -0,0 +1,506 @@
+// Benchmarks for the hot paths of the server, from single rule functions up
+// to a full turn going through the reactor. Every benchmark runs a few warmup
+// repetitions, then the measured ones, and reports nanoseconds per operation.
+//
+//   ./bench -o bench.json                  (save results)
+//   ./bench -c bench_baseline.json         (flag regressions against a baseline)
+//
+// Results go to stdout as JSON unless -o is given, the summary goes to stderr.
+
+#define ONO_NO_MAIN
+#include "server.c"
+
+#define MAX_BENCHMARKS 16
+#define MAX_REPETITIONS 100
+#define HANDOFF_SEATS 4
+
+typedef double (*BenchFunc)(long iterations); // returns elapsed ns
+
+typedef struct {
+    const char *name;
+    BenchFunc run;
+    long iterations;
+    double min, median, mean, max; // ns per operation
+    int done;
+} Benchmark;
+
+volatile unsigned long bench_sink; // keeps results alive under -O2
+
+static double elapsed_ns(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec);
+}
+
+static void bench_deck(Deck *deck) {
+    memset(deck, 0, sizeof(*deck));
+    deck->seed = 12345;
+    deckInit(deck, 1);
+    deckShuffle(deck);
+}
+
+double bench_deck_shuffle(long iterations) {
+    Deck deck;
+    struct timespec start;
+
+    bench_deck(&deck);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        deckShuffle(&deck);
+    }
+    double ns = elapsed_ns(&start);
+
+    bench_sink += deck.deckCards[0].value;
+    deckFree(&deck);
+    return ns;
+}
+
+double bench_deck_draw(long iterations) {
+    Deck deck;
+    struct timespec start;
+    unsigned long sum = 0;
+
+    bench_deck(&deck);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        sum += deckDraw(&deck).value; // reshuffles every DECK_SIZE draws, like a long game
+    }
+    double ns = elapsed_ns(&start);
+
+    bench_sink += sum;
+    deckFree(&deck);
+    return ns;
+}
+
+double bench_playable_card(long iterations) {
+    Deck deck;
+    struct timespec start;
+    unsigned long sum = 0;
+
+    bench_deck(&deck);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        Card *card = &deck.deckCards[i % DECK_SIZE];
+        Card *top = &deck.deckCards[(i * 7 + 3) % DECK_SIZE];
+        sum += playable_card(card, top);
+    }
+    double ns = elapsed_ns(&start);
+
+    bench_sink += sum;
+    deckFree(&deck);
+    return ns;
+}
+
+// "can this hand play on that card", the way it was done before HandIndex
+double bench_hand_playable_scan(long iterations) {
+    Deck deck;
+    Player *P = calloc(1, sizeof(Player));
+    struct timespec start;
+    unsigned long sum = 0;
+
+    bench_deck(&deck);
+    for (int c = 0; c < 12; c++) player_add_card(P, deckDraw(&deck));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        Card *top = &deck.deckCards[i % DECK_SIZE];
+        bool any = false;
+        for (int c = 0; c < P->hand_size && !any; c++) any = playable_card(&P->hand_cards[c], top);
+        sum += any;
+    }
+    double ns = elapsed_ns(&start);
+
+    bench_sink += sum;
+    free(P->hand_cards);
+    free(P);
+    deckFree(&deck);
+    return ns;
+}
+
+double bench_hand_has_playable(long iterations) {
+    Deck deck;
+    Player *P = calloc(1, sizeof(Player));
+    struct timespec start;
+    unsigned long sum = 0;
+
+    bench_deck(&deck);
+    for (int c = 0; c < 12; c++) player_add_card(P, deckDraw(&deck));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        sum += hand_has_playable(&P->hand_index, &deck.deckCards[i % DECK_SIZE]);
+    }
+    double ns = elapsed_ns(&start);
+
+    bench_sink += sum;
+    free(P->hand_cards);
+    free(P);
+    deckFree(&deck);
+    return ns;
+}
+
+double bench_format_card(long iterations) {
+    Deck deck;
+    struct timespec start;
+    char buffer[50];
+    unsigned long sum = 0;
+
+    bench_deck(&deck);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        format_card_to_string(&deck.deckCards[i % DECK_SIZE], buffer);
+        sum += (unsigned char)buffer[0];
+    }
+    double ns = elapsed_ns(&start);
+
+    bench_sink += sum;
+    deckFree(&deck);
+    return ns;
+}
+
+// PILE/HAND frame for a 12 card hand, queued on an outbox that writes to /dev/null
+double bench_update_player_client(long iterations) {
+    GameState *game = calloc(1, sizeof(GameState));
+    Outbox *ob = malloc(sizeof(Outbox));
+    struct timespec start;
+    int fd = open("/dev/null", O_WRONLY);
+
+    bench_deck(&game->deck);
+    game->num_players = 2;
+    for (int c = 0; c < 12; c++) player_add_card(&game->players[0], deckDraw(&game->deck));
+    game->played_cards[0] = deckDraw(&game->deck);
+    game_publish(game);
+    outbox_init(ob, 0, fd);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        update_player_client(game, 0, ob);
+    }
+    double ns = elapsed_ns(&start);
+
+    bench_sink += ob->count;
+    pthread_mutex_destroy(&ob->lock);
+    close(fd);
+    free(ob);
+    game_free(game);
+    free(game);
+    return ns;
+}
+
+// enqueue_log() until logger_thread_func has written (and flushed) every line
+double bench_logger(long iterations) {
+    char dir[] = "/tmp/ono_bench_XXXXXX";
+    char cwd[PATH_MAX];
+    char msg[LOG_MSG_LEN];
+    struct timespec start;
+    pthread_t log_tid;
+
+    // the logger appends to game.log in the working directory
+    if (!getcwd(cwd, sizeof(cwd)) || !mkdtemp(dir) || chdir(dir) == -1) {
+        perror("bench: no scratch directory for game.log");
+        return 0;
+    }
+
+    logq = mmap(NULL, sizeof(LogQueue), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    sem_init(&logq->count, 1, 0);
+    sem_init(&logq->space_left, 1, LOG_QUEUE_SIZE);
+    pthread_mutex_init(&logq->lock, NULL);
+    pthread_create(&log_tid, NULL, logger_thread_func, (void *)logq);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        snprintf(msg, sizeof(msg), "Player bench%ld played 7 (Red)", i % MAX_PLAYERS);
+        enqueue_log(msg);
+    }
+    enqueue_log("SERVER_SHUTDOWN");
+    pthread_join(log_tid, NULL);
+    double ns = elapsed_ns(&start);
+
+    sem_destroy(&logq->count);
+    sem_destroy(&logq->space_left);
+    pthread_mutex_destroy(&logq->lock);
+    munmap(logq, sizeof(LogQueue));
+    logq = NULL;
+
+    unlink("game.log");
+    if (chdir(cwd) == -1) perror("bench: chdir back");
+    rmdir(dir);
+    return ns;
+}
+
+// Full turn handoff: a client thread queues a move the way an input child does
+// (seat queue, doorbell), this thread plays the reactor and runs
+// table_service(), and the turn ends when the client reads the next TURN.
+typedef struct {
+    Shard *shard;
+    _Atomic(Table *) table;
+    int client_fd;          // read end of the pipe every seat writes to
+    long turns;
+} HandoffBench;
+
+static void *handoff_client_func(void *arg) {
+    HandoffBench *hb = (HandoffBench *)arg;
+    char buffer[8192];
+    size_t len = 0;
+    unsigned int seed = 1;
+    long played = 0;
+
+    while (played < hb->turns) {
+        ssize_t n = read(hb->client_fd, buffer + len, sizeof(buffer) - len);
+        if (n <= 0) break;
+        len += n;
+
+        char *line = buffer;
+        char *nl;
+        while ((nl = memchr(line, '\n', buffer + len - line)) != NULL) {
+            if (nl - line >= 4 && strncmp(line, "TURN", 4) == 0 && (nl - line == 4 || line[4] == ' ') && played < hb->turns) {
+                Table *t = atomic_load(&hb->table);
+                char cmd[64];
+                struct timespec now;
+
+                lock_game(t->game);
+                int seat = t->game->current_player;
+                bot_choose_move(t->game, seat, BOT_FIRST, &seed, cmd, sizeof(cmd));
+                pthread_mutex_unlock(&t->game->game_lock);
+
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                input_child_store(t, seat, cmd, &now);
+                played++;
+            }
+            line = nl + 1;
+        }
+        len -= line - buffer;
+        memmove(buffer, line, len);
+        if (len == sizeof(buffer)) len = 0; // a line this long is not ours
+    }
+
+    int stop = -1;
+    write(hb->shard->bell_pipe[1], &stop, sizeof(stop));
+    return NULL;
+}
+
+static Table *handoff_table(Shard *s, int client_out) {
+    Seat seats[HANDOFF_SEATS];
+
+    for (int i = 0; i < HANDOFF_SEATS; i++) {
+        snprintf(seats[i].name, NAME_SIZE, "bench%d", i + 1);
+        seats[i].pid = i + 1;
+        seats[i].fd = dup(client_out); // table_destroy() closes its own
+        seats[i].chan = NULL;
+    }
+
+    Table *t = table_create(HANDOFF_SEATS, seats);
+    t->game->quiet = 1;
+    t->shard = s;
+    return t;
+}
+
+double bench_turn_handoff(long iterations) {
+    static Shard shard;
+    HandoffBench hb = { .shard = &shard, .turns = iterations };
+    int client_pipe[2];
+    struct timespec start;
+    pthread_t client_tid;
+
+    memset(&shard, 0, sizeof(shard));
+    pipe(shard.bell_pipe);
+    pipe(client_pipe);
+    fcntl(client_pipe[1], F_SETPIPE_SZ, 1 << 20);
+    hb.client_fd = client_pipe[0];
+
+    Table *t = handoff_table(&shard, client_pipe[1]);
+    atomic_store(&hb.table, t);
+    pthread_create(&client_tid, NULL, handoff_client_func, &hb);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    table_prompt(t);
+
+    bool running = true;
+    while (running) {
+        int ids[64];
+        ssize_t n = read(shard.bell_pipe[0], ids, sizeof(ids));
+        if (n <= 0) break;
+
+        for (int i = 0; i < n / (int)sizeof(int); i++) {
+            if (ids[i] == -1) running = false;
+            else table_service(t);
+        }
+        // the waiting seats are updated between events, as the reactor does
+        if (t->state_pending) table_flush_state(t);
+
+        // a finished game is replaced at once, the client just sees the next TURN
+        if (running && t->phase != TABLE_PLAYING) {
+            Table *next = handoff_table(&shard, client_pipe[1]);
+            atomic_store(&hb.table, next);
+            table_destroy(t);
+            t = next;
+            table_prompt(t);
+        }
+    }
+    double ns = elapsed_ns(&start);
+
+    pthread_join(client_tid, NULL);
+    table_destroy(t);
+    close(client_pipe[0]);
+    close(client_pipe[1]);
+    close(shard.bell_pipe[0]);
+    close(shard.bell_pipe[1]);
+    bench_sink += shard.moves;
+    return ns;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void bench_run(Benchmark *b, int warmup, int repetitions) {
+    double per_op[MAX_REPETITIONS];
+
+    for (int r = 0; r < warmup; r++) {
+        b->run(b->iterations);
+    }
+    for (int r = 0; r < repetitions; r++) {
+        per_op[r] = b->run(b->iterations) / b->iterations;
+    }
+
+    qsort(per_op, repetitions, sizeof(double), compare_doubles);
+    b->min = per_op[0];
+    b->max = per_op[repetitions - 1];
+    b->median = repetitions % 2 ? per_op[repetitions / 2]
+                                : (per_op[repetitions / 2 - 1] + per_op[repetitions / 2]) / 2;
+    b->mean = 0;
+    for (int r = 0; r < repetitions; r++) b->mean += per_op[r];
+    b->mean /= repetitions;
+    b->done = 1;
+}
+
+// One benchmark per line, so the compare mode can read it back without a JSON parser
+void bench_write_json(FILE *out, Benchmark *benches, int count, int warmup, int repetitions) {
+    int written = 0;
+
+    fprintf(out, "{\n  \"suite\": \"ono\",\n  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"benchmarks\": [\n",
+        warmup, repetitions);
+    for (int i = 0; i < count; i++) {
+        Benchmark *b = &benches[i];
+        if (!b->done) continue;
+        fprintf(out, "%s    {\"name\": \"%s\", \"unit\": \"ns/op\", \"iterations\": %ld, "
+            "\"min\": %.2f, \"median\": %.2f, \"mean\": %.2f, \"max\": %.2f}",
+            written++ ? ",\n" : "", b->name, b->iterations, b->min, b->median, b->mean, b->max);
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+// Returns the baseline median for `name`, or -1 if the baseline does not have it
+double bench_baseline_median(FILE *fp, const char *name) {
+    char line[512];
+    char key[128];
+
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        char *median = strstr(line, "\"median\": ");
+        if (strstr(line, key) && median) {
+            return strtod(median + 10, NULL);
+        }
+    }
+    return -1;
+}
+
+// Prints old vs new medians, returns how many got slower than the threshold allows
+int bench_compare(const char *path, Benchmark *benches, int count, double threshold) {
+    FILE *fp = fopen(path, "r");
+    int regressions = 0;
+
+    if (!fp) {
+        perror("Failed to open baseline");
+        return -1;
+    }
+
+    fprintf(stderr, "\nCompared with %s (threshold %.0f%%):\n", path, threshold);
+    for (int i = 0; i < count; i++) {
+        Benchmark *b = &benches[i];
+        if (!b->done) continue;
+
+        double old = bench_baseline_median(fp, b->name);
+        if (old <= 0) {
+            fprintf(stderr, " - %-22s %12.2f ns/op  (not in baseline)\n", b->name, b->median);
+            continue;
+        }
+
+        double change = (b->median - old) / old * 100.0;
+        bool regressed = change > threshold;
+        if (regressed) regressions++;
+        fprintf(stderr, " - %-22s %12.2f -> %12.2f ns/op  %+7.1f%%%s\n",
+            b->name, old, b->median, change, regressed ? "  REGRESSION" : "");
+    }
+    fclose(fp);
+    return regressions;
+}
+
+int main(int argc, char *argv[]) {
+    Benchmark benches[MAX_BENCHMARKS] = {
+        { "deckShuffle",           bench_deck_shuffle,         20000 },
+        { "deckDraw",              bench_deck_draw,            2000000 },
+        { "playable_card",         bench_playable_card,        5000000 },
+        { "hand_playable_scan",    bench_hand_playable_scan,   2000000 },
+        { "hand_has_playable",     bench_hand_has_playable,    5000000 },
+        { "format_card_to_string", bench_format_card,          2000000 },
+        { "update_player_client",  bench_update_player_client, 200000 },
+        { "enqueue_log_to_logger", bench_logger,               20000 },
+        { "turn_handoff",          bench_turn_handoff,         5000 },
+    };
+    int count = 9;
+    int warmup = 2;
+    int repetitions = 10;
+    double threshold = 10.0;
+    const char *filter = NULL;
+    const char *output = NULL;
+    const char *baseline = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:r:f:o:c:t:")) != -1) {
+        switch (opt) {
+        case 'w': warmup = atoi(optarg); break;
+        case 'r': repetitions = atoi(optarg); break;
+        case 'f': filter = optarg; break;
+        case 'o': output = optarg; break;
+        case 'c': baseline = optarg; break;
+        case 't': threshold = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-w warmup] [-r repetitions] [-f name filter] [-o out.json] [-c baseline.json] [-t threshold %%]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (warmup < 0) warmup = 0;
+    if (repetitions < 1) repetitions = 1;
+    if (repetitions > MAX_REPETITIONS) repetitions = MAX_REPETITIONS;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    for (int i = 0; i < count; i++) {
+        Benchmark *b = &benches[i];
+        if (filter && !strstr(b->name, filter)) continue;
+
+        bench_run(b, warmup, repetitions);
+        fprintf(stderr, "%-22s %12.2f ns/op  (min %.2f, max %.2f, %ld ops x %d)\n",
+            b->name, b->median, b->min, b->max, b->iterations, repetitions);
+    }
+
+    FILE *out = stdout;
+    if (output && (out = fopen(output, "w")) == NULL) {
+        perror("Failed to open output");
+        return 1;
+    }
+    bench_write_json(out, benches, count, warmup, repetitions);
+    if (out != stdout) fclose(out);
+
+    if (baseline) {
+        int regressions = bench_compare(baseline, benches, count, threshold);
+        if (regressions != 0) {
+            if (regressions > 0) fprintf(stderr, "%d benchmark(s) regressed.\n", regressions);
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -1,276 +1,735 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <errno.h>
-#include <stdint.h>
-#include <stdbool.h>
-#include <time.h>
-
-#define NAME_SIZE 50
-#define JOIN_FIFO "/tmp/join_fifo"
-#define MAX_BUFFER 1024
-#define MAX_HAND_SIZE 64
-#define DECK_SIZE 220
-#define MAX_PLAYERS 6
-
-int is_turn_msg(const char *msg)
-{
-    return (strstr(msg, "TURN") != NULL) || (strstr(msg, "Your turn") != NULL);
-}
-
-static void show_top(const char *line) {
-    // line e.g. : "PILE: RED 5"
-    const char *p = strstr(line, "PILE:");
-    if (!p) return;
-    p += 5; // skip "PILE:"
-    while (*p == ' ') p++;
-
-    printf("\n=== Pile Card ===\n");
-    // Create a temporary buffer to print ONLY the current line
-    char card_text[64];
-    size_t len = strcspn(p, "\n"); // Calculate length until the next newline
-    if (len >= sizeof(card_text)) len = sizeof(card_text) - 1;
-    
-    strncpy(card_text, p, len);
-    card_text[len] = '\0'; // Ensure null-termination
-
-    printf("%s\n", card_text);
-}
-
-static void show_hand(const char *line) {
-    // line e.g. : "HAND: RED 3, BLUE SKIP, GREEN 9"
-    const char *p = strstr(line, "HAND:");
-    if (!p) return;
-    p += 5; // skip "HAND:"
-    while (*p == ' ') p++;
-
-    printf("\n=== Your Hand ===\n");
-
-    // Make a copy so strtok doesn't destroy original buffer
-    char temp[MAX_BUFFER];
-    size_t len = strcspn(p, "\n");
-    if (len >= sizeof(temp))
-    {
-        len = sizeof(temp) - 1;
-    }
-    
-    strncpy(temp, p, len);
-    temp[len] = '\0';
-
-    int idx = 1;
-    int hand_size_checker = 0; //just for uno checking
-    char *token = strtok(temp, ",");
-    while (token != NULL) {
-        while (*token == ' ') token++;   // skip leading spaces
-        if (strlen(token) > 0) {
-            printf("%d: %s\n", idx++, token);
-            hand_size_checker++;
-        }
-        token = strtok(NULL, ",");
-    }
-    if(hand_size_checker == 2){
-        printf("\n> You have 2 cards remaining! (move <something> uno) to declare uno!\n");
-    }
-}
-
-static void game_display(const char *msg) {
-    // Calling both. If msg doesn't contain PILE/HAND it just prints nothing extra.
-    show_top(msg);
-    show_hand(msg);
-}
-
-int main() {
-    // Server initialization
-    char player_name[NAME_SIZE];
-    char client_fifo[64];
-    char buffer[MAX_BUFFER];
-
-    printf("Enter your name: ");
-    fgets(player_name, NAME_SIZE, stdin);
-    player_name[strcspn(player_name, "\n")] = 0;
-
-    // Get the process ID for the piping procedure
-    pid_t pid = getpid();
-    snprintf(client_fifo, sizeof(client_fifo), "/tmp/client_%d", pid);
-
-    // If the piping exist, unlink
-    unlink(client_fifo);
-    if (mkfifo(client_fifo, 0666) == -1)
-    {
-        perror("Failed to create client pipe.");
-        return 1;
-    }
-
-    int fd = -1;
-    printf("Looking for server...\n");
-
-    while (1)
-    {
-        // CLient found server
-        fd = open(JOIN_FIFO, O_WRONLY);
-
-        if (fd != -1)
-        {
-            printf("\nConnected to the server...\n");
-            break;
-        }
-        else
-        {
-            if (errno != ENOENT)
-            {
-                perror("Unexpected error when connecting to server.");
-                unlink(client_fifo);
-                return 1;
-            }
-
-            // Client could not find server
-            printf("Server not ready yet. Waiting...\n");
-            fflush(stdout);
-            sleep(1);
-        }
-    }
-
-    snprintf(buffer, sizeof(buffer), "%d %s\n", pid, player_name);
-    write(fd, buffer, strlen(buffer));
-    close(fd);
-
-    printf("Request sent! Waiting for game to start...\n\n");
-
-    int my_fd = open(client_fifo, O_RDONLY); // This BLOCKS until Server connects
-    if (my_fd == -1)
-    {
-        perror("Unable to open client FIFO");
-        close(fd);
-        unlink(client_fifo);
-        return 1;
-    }
-
-    char server_fifo[64];
-    snprintf(server_fifo, sizeof(server_fifo), "/tmp/client_%d_in", pid);
-
-    unlink(server_fifo);
-    if (mkfifo(server_fifo, 0666) == -1)
-    {
-        perror("Failed to create server input pipe");
-        return 1;
-    }
-
-    int write_fd = open(server_fifo, O_WRONLY);
-    if(write_fd == -1){
-        perror("Failed to connect to server input");
-        return 1;
-    }
-
-    while (1)
-    {
-        memset(buffer, 0, sizeof(buffer));
-        int bytes_read = read(my_fd, buffer, sizeof(buffer) - 1);
-
-        if (bytes_read == 0) {
-            printf("Server disconnected.\n");
-            break;
-        }
-        if (bytes_read < 0) {
-            perror("read");
-            break;
-        }
-        buffer[bytes_read] = '\0';
-        
-        if (bytes_read > 0) {
-            // Received data from server!
-            // printf("[Server]: %s\n", buffer);
-            game_display(buffer);
-
-            // Check for game over
-            if (strstr(buffer, "GAME_OVER"))
-                break;
-
-            if (is_turn_msg(buffer))
-            {
-                char move[128];
-
-                printf("Your move (move <something> / draw / quit): ");
-                fflush(stdout);
-
-                if (fgets(move, sizeof(move), stdin) == NULL)
-                {
-                    break;
-                }
-                move[strcspn(move, "\n")] = 0;
-
-                // quit
-                if (strcmp(move, "quit") == 0 || strcmp(move, "q") == 0)
-                {
-                    write(write_fd, "QUIT\n", 5);
-                    break;
-                }
-
-                // draw
-                if (strcmp(move, "draw") == 0)
-                {
-                    printf("\nYou draw a card\n");
-                    write(write_fd, "DRAW\n", 5);
-                }
-                else
-                {
-                    // move
-                    char out[180];
-
-                    if (strncmp(move, "move", 4) == 0)
-                    {
-                        int card_index;
-                        char colour_str[20];
-                        int colour_code = 0; // Default 0
-                        int uno_declaration = 0; //To detect if UNO is declared
-
-                        int args = sscanf(move + 5, "%d %s", &card_index, colour_str);
-
-                        if (args == 2) {
-                            // User declares uno
-                            if (strcasecmp(colour_str, "uno") == 0) {
-                                uno_declaration = 1;
-                                snprintf(out, sizeof(out), "MOVE %d %d\n", card_index, uno_declaration);
-                            }
-                            // User provided a colour
-                            else if (strcasecmp(colour_str, "red") == 0) {
-                                colour_code = 1;
-                                snprintf(out, sizeof(out), "MOVE %d %d\n", card_index, colour_code);
-                            } else if (strcasecmp(colour_str, "blue") == 0) {
-                                colour_code = 2;
-                                snprintf(out, sizeof(out), "MOVE %d %d\n", card_index, colour_code);
-                            } else if (strcasecmp(colour_str, "green") == 0) {
-                                colour_code = 3;
-                                snprintf(out, sizeof(out), "MOVE %d %d\n", card_index, colour_code);
-                            } else if (strcasecmp(colour_str, "yellow") == 0) {
-                                colour_code = 4;
-                                snprintf(out, sizeof(out), "MOVE %d %d\n", card_index, colour_code);
-                            }
-                        } else {
-                            // No colour provided
-                            snprintf(out, sizeof(out), "MOVE %d 0\n", card_index);
-                        }
-                    }
-                    else
-                    {
-                        snprintf(out, sizeof(out), "MOVE %s\n", move);
-                    }
-
-                    write(write_fd, out, strlen(out));
-                }
-            }
-        } 
-        else if (bytes_read == 0) {
-            printf("Server disconnected.\n");
-            break;
-        }
-    }
-
-    close(write_fd);
-    unlink(server_fifo);
-    close(my_fd);
-    unlink(client_fifo);
-    return 0;
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include "shm_ring.h"
+
+#define NAME_SIZE 50
+#define JOIN_FIFO "/tmp/join_fifo"
+#define MAX_BUFFER 1024
+#define HAND_INITIAL_CAP 16 // card slots to start with, doubled whenever a HAND line needs more
+#define DECK_SIZE 220
+#define MAX_PLAYERS 100
+#define CARD_TEXT 32
+#define REFRESH_MS 100     // least time between two redraws of the pile and hand
+#define JOIN_RETRY_MS 10    // first wait for a server that is not up, doubled after each try
+#define JOIN_RETRY_MAX_MS 2000
+
+// Transport to the server: FIFOs by default, shared memory rings with --shm
+static ShmChannel *chan = NULL;
+static int my_fd = -1;
+static int write_fd = -1;
+
+// Blocks until the server sends something, returns 0 when it is gone
+static int recv_message(char *buffer, size_t size) {
+    if (!chan) {
+        return read(my_fd, buffer, size);
+    }
+
+    while (1) {
+        int n = shm_ring_pop(&chan->response, buffer, size);
+        if (n >= 0) return n;
+        if (atomic_load(&chan->closed)) return 0;
+        shm_ring_wait(&chan->response, 1000);
+    }
+}
+
+enum {
+    WAIT_SERVER = 0,
+    WAIT_STDIN = 1,
+    WAIT_TIMEOUT = 2
+};
+
+// Waits up to timeout_ms (-1 = no limit) for a server message or a line on stdin
+static int wait_for_input(int timeout_ms) {
+    struct pollfd pfds[2] = {
+        { .fd = STDIN_FILENO, .events = POLLIN },
+        { .fd = my_fd, .events = POLLIN }
+    };
+
+    if (!chan) {
+        int n;
+        while ((n = poll(pfds, 2, timeout_ms)) == -1 && errno == EINTR) {}
+        if (n == 0) return WAIT_TIMEOUT;
+        // server output first, the pile may have changed under the typed line
+        if (pfds[1].revents & (POLLIN | POLLHUP)) return WAIT_SERVER;
+        return (pfds[0].revents & POLLIN) ? WAIT_STDIN : WAIT_SERVER;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (1) {
+        if (!shm_ring_empty(&chan->response) || atomic_load(&chan->closed)) return WAIT_SERVER;
+        if (poll(pfds, 1, 0) > 0) return WAIT_STDIN;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long waited = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        if (timeout_ms >= 0 && waited >= timeout_ms) return WAIT_TIMEOUT;
+        shm_ring_wait(&chan->response, 50);
+    }
+}
+
+static void send_message(const char *msg, size_t len) {
+    if (!chan) {
+        write(write_fd, msg, len);
+        return;
+    }
+
+    // the server drains moves quickly, a full ring only means it is busy
+    while (!shm_ring_push(&chan->request, msg, len)) {
+        if (atomic_load(&chan->closed)) return;
+        usleep(1000);
+    }
+    shm_ring_wake(&chan->request);
+}
+
+static ShmChannel *create_channel(pid_t pid) {
+    char name[64];
+    shm_channel_name(name, sizeof(name), pid);
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+    if (fd == -1) {
+        perror("Failed to create shared memory");
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(ShmChannel)) == -1) {
+        perror("Failed to size shared memory");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    ShmChannel *c = mmap(NULL, sizeof(ShmChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (c == MAP_FAILED) {
+        perror("Failed to map shared memory");
+        shm_unlink(name);
+        return NULL;
+    }
+    c->magic = SHM_CHANNEL_MAGIC;
+    return c;
+}
+
+static void close_channel(pid_t pid) {
+    char name[64];
+    shm_channel_name(name, sizeof(name), pid);
+
+    atomic_store(&chan->closed, 1);
+    shm_ring_wake(&chan->request);
+    munmap(chan, sizeof(ShmChannel));
+    shm_unlink(name);
+    chan = NULL;
+}
+
+// Local copy of what the server last sent, and of what is on the screen. State
+// frames are applied to `view` as they arrive; render() compares it with `shown`
+// and reprints only the regions (pile, hand) that differ, at most once per
+// refresh interval, so a burst of opponents' moves becomes one redraw.
+typedef struct {
+    char pile[CARD_TEXT];
+    char (*hand)[CARD_TEXT];
+    int hand_size;      // -1 in `shown` forces a full redraw
+    int hand_cap;
+} ClientView;
+
+typedef struct {
+    bool playable;
+    bool wild;          // needs a colour
+} TurnCard;
+
+// Cards the server says may be played this turn, from "TURN <hand size> <playable> <wild>"
+typedef struct {
+    bool known;         // false for a bare TURN, moves then go to the server unchecked
+    int hand_size;
+    TurnCard *cards;
+    int cap;
+} TurnMoves;
+
+static ClientView view;
+static ClientView shown;
+static TurnMoves turn_moves;
+static bool view_dirty = false;
+static int refresh_ms = REFRESH_MS;
+static struct timespec last_render;
+
+// Server bytes not yet split into lines (a FIFO read may stop mid-frame),
+// grown for the HAND line of a big hand
+static char *inbuf = NULL;
+static size_t inbuf_len = 0;
+static size_t inbuf_cap = 0;
+
+enum {
+    LINE_TURN = 1,      // prompt for a move
+    LINE_EXIT = 2       // the session is over
+};
+
+static long ms_since(const struct timespec *t) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - t->tv_sec) * 1000 + (now.tv_nsec - t->tv_nsec) / 1000000;
+}
+
+static void copy_text(char *dst, size_t size, const char *src, size_t len) {
+    while (len > 0 && *src == ' ') { src++; len--; }
+    if (len >= size) len = size - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+// Room for `need` elements of `size` bytes in *array, doubling its capacity;
+// false if memory ran out
+static bool reserve(void *array, int *cap, int need, size_t size) {
+    void **p = array;
+    if (need <= *cap) return true;
+
+    int n = *cap > 0 ? *cap : HAND_INITIAL_CAP;
+    while (n < need) n *= 2;
+    void *grown = realloc(*p, (size_t)n * size);
+    if (!grown) return false;
+    *p = grown;
+    *cap = n;
+    return true;
+}
+
+// "HAND:RED 3,BLUE SKIP,GREEN 9"
+static void parse_hand(const char *p) {
+    view.hand_size = 0;
+    while (*p) {
+        size_t len = strcspn(p, ",");
+        if (len > 0) {
+            if (!reserve(&view.hand, &view.hand_cap, view.hand_size + 1, CARD_TEXT)) break;
+            copy_text(view.hand[view.hand_size++], CARD_TEXT, p, len);
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+}
+
+// One hex digit per four cards, the lowest bit of the first digit is card 1
+static bool parse_mask(const char *hex, int hand_size, bool wild) {
+    for (int i = 0; i < hand_size; i++) {
+        char c = hex[i / 4];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (digit < 0) return false;
+        bool set = digit & (1 << (i % 4));
+        if (wild) turn_moves.cards[i].wild = set;
+        else turn_moves.cards[i].playable = set;
+    }
+    return true;
+}
+
+static void parse_turn(const char *p) {
+    int hand_size = 0, used = 0;
+
+    turn_moves.known = false;
+    if (sscanf(p, "%d %n", &hand_size, &used) < 1 || hand_size < 0) return;
+
+    // each mask must cover the whole hand, which also bounds what is allocated
+    const char *playable = p + used;
+    size_t playable_len = strcspn(playable, " ");
+    const char *wild = playable + playable_len + strspn(playable + playable_len, " ");
+    size_t wild_len = strcspn(wild, " ");
+
+    turn_moves.known = playable_len * 4 >= (size_t)hand_size && wild_len * 4 >= (size_t)hand_size
+        && reserve(&turn_moves.cards, &turn_moves.cap, hand_size, sizeof(TurnCard))
+        && parse_mask(playable, hand_size, false)
+        && parse_mask(wild, hand_size, true);
+    turn_moves.hand_size = hand_size;
+}
+
+// The masks only hold for the hand they were computed from
+static bool turn_moves_valid(void) {
+    return turn_moves.known && turn_moves.hand_size == view.hand_size;
+}
+
+static void show_playable(void) {
+    bool any = false;
+
+    if (!turn_moves_valid()) return;
+    for (int i = 0; i < view.hand_size; i++) {
+        if (!turn_moves.cards[i].playable) continue;
+        printf("%s%d%s", any ? ", " : "Playable: ", i + 1, turn_moves.cards[i].wild ? " (pick a colour)" : "");
+        any = true;
+    }
+    printf(any ? "\n" : "No card can be played on the pile, type draw.\n");
+}
+
+// Why a move would be turned down by the server, NULL if it can be sent
+static const char *move_refused(int card_index, bool coloured, bool uno) {
+    if (!turn_moves_valid()) return NULL;
+    if (card_index < 1 || card_index > view.hand_size) return "there is no card with that number";
+    if (!turn_moves.cards[card_index - 1].playable) return "that card does not match the pile";
+    // with two cards the server takes uno in place of the colour
+    if (turn_moves.cards[card_index - 1].wild && !coloured && !(uno && view.hand_size == 2))
+        return "a wild card needs a colour (move <card_index> red/blue/green/yellow)";
+    return NULL;
+}
+
+static bool hand_changed(void) {
+    if (view.hand_size != shown.hand_size) return true;
+    for (int i = 0; i < view.hand_size; i++) {
+        if (strcmp(view.hand[i], shown.hand[i]) != 0) return true;
+    }
+    return false;
+}
+
+static void render(void) {
+    if (strcmp(view.pile, shown.pile) != 0) {
+        printf("\n=== Pile Card ===\n%s\n", view.pile);
+    }
+
+    if (hand_changed()) {
+        printf("\n=== Your Hand ===\n");
+        for (int i = 0; i < view.hand_size; i++) printf("%d: %s\n", i + 1, view.hand[i]);
+        if (view.hand_size == 2)
+            printf("\n> You have 2 cards remaining! (move <something> uno) to declare uno!\n");
+    }
+
+    memcpy(shown.pile, view.pile, CARD_TEXT);
+    if (reserve(&shown.hand, &shown.hand_cap, view.hand_size, CARD_TEXT)) {
+        memcpy(shown.hand, view.hand, (size_t)view.hand_size * CARD_TEXT);
+        shown.hand_size = view.hand_size;
+    } else {
+        shown.hand_size = -1;
+    }
+    view_dirty = false;
+    clock_gettime(CLOCK_MONOTONIC, &last_render);
+    fflush(stdout);
+}
+
+// HINT <card> <colour code> <moves>, or NONE when the server found no sure win
+static void show_hint(const char *hint) {
+    static const char *colours[] = { "", " red", " blue", " green", " yellow" };
+    int card_index, colour, plies;
+
+    if (strcmp(hint, "OFF") == 0) {
+        printf("\n> Hints are turned off on this server.\n");
+    } else if (sscanf(hint, "%d %d %d", &card_index, &colour, &plies) == 3 && colour >= 0 && colour <= 4) {
+        printf("\n> Hint: move %d%s wins whatever the others do (%d moves, counting everyone's).\n",
+               card_index, view.hand_size == 2 ? " uno" : colours[colour], plies);
+    } else {
+        printf("\n> Hint: no sure win from here, play on.\n");
+    }
+}
+
+// Applies one line from the server. PILE/HAND only update the model; anything
+// else is shown right away, after the pending frame so the order is kept.
+static int handle_line(const char *line, bool use_shm) {
+    if (strncmp(line, "PILE:", 5) == 0) {
+        copy_text(view.pile, CARD_TEXT, line + 5, strlen(line + 5));
+        view_dirty = true;
+        return 0;
+    }
+    if (strncmp(line, "HAND:", 5) == 0) {
+        parse_hand(line + 5);
+        view_dirty = true;
+        return 0;
+    }
+
+    if (view_dirty) render();
+
+    if (strncmp(line, "TOKEN ", 6) == 0)
+        printf("If you lose your connection, rejoin with: ./client%s --resume %.16s\n", use_shm ? " --shm" : "", line + 6);
+    else if (strcmp(line, "RESUMED") == 0)
+        printf("\n> Back in your seat, the game carried on where you left it.\n");
+    else if (strncmp(line, "QUEUE ", 6) == 0)
+        printf("Waiting for a table, you are number %d in the queue.\n", atoi(line + 6));
+    else if (strncmp(line, "HINT ", 5) == 0)
+        show_hint(line + 5);
+    else if (strcmp(line, "JUMP_IN_REJECTED") == 0)
+        printf("\n> Jump-in rejected: the card is not identical to the pile, or someone was faster.\n");
+    else if (strncmp(line, "TURN", 4) == 0 && (line[4] == '\0' || line[4] == ' ')) {
+        parse_turn(line + 4);
+        return LINE_TURN;
+    } else if (strstr(line, "Your turn")) {
+        turn_moves.known = false;
+        return LINE_TURN;
+    }
+    else if (strcmp(line, "GAME_OVER") == 0)
+        return LINE_EXIT;
+    else if (strcmp(line, "RESUME_FAILED") == 0) {
+        printf("Could not resume: the game is over or the seat was given up.\n");
+        return LINE_EXIT;
+    } else if (strcmp(line, "LOBBY_CLOSED") == 0) {
+        printf("The lobby closed before you got a seat.\n");
+        return LINE_EXIT;
+    } else if (strcmp(line, "KICKED") == 0) {
+        printf("\n> You were removed from the game by the server admin.\n");
+        return LINE_EXIT;
+    }
+    return 0;
+}
+
+// Appends what was received and applies every complete line, returns LINE_* flags
+static int handle_input(const char *data, size_t len, bool use_shm) {
+    int flags = 0;
+
+    if (inbuf_len + len > inbuf_cap) {
+        size_t cap = inbuf_cap > 0 ? inbuf_cap : MAX_BUFFER * 2;
+        while (inbuf_len + len > cap) cap *= 2;
+        char *grown = realloc(inbuf, cap);
+        if (grown) {
+            inbuf = grown;
+            inbuf_cap = cap;
+        } else {
+            inbuf_len = 0; // out of memory for this line, start over
+            if (len > inbuf_cap) return 0;
+        }
+    }
+    memcpy(inbuf + inbuf_len, data, len);
+    inbuf_len += len;
+
+    size_t start = 0;
+    for (size_t i = 0; i < inbuf_len; i++) {
+        if (inbuf[i] != '\n') continue;
+        inbuf[i] = '\0';
+        flags |= handle_line(inbuf + start, use_shm);
+        start = i + 1;
+    }
+    memmove(inbuf, inbuf + start, inbuf_len - start);
+    inbuf_len -= start;
+    return flags;
+}
+
+// Open the server's join FIFO, waiting for the server if it is not up yet.
+// inotify on the FIFO's directory wakes us the moment the server creates it;
+// a FIFO nobody reads yet (the server is still starting, or it died) and hosts
+// without inotify are retried after a jittered, doubling wait.
+// Returns -1 on errors other than the server not being there.
+static int join_server(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+    char dir[256] = ".";
+    if (slash == path) strcpy(dir, "/");
+    else if (slash) snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+
+    int watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch != -1 && inotify_add_watch(watch, dir, IN_CREATE | IN_MOVED_TO) == -1) {
+        close(watch);
+        watch = -1;
+    }
+
+    unsigned int seed = (unsigned int)getpid() ^ (unsigned int)time(NULL);
+    int retry_ms = JOIN_RETRY_MS;
+    bool told = false;
+    int fd;
+
+    while ((fd = open(path, O_WRONLY | O_NONBLOCK)) == -1) {
+        if (errno != ENOENT && errno != ENXIO) break;
+        if (!told) {
+            printf("Server not ready yet. Waiting...\n");
+            fflush(stdout);
+            told = true;
+        }
+
+        // half to all of the wait, so clients started together do not retry together
+        int wait_ms = retry_ms / 2 + rand_r(&seed) % (retry_ms / 2 + 1);
+        if (retry_ms < JOIN_RETRY_MAX_MS) retry_ms = retry_ms * 2 < JOIN_RETRY_MAX_MS ? retry_ms * 2 : JOIN_RETRY_MAX_MS;
+        if (watch == -1) {
+            usleep(wait_ms * 1000);
+            continue;
+        }
+
+        struct pollfd pfd = { .fd = watch, .events = POLLIN };
+        if (poll(&pfd, 1, wait_ms) <= 0) continue;
+
+        char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t n;
+        while ((n = read(watch, events, sizeof(events))) > 0) {
+            for (char *p = events; p < events + n; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+                struct inotify_event *e = (struct inotify_event *)p;
+                if (e->len > 0 && strcmp(e->name, name) == 0) retry_ms = JOIN_RETRY_MS; // just created, try now
+            }
+        }
+    }
+
+    if (watch != -1) close(watch);
+    if (fd != -1) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    // Server initialization
+    char player_name[NAME_SIZE];
+    char client_fifo[64];
+    char buffer[MAX_BUFFER];
+
+    // --shm talks to a server on this host through shared memory instead of FIFOs,
+    // --resume <token> takes back the seat of a client that lost its connection,
+    // --refresh <ms> sets how often the pile and hand may be redrawn (0 = every frame),
+    // --join <fifo> is the server's join FIFO when it was started with -j
+    bool use_shm = false;
+    const char *resume_token = NULL;
+    const char *join_path = JOIN_FIFO;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shm") == 0) {
+            use_shm = true;
+        } else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+            resume_token = argv[++i];
+        } else if (strcmp(argv[i], "--refresh") == 0 && i + 1 < argc) {
+            refresh_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--join") == 0 && i + 1 < argc) {
+            join_path = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--shm] [--resume <token>] [--refresh <ms>] [--join <fifo>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (resume_token) {
+        strcpy(player_name, "-"); // the server knows whose seat it is
+    } else {
+        printf("Enter your name: ");
+        fgets(player_name, NAME_SIZE, stdin);
+        player_name[strcspn(player_name, "\n")] = 0;
+    }
+
+    // Get the process ID for the piping procedure
+    pid_t pid = getpid();
+    snprintf(client_fifo, sizeof(client_fifo), "/tmp/client_%d", pid);
+
+    if (use_shm) {
+        chan = create_channel(pid);
+        if (!chan) return 1;
+    } else {
+        // If the piping exist, unlink
+        unlink(client_fifo);
+        if (mkfifo(client_fifo, 0666) == -1)
+        {
+            perror("Failed to create client pipe.");
+            return 1;
+        }
+    }
+
+    printf("Looking for server...\n");
+    int fd = join_server(join_path);
+    if (fd == -1) {
+        perror("Unexpected error when connecting to server.");
+        if (use_shm) close_channel(pid);
+        else unlink(client_fifo);
+        return 1;
+    }
+    printf("\nConnected to the server...\n");
+
+    int len = 0;
+    if (resume_token) len = snprintf(buffer, sizeof(buffer), "RESUME %.16s ", resume_token);
+    snprintf(buffer + len, sizeof(buffer) - len, "%s%d %s\n", use_shm ? "SHM " : "", pid, player_name);
+    write(fd, buffer, strlen(buffer));
+    close(fd);
+
+    printf("Request sent! Waiting for game to start...\n\n");
+
+    char server_fifo[64];
+    snprintf(server_fifo, sizeof(server_fifo), "/tmp/client_%d_in", pid);
+
+    if (!use_shm) {
+        my_fd = open(client_fifo, O_RDONLY); // This BLOCKS until Server connects
+        if (my_fd == -1)
+        {
+            perror("Unable to open client FIFO");
+            close(fd);
+            unlink(client_fifo);
+            return 1;
+        }
+
+        unlink(server_fifo);
+        if (mkfifo(server_fifo, 0666) == -1)
+        {
+            perror("Failed to create server input pipe");
+            return 1;
+        }
+
+        // O_RDWR does not wait for the server's reader: queued or resuming clients
+        // must see QUEUE, LOBBY_CLOSED and RESUME_FAILED before a seat is theirs
+        write_fd = open(server_fifo, O_RDWR);
+        if(write_fd == -1){
+            perror("Failed to connect to server input");
+            return 1;
+        }
+    }
+
+    while (1)
+    {
+        // a pending frame waits for the rest of its refresh interval
+        int timeout = -1;
+        if (view_dirty) {
+            long left = refresh_ms - ms_since(&last_render);
+            timeout = left > 0 ? (int)left : 0;
+        }
+
+        // between turns the only move allowed is jumping in with a card identical to the pile
+        int ready = wait_for_input(timeout);
+        if (ready == WAIT_TIMEOUT) {
+            render();
+            continue;
+        }
+        if (ready == WAIT_STDIN) {
+            char line[128];
+            char extra[20] = "";
+            int card_index;
+
+            if (fgets(line, sizeof(line), stdin) == NULL) break;
+            if (sscanf(line, "jump %d %19s", &card_index, extra) >= 1) {
+                char out[64];
+
+                // only a card identical to the pile can jump in, the same text on screen
+                if (view.hand_size > 0 && (card_index < 1 || card_index > view.hand_size
+                        || strcmp(view.hand[card_index - 1], view.pile) != 0)) {
+                    printf("Card %d is not identical to the pile, it cannot jump in.\n", card_index);
+                    continue;
+                }
+                snprintf(out, sizeof(out), "MOVE %d %d\n", card_index, strcasecmp(extra, "uno") == 0);
+                send_message(out, strlen(out));
+            } else {
+                printf("Not your turn. Use jump <card_index> to play a card identical to the pile.\n");
+            }
+            continue;
+        }
+
+        int bytes_read = recv_message(buffer, sizeof(buffer));
+
+        if (bytes_read == 0) {
+            printf("Server disconnected.\n");
+            break;
+        }
+        if (bytes_read < 0) {
+            perror("read");
+            break;
+        }
+        
+        if (bytes_read > 0) {
+            // Received data from server!
+            int flags = handle_input(buffer, bytes_read, use_shm);
+
+            // the first frame after a quiet spell is drawn at once, a burst is coalesced
+            if (view_dirty && (flags || ms_since(&last_render) >= refresh_ms)) render();
+
+            // Check for game over
+            if (flags & LINE_EXIT)
+                break;
+
+            if (flags & LINE_TURN)
+            {
+                char move[128];
+                bool quit = false;
+
+                show_playable();
+
+                // a move the server would turn down is refused here and asked for again
+                while (1) {
+                    printf("Your move (move <something> / draw / quit): ");
+                    fflush(stdout);
+
+                    if (fgets(move, sizeof(move), stdin) == NULL)
+                    {
+                        quit = true;
+                        break;
+                    }
+                    move[strcspn(move, "\n")] = 0;
+
+                    // quit
+                    if (strcmp(move, "quit") == 0 || strcmp(move, "q") == 0)
+                    {
+                        send_message("QUIT\n", 5);
+                        quit = true;
+                        break;
+                    }
+
+                    // hint, answered together with a fresh turn prompt
+                    if (strcmp(move, "hint") == 0)
+                    {
+                        send_message("HINT\n", 5);
+                        break;
+                    }
+
+                    // draw
+                    if (strcmp(move, "draw") == 0)
+                    {
+                        printf("\nYou draw a card\n");
+                        send_message("DRAW\n", 5);
+                        break;
+                    }
+
+                    // move
+                    char out[180];
+                    const char *refused = NULL;
+
+                    if (strncmp(move, "move", 4) == 0)
+                    {
+                        int card_index = 0;
+                        char colour_str[20] = "";
+                        int colour_code = 0; // Default 0
+                        int uno_declaration = 0; //To detect if UNO is declared
+
+                        int args = sscanf(move + 4, "%d %19s", &card_index, colour_str);
+
+                        if (args == 2) {
+                            // User declares uno
+                            if (strcasecmp(colour_str, "uno") == 0) {
+                                uno_declaration = 1;
+                            }
+                            // User provided a colour
+                            else if (strcasecmp(colour_str, "red") == 0) {
+                                colour_code = 1;
+                            } else if (strcasecmp(colour_str, "blue") == 0) {
+                                colour_code = 2;
+                            } else if (strcasecmp(colour_str, "green") == 0) {
+                                colour_code = 3;
+                            } else if (strcasecmp(colour_str, "yellow") == 0) {
+                                colour_code = 4;
+                            }
+                        }
+
+                        if (args < 1) {
+                            refused = turn_moves_valid() ? "which card? (move <card_index>)" : NULL;
+                            snprintf(out, sizeof(out), "MOVE %s\n", move);
+                        } else {
+                            refused = move_refused(card_index, colour_code != 0, uno_declaration);
+                            snprintf(out, sizeof(out), "MOVE %d %d\n", card_index, uno_declaration ? 1 : colour_code);
+                        }
+                    }
+                    else
+                    {
+                        refused = turn_moves_valid() ? "use move <card_index>, draw, hint or quit" : NULL;
+                        snprintf(out, sizeof(out), "MOVE %s\n", move);
+                    }
+
+                    if (refused) {
+                        printf("Not sent: %s.\n", refused);
+                        continue;
+                    }
+                    send_message(out, strlen(out));
+                    break;
+                }
+                if (quit)
+                    break;
+            }
+        } 
+        else if (bytes_read == 0) {
+            printf("Server disconnected.\n");
+            break;
+        }
+    }
+
+    if (use_shm) {
+        close_channel(pid);
+        return 0;
+    }
+
+    close(write_fd);
+    unlink(server_fifo);
+    close(my_fd);
+    unlink(client_fifo);
+    return 0;
 }
\ No newline at end of file
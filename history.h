@@ -0,0 +1,83 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+// Columnar game history, written by the server as games finish and read by histq.
+// The file is a run of self-contained blocks, only ever appended to. A block holds
+// whole games: one row per move in six columns, each column padded to 16 bytes so
+// a scanner can always load full vectors, then one HistoryGame entry per game.
+// The header keeps every column's min/max so a query can skip blocks outright.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HISTORY_FILE "history.onoh"
+#define HISTORY_MAGIC 0x484f4e4f // "ONOH"
+#define HISTORY_VERSION 1
+#define HISTORY_BLOCK_ROWS 4096  // a block is closed once it holds this many moves
+#define HISTORY_ALIGN 16
+#define HISTORY_NO_CARD 0xff
+#define HISTORY_NO_WINNER 0xff
+
+typedef enum HistoryAction {
+    HIST_DEAL = 0,      // turn 0, one row per card dealt
+    HIST_PLAY = 1,
+    HIST_JUMP_IN = 2,
+    HIST_DRAW = 3,      // card is the one drawn
+    HIST_INVALID = 4,   // rejected move, card is the penalty card
+    HIST_SKIP = 5,      // seat skipped after a disconnect, no card
+    HIST_WIN = 6        // the play that emptied the hand
+} HistoryAction;
+
+enum {
+    HIST_COL_GAME = 0,  // uint32_t
+    HIST_COL_TURN,      // uint16_t
+    HIST_COL_PLAYER,    // uint8_t, seat
+    HIST_COL_CARD,      // uint8_t, colour << 4 | value
+    HIST_COL_ACTION,    // uint8_t, HistoryAction
+    HIST_COL_HAND,      // uint8_t, hand size after the move (255 and up stored as 255)
+    HIST_COLUMNS
+};
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t block_bytes;   // header included, the next block starts right after
+    uint32_t rows;
+    uint32_t games;
+    uint32_t min[HIST_COLUMNS];
+    uint32_t max[HIST_COLUMNS];
+    uint32_t reserved;
+} HistoryBlockHeader;
+
+typedef struct {
+    uint32_t game;
+    uint16_t turns;
+    uint8_t players;
+    uint8_t winner;         // seat, HISTORY_NO_WINNER if nobody won
+} HistoryGame;
+
+static const uint8_t history_col_width[HIST_COLUMNS] = { 4, 2, 1, 1, 1, 1 };
+
+static inline size_t history_pad(size_t bytes) {
+    return (bytes + HISTORY_ALIGN - 1) & ~(size_t)(HISTORY_ALIGN - 1);
+}
+
+static inline uint8_t history_card_byte(int colour, int value) {
+    return (uint8_t)(colour << 4 | value);
+}
+
+// Offsets of the columns and the game table from the start of the block,
+// returns the size of the whole block
+static inline size_t history_layout(uint32_t rows, uint32_t games, size_t offsets[HIST_COLUMNS + 1]) {
+    size_t off = history_pad(sizeof(HistoryBlockHeader));
+
+    for (int c = 0; c < HIST_COLUMNS; c++) {
+        offsets[c] = off;
+        off += history_pad((size_t)rows * history_col_width[c]);
+    }
+    offsets[HIST_COLUMNS] = off;
+    return off + history_pad((size_t)games * sizeof(HistoryGame));
+}
+
+#endif // HISTORY_H
@@ -0,0 +1,511 @@
+// histq: filtered aggregates over the columnar game history the server writes
+// (history.h). Blocks whose min/max rule out a filter are skipped without being
+// read, the rest are scanned 16 rows at a time with GCC vector extensions, which
+// build a byte mask (0xff = row selected) that the aggregates then consume.
+//
+//   histq [-f history.onoh] [filters] <query> [args]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "history.h"
+
+#define MAX_FILTERS 16
+#define CARD_VALUE_NAMES 15
+
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+typedef uint16_t v8u16 __attribute__((vector_size(16)));
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+typedef int8_t v8i8 __attribute__((vector_size(8)));
+typedef int8_t v4i8 __attribute__((vector_size(4)));
+
+static const char *column_names[HIST_COLUMNS] = { "game", "turn", "player", "card", "action", "hand" };
+static const char *action_names[] = { "deal", "play", "jump", "draw", "invalid", "skip", "win" };
+static const char *colour_names[] = { "red", "blue", "green", "yellow", "black" };
+static const char *value_names[] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+    "skip", "reverse", "draw2", "wild", "wd4" };
+
+// Inclusive range on one column; a card filter without a colour only matches the value nibble
+typedef struct {
+    int column;
+    uint32_t lo;
+    uint32_t hi;
+    bool value_only;
+} Filter;
+
+typedef struct {
+    const HistoryBlockHeader *h;
+    const uint8_t *col[HIST_COLUMNS];
+    const HistoryGame *games;
+} Block;
+
+typedef struct {
+    Filter filters[MAX_FILTERS];
+    int count;
+    long blocks;
+    long skipped;
+} Query;
+
+static uint8_t *mask;
+static size_t mask_cap;
+
+// ---- scans ----
+
+static void scan_u8(const uint8_t *col, size_t n, uint8_t lo, uint8_t hi, uint8_t *m) {
+    v16u8 vlo = (v16u8){} + lo, vhi = (v16u8){} + hi;
+
+    for (size_t i = 0; i < n; i += 16) {
+        v16u8 c, sel;
+        memcpy(&c, col + i, 16);
+        memcpy(&sel, m + i, 16);
+        sel &= (v16u8)((c >= vlo) & (c <= vhi));
+        memcpy(m + i, &sel, 16);
+    }
+}
+
+static void scan_card_value(const uint8_t *col, size_t n, uint8_t value, uint8_t *m) {
+    v16u8 low = (v16u8){} + 0x0f, v = (v16u8){} + value;
+
+    for (size_t i = 0; i < n; i += 16) {
+        v16u8 c, sel;
+        memcpy(&c, col + i, 16);
+        memcpy(&sel, m + i, 16);
+        sel &= (v16u8)((c & low) == v);
+        memcpy(m + i, &sel, 16);
+    }
+}
+
+static void scan_u16(const uint16_t *col, size_t n, uint16_t lo, uint16_t hi, uint8_t *m) {
+    v8u16 vlo = (v8u16){} + lo, vhi = (v8u16){} + hi;
+
+    for (size_t i = 0; i < n; i += 8) {
+        v8u16 c;
+        v8i8 sel;
+        memcpy(&c, col + i, 16);
+        memcpy(&sel, m + i, 8);
+        sel &= __builtin_convertvector((c >= vlo) & (c <= vhi), v8i8);
+        memcpy(m + i, &sel, 8);
+    }
+}
+
+static void scan_u32(const uint32_t *col, size_t n, uint32_t lo, uint32_t hi, uint8_t *m) {
+    v4u32 vlo = (v4u32){} + lo, vhi = (v4u32){} + hi;
+
+    for (size_t i = 0; i < n; i += 4) {
+        v4u32 c;
+        v4i8 sel;
+        memcpy(&c, col + i, 16);
+        memcpy(&sel, m + i, 4);
+        sel &= __builtin_convertvector((c >= vlo) & (c <= vhi), v4i8);
+        memcpy(m + i, &sel, 4);
+    }
+}
+
+// min/max says no row of the block can pass this filter
+static bool filter_rules_out(const Filter *f, const HistoryBlockHeader *h) {
+    if (f->value_only) return false;
+    return h->max[f->column] < f->lo || h->min[f->column] > f->hi;
+}
+
+// Mask of the block's rows passing every filter, NULL if the block was skipped.
+// The mask is padded with zeroes to a whole vector.
+static uint8_t *block_select(Query *q, Block *b) {
+    uint32_t rows = b->h->rows;
+
+    q->blocks++;
+    for (int i = 0; i < q->count; i++) {
+        if (filter_rules_out(&q->filters[i], b->h)) {
+            q->skipped++;
+            return NULL;
+        }
+    }
+
+    size_t padded = history_pad(rows);
+    if (padded > mask_cap) {
+        mask_cap = padded;
+        mask = realloc(mask, mask_cap);
+    }
+    memset(mask, 0xff, rows);
+    memset(mask + rows, 0, padded - rows);
+
+    for (int i = 0; i < q->count; i++) {
+        Filter *f = &q->filters[i];
+        const uint8_t *col = b->col[f->column];
+        // scanning a padded column tail is harmless, the mask is already zero there
+        size_t n = history_pad((size_t)rows * history_col_width[f->column]) / history_col_width[f->column];
+
+        if (f->value_only) scan_card_value(col, n, f->lo, mask);
+        else if (f->column == HIST_COL_GAME) scan_u32((const uint32_t *)col, n, f->lo, f->hi, mask);
+        else if (f->column == HIST_COL_TURN) scan_u16((const uint16_t *)col, n, f->lo, f->hi, mask);
+        else scan_u8(col, n, f->lo, f->hi, mask);
+    }
+    return mask;
+}
+
+// ---- aggregates (plain loops over the mask, GCC vectorizes them at -O2 -ftree-vectorize) ----
+
+static uint64_t mask_count(const uint8_t *m, uint32_t rows) {
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < rows; i++) n += m[i] & 1;
+    return n;
+}
+
+static uint64_t mask_sum(const Block *b, int column, const uint8_t *m, uint32_t rows) {
+    uint64_t sum = 0;
+
+    if (column == HIST_COL_GAME) {
+        const uint32_t *c = (const uint32_t *)b->col[column];
+        for (uint32_t i = 0; i < rows; i++) sum += c[i] & (uint32_t)(int32_t)(int8_t)m[i];
+    } else if (column == HIST_COL_TURN) {
+        const uint16_t *c = (const uint16_t *)b->col[column];
+        for (uint32_t i = 0; i < rows; i++) sum += c[i] & (uint16_t)(int16_t)(int8_t)m[i];
+    } else {
+        const uint8_t *c = b->col[column];
+        for (uint32_t i = 0; i < rows; i++) sum += c[i] & m[i];
+    }
+    return sum;
+}
+
+// ---- file ----
+
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+} HistoryFile;
+
+static bool history_map(const char *path, HistoryFile *file) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        perror(path);
+        if (fd != -1) close(fd);
+        return false;
+    }
+    file->size = st.st_size;
+    file->base = file->size ? mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (file->base == MAP_FAILED) {
+        perror("mmap");
+        return false;
+    }
+    return true;
+}
+
+// Next complete block at *off, false at the end of the file or at a damaged block
+static bool history_next(const HistoryFile *file, size_t *off, Block *b) {
+    if (*off + sizeof(HistoryBlockHeader) > file->size) return false;
+
+    const HistoryBlockHeader *h = (const HistoryBlockHeader *)(file->base + *off);
+    size_t offsets[HIST_COLUMNS + 1];
+    if (h->magic != HISTORY_MAGIC || h->version != HISTORY_VERSION || *off + h->block_bytes > file->size
+        || history_layout(h->rows, h->games, offsets) != h->block_bytes) {
+        fprintf(stderr, "histq: bad block at offset %zu, stopping there\n", *off);
+        return false;
+    }
+
+    b->h = h;
+    for (int c = 0; c < HIST_COLUMNS; c++) b->col[c] = (const uint8_t *)h + offsets[c];
+    b->games = (const HistoryGame *)((const uint8_t *)h + offsets[HIST_COLUMNS]);
+    *off += h->block_bytes;
+    return true;
+}
+
+// ---- argument parsing ----
+
+static int column_from_name(const char *name) {
+    for (int c = 0; c < HIST_COLUMNS; c++) {
+        if (strcmp(name, column_names[c]) == 0) return c;
+    }
+    return -1;
+}
+
+static bool parse_range(const char *arg, uint32_t *lo, uint32_t *hi) {
+    char *end;
+    *lo = strtoul(arg, &end, 10);
+    if (end == arg) return false;
+    *hi = *lo;
+    if (*end == ':') *hi = strtoul(end + 1, &end, 10);
+    return *end == '\0' && *lo <= *hi;
+}
+
+// "wd4", "skip", "7" (any colour) or "red7", "blue-skip", "yellow-0"
+static bool parse_card(const char *arg, Filter *f) {
+    char spec[32];
+    int colour = -1;
+
+    snprintf(spec, sizeof(spec), "%s", arg);
+    for (char *p = spec; *p; p++) *p = tolower((unsigned char)*p);
+
+    const char *rest = spec;
+    for (int c = 0; c < 5; c++) {
+        size_t len = strlen(colour_names[c]);
+        if (strncmp(spec, colour_names[c], len) == 0) {
+            colour = c;
+            rest = spec + len + (spec[len] == '-');
+            break;
+        }
+    }
+    for (int v = 0; v < CARD_VALUE_NAMES; v++) {
+        if (strcmp(rest, value_names[v]) == 0) {
+            f->column = HIST_COL_CARD;
+            f->value_only = colour == -1;
+            f->lo = f->hi = colour == -1 ? (uint32_t)v : history_card_byte(colour, v);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void card_name(uint8_t card, char *buffer, size_t size) {
+    if (card == HISTORY_NO_CARD || (card >> 4) > 4 || (card & 0x0f) >= CARD_VALUE_NAMES)
+        snprintf(buffer, size, "-");
+    else
+        snprintf(buffer, size, "%s-%s", colour_names[card >> 4], value_names[card & 0x0f]);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [-f file] [filters] <query> [args]\n"
+        "queries:\n"
+        "  info                  blocks, moves and games in the file\n"
+        "  count                 moves matching the filters\n"
+        "  avg <column>          mean of game|turn|player|hand over matching moves\n"
+        "  hist <column>         matching moves per player|card|action|hand value\n"
+        "  turns                 average turns per game, by table size\n"
+        "  winrate <card> [min]  win rate of players dealt at least min (default 2) of <card>\n"
+        "filters:\n"
+        "  -a deal|play|jump|draw|invalid|skip|win   -c card (wd4, wild, skip, red7, blue-skip)\n"
+        "  -p seat[:seat]  -t turn[:turn]  -h hand[:hand]  -g game[:game]\n", prog);
+}
+
+// ---- queries ----
+
+static void print_scanned(Query *q) {
+    printf("(%ld of %ld blocks scanned, %ld skipped by min/max)\n", q->blocks - q->skipped, q->blocks, q->skipped);
+}
+
+static void query_info(const HistoryFile *file) {
+    size_t off = 0;
+    Block b;
+    long blocks = 0;
+    uint64_t rows = 0, games = 0;
+
+    while (history_next(file, &off, &b)) {
+        blocks++;
+        rows += b.h->rows;
+        games += b.h->games;
+    }
+    printf("%ld blocks, %llu moves, %llu games, %zu bytes (%.1f bytes per move)\n", blocks,
+        (unsigned long long)rows, (unsigned long long)games, file->size, rows ? (double)file->size / rows : 0.0);
+}
+
+static void query_count(const HistoryFile *file, Query *q, int avg_column) {
+    size_t off = 0;
+    Block b;
+    uint64_t count = 0, sum = 0;
+
+    while (history_next(file, &off, &b)) {
+        uint8_t *m = block_select(q, &b);
+        if (!m) continue;
+        count += mask_count(m, b.h->rows);
+        if (avg_column >= 0) sum += mask_sum(&b, avg_column, m, b.h->rows);
+    }
+
+    if (avg_column >= 0)
+        printf("avg %s: %.3f over %llu moves\n", column_names[avg_column], count ? (double)sum / count : 0.0,
+            (unsigned long long)count);
+    else
+        printf("%llu moves\n", (unsigned long long)count);
+    print_scanned(q);
+}
+
+static void query_hist(const HistoryFile *file, Query *q, int column) {
+    size_t off = 0;
+    Block b;
+    uint64_t bins[256] = {0};
+
+    while (history_next(file, &off, &b)) {
+        uint8_t *m = block_select(q, &b);
+        if (!m) continue;
+        const uint8_t *c = b.col[column];
+        for (uint32_t i = 0; i < b.h->rows; i++) bins[c[i]] += m[i] & 1;
+    }
+
+    for (int v = 0; v < 256; v++) {
+        if (bins[v] == 0) continue;
+        char label[32];
+        if (column == HIST_COL_CARD) card_name(v, label, sizeof(label));
+        else if (column == HIST_COL_ACTION && v < 7) snprintf(label, sizeof(label), "%s", action_names[v]);
+        else snprintf(label, sizeof(label), "%d", v);
+        printf("%-16s %llu\n", label, (unsigned long long)bins[v]);
+    }
+    print_scanned(q);
+}
+
+// Per-game table only, the move columns are not touched
+static void query_turns(const HistoryFile *file) {
+    size_t off = 0;
+    Block b;
+    uint64_t games[256] = {0}, turns[256] = {0}, won[256] = {0};
+
+    while (history_next(file, &off, &b)) {
+        for (uint32_t g = 0; g < b.h->games; g++) {
+            const HistoryGame *hg = &b.games[g];
+            games[hg->players]++;
+            turns[hg->players] += hg->turns;
+            won[hg->players] += hg->winner != HISTORY_NO_WINNER;
+        }
+    }
+
+    printf("%-8s %10s %12s %10s\n", "players", "games", "avg turns", "finished");
+    for (int p = 0; p < 256; p++) {
+        if (games[p] == 0) continue;
+        printf("%-8d %10llu %12.1f %9.1f%%\n", p, (unsigned long long)games[p],
+            (double)turns[p] / games[p], 100.0 * won[p] / games[p]);
+    }
+}
+
+// Deal rows of <card> are selected with the scans, then counted per seat of each
+// game; games and their rows are stored in the same order inside a block.
+static void query_winrate(const HistoryFile *file, Query *q, uint32_t min) {
+    size_t off = 0;
+    Block b;
+    uint64_t players = 0, wins = 0, seats = 0, games_won = 0;
+
+    while (history_next(file, &off, &b)) {
+        for (uint32_t g = 0; g < b.h->games; g++) {
+            seats += b.games[g].players;
+            games_won += b.games[g].winner != HISTORY_NO_WINNER;
+        }
+
+        uint8_t *m = block_select(q, &b);
+        if (!m) continue;
+        const uint32_t *game = (const uint32_t *)b.col[HIST_COL_GAME];
+        const uint8_t *player = b.col[HIST_COL_PLAYER];
+        uint32_t g = 0, held[256] = {0};
+        bool any = false;
+
+        for (uint32_t i = 0; i <= b.h->rows; i++) {
+            bool next_game = i == b.h->rows || game[i] != b.games[g].game;
+            if (next_game && any) {
+                for (int p = 0; p < b.games[g].players; p++) {
+                    if (held[p] < min) continue;
+                    players++;
+                    wins += b.games[g].winner == p;
+                }
+                memset(held, 0, sizeof(held));
+                any = false;
+            }
+            if (i == b.h->rows) break;
+            while (game[i] != b.games[g].game && g + 1 < b.h->games) g++;
+            if (m[i]) {
+                held[player[i]]++;
+                any = true;
+            }
+        }
+    }
+
+    printf("%llu players were dealt %u or more: %llu won (%.1f%%), every seat: %.1f%%\n",
+        (unsigned long long)players, min, (unsigned long long)wins, players ? 100.0 * wins / players : 0.0,
+        seats ? 100.0 * games_won / seats : 0.0);
+    print_scanned(q);
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = HISTORY_FILE;
+    Query q = {0};
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:a:c:p:t:h:g:")) != -1) {
+        // every option but -f adds a filter, check there is room before taking one
+        if (opt != 'f' && opt != '?' && q.count == MAX_FILTERS) {
+            fprintf(stderr, "histq: at most %d filters\n", MAX_FILTERS);
+            return 1;
+        }
+        Filter *f = &q.filters[q.count];
+        bool ok = true;
+
+        switch (opt) {
+        case 'f':
+            path = optarg;
+            continue;
+        case 'a':
+            f->column = HIST_COL_ACTION;
+            ok = false;
+            for (int a = 0; a < 7; a++) {
+                if (strcmp(optarg, action_names[a]) == 0) {
+                    f->lo = f->hi = a;
+                    ok = true;
+                }
+            }
+            break;
+        case 'c':
+            ok = parse_card(optarg, f);
+            break;
+        case 'p':
+        case 't':
+        case 'h':
+        case 'g':
+            f->column = opt == 'p' ? HIST_COL_PLAYER : opt == 't' ? HIST_COL_TURN
+                      : opt == 'h' ? HIST_COL_HAND : HIST_COL_GAME;
+            ok = parse_range(optarg, &f->lo, &f->hi);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+        if (!ok) {
+            fprintf(stderr, "histq: bad filter -%c %s\n", opt, optarg);
+            return 1;
+        }
+        q.count++;
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    HistoryFile file;
+    if (!history_map(path, &file)) return 1;
+
+    const char *query = argv[optind];
+    const char *arg = optind + 1 < argc ? argv[optind + 1] : NULL;
+    int column = arg ? column_from_name(arg) : -1;
+
+    if (strcmp(query, "info") == 0) {
+        query_info(&file);
+    } else if (strcmp(query, "count") == 0) {
+        query_count(&file, &q, -1);
+    } else if (strcmp(query, "avg") == 0 && column >= 0 && column != HIST_COL_CARD && column != HIST_COL_ACTION) {
+        query_count(&file, &q, column);
+    } else if (strcmp(query, "hist") == 0 && column >= HIST_COL_PLAYER) {
+        query_hist(&file, &q, column);
+    } else if (strcmp(query, "turns") == 0) {
+        query_turns(&file);
+    } else if (strcmp(query, "winrate") == 0 && arg && q.count + 2 <= MAX_FILTERS) {
+        Filter *f = &q.filters[q.count];
+        if (!parse_card(arg, f)) {
+            fprintf(stderr, "histq: unknown card %s\n", arg);
+            return 1;
+        }
+        q.filters[++q.count] = (Filter){ .column = HIST_COL_ACTION, .lo = HIST_DEAL, .hi = HIST_DEAL };
+        q.count++;
+        uint32_t min = optind + 2 < argc ? strtoul(argv[optind + 2], NULL, 10) : 2;
+        query_winrate(&file, &q, min > 0 ? min : 1);
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+
+    free(mask);
+    if (file.base) munmap((void *)file.base, file.size);
+    return 0;
+}
@@ -1,1013 +1,5388 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <time.h>
-#include <ctype.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <sys/wait.h>
-#include <fcntl.h>
-#include <semaphore.h>
-#include <pthread.h>
-#include <sys/mman.h>
-#include <stdint.h>
-#include <stdbool.h>
-#include <signal.h>
-
-// implement a global flag to show server is running
-volatile sig_atomic_t server_running = 1;
-
-#define LOG_QUEUE_SIZE 50
-#define LOG_MSG_LEN 100
-#define NAME_SIZE 50
-#define START_CARD_DECK 7
-#define JOIN_FIFO "/tmp/join_fifo"
-#define MAX_HAND_SIZE 64
-#define DECK_SIZE 220
-#define MAX_PLAYERS 6
-
-typedef enum cardColor {
-    CARD_COLOUR_RED = 0,
-    CARD_COLOUR_BLUE = 1,
-    CARD_COLOUR_GREEN = 2,
-    CARD_COLOUR_YELLOW = 3,
-    CARD_COLOUR_BLACK = 4 
-} cardColour;
-
-typedef enum cardType {
-    CARD_NUMBER_TYPE = 0,
-    CARD_SKIP_TYPE = 1,
-    CARD_REVERSE_TYPE = 2,
-    CARD_DRAW_TWO_TYPE = 3,
-    CARD_WILD_TYPE = 4,
-    CARD_WILD_DRAW_FOUR_TYPE = 5
-} cardType;
-
-typedef enum cardValue {
-    CARD_VALUE_NONE = -1,
-    CARD_VALUE_0 = 0,
-    CARD_VALUE_1 = 1,
-    CARD_VALUE_2 = 2,
-    CARD_VALUE_3 = 3,
-    CARD_VALUE_4 = 4,
-    CARD_VALUE_5 = 5,
-    CARD_VALUE_6 = 6,
-    CARD_VALUE_7 = 7,
-    CARD_VALUE_8 = 8,
-    CARD_VALUE_9 = 9,
-    CARD_VALUE_SKIP = 10,
-    CARD_VALUE_REVERSE = 11,
-    CARD_VALUE_DRAW_TWO = 12,
-    CARD_VALUE_WILD = 13,
-    CARD_VALUE_WILD_DRAW_FOUR = 14
-} cardValue;
-
-typedef struct {
-  cardColour colour;
-  cardType type;
-  cardValue value;
-} Card;
-
-// 4 cards of each colour, of each type (+4 is 8 copies)
-typedef struct deck
-{
-    Card deckCards[DECK_SIZE];
-    uint8_t top_index;
-} Deck;
-int w;
-
-typedef struct {
-    char player_name[NAME_SIZE];
-    pid_t pid;
-    int is_active;
-    Card hand_cards[MAX_HAND_SIZE];
-    uint8_t hand_size;
-} Player;
-
-typedef enum GameDirection
-{
-    GAME_DIRECTION_NONE = 0,
-    GAME_DIRECTION_LEFT = -1,
-    GAME_DIRECTION_RIGHT = 1
-} GameDirection;
-
-typedef struct {
-    char queue[LOG_QUEUE_SIZE][LOG_MSG_LEN];
-    int head; 
-    int tail;
-    // semaphore function (mostly for logging)
-    sem_t count;
-    sem_t space_left;
-    pthread_mutex_t lock;
-} LogQueue;
-
-typedef struct {
-  Deck deck;
-  Player players[MAX_PLAYERS];
-  Card played_cards[DECK_SIZE];
-  uint8_t current_card_idx;
-
-  LogQueue logger;
-  int num_players;
-  int current_player;
-  int next_player;
-  int winner_pid; // 0 = No winner determined
-  int direction; // 1 = Clockwise | 1 == Anti-clockwise
-  int game_over;
-
-  // Sync prmitives for the Game State
-  pthread_mutex_t game_lock;
-  pthread_cond_t turn_cond;
-
-  // store player moves (card being played)
-  char stored_move[64];      // input from player is stored
-  int move_ready;           // 0 = not ready, 1 = waiting
-  int player_move_index;   //index of player send
-
-} GameState;
-GameState *shm;
-
-void signal_handler(int sig);
-void enqueue_log(char *msg);
-void *logger_thread_func(void *arg);
-void player_add_card(Player *player, Card new_card);
-void check_for_uno(Player *player, GameState *game, int uno_declaration);
-void decide_next_player(GameState *game);
-void deckInit(Deck *onoDeck);
-void deckShuffle(Deck *onoDeck);
-void execute_card_effect(Card *c, GameState *game, int wild_colour);
-void execute_wild_card(GameState *game, int wild_colour);
-bool check_for_winner(Player *player);
-bool player_turn(int player_index, GameState *game);
-bool player_play_card(Player *player, uint8_t card_played, GameState *game, int wild_colour);
-void reap_child_processes(Player *player);
-
-void signal_handler(int signal){
-
-    (void)signal; // avoiding parameter warning by casting to void
-    server_running = 0;
-
-    if (shm) {
-        pthread_cond_broadcast(&shm->turn_cond);
-    }
-}
-
-Card deckDraw(Deck *onoDeck)
-{
-    if (onoDeck->top_index >= DECK_SIZE)
-    {
-        onoDeck->top_index = 0;
-        deckShuffle(onoDeck);
-    }
-
-    return onoDeck->deckCards[onoDeck->top_index++];
-}
-
-#ifndef CARD
-#define CARD
-
-// For displaying cards
-bool playable_card(Card *card, Card *top_card)
-{
-    // Card is playable when
-    // 1. Same value as top card
-    // 2. Same colour as top card
-    // 3. The card is a wild card5
-    // 4. Same card type as top card
-
-    // Check if same value
-    if ((card->value != CARD_VALUE_NONE && top_card->value != CARD_VALUE_NONE) && card->value == top_card->value)
-    {
-        return true;
-    }
-
-    // Check for same colour
-    else if (card->colour == top_card->colour || top_card->colour == CARD_COLOUR_BLACK)
-    {
-        return true;
-    }
-
-    // Check for same card type
-    else if ((card->type != CARD_NUMBER_TYPE && top_card->type != CARD_NUMBER_TYPE) && card->type == top_card->type)
-    {
-        return true;
-    }
-
-    // Check for wild cards
-    else if (card->type == CARD_WILD_TYPE || card->type == CARD_WILD_DRAW_FOUR_TYPE)
-    {
-        return true;
-    }
-
-    else
-    {
-        return false;
-    }
-}
-
-const char *get_colour_name(cardColour c)
-{
-    switch (c)
-    {
-    case CARD_COLOUR_RED:
-        return "Red";
-    case CARD_COLOUR_BLUE:
-        return "Blue";
-    case CARD_COLOUR_GREEN:
-        return "Green";
-    case CARD_COLOUR_YELLOW:
-        return "Yellow";
-    case CARD_COLOUR_BLACK:
-        return "Wild";
-    default:
-        return "Unknown";
-    }
-}
-
-void display_card(Card *card)
-{
-    printf("[%d (%s)]", card->value, get_colour_name(card->colour));
-}
-
-void execute_reverse_card(GameState *game)
-{
-    game->direction *= -1;
-
-    int n = game->num_players;
-    game->next_player = (game->current_player + game->direction + n) % n;
-}
-
-void execute_skip_card(GameState *game)
-{
-    int n = game->num_players;
-    game->next_player = (game->next_player + game->direction + n) % n;
-}
-
-void execute_draw_two_card(GameState *game)
-{
-    game->players[game->next_player].hand_cards[game->players[game->next_player].hand_size++] = deckDraw(&game->deck);
-    game->players[game->next_player].hand_cards[game->players[game->next_player].hand_size++] = deckDraw(&game->deck);
-
-    int n = game->num_players;
-    game->next_player = (game->current_player + game->direction + n) % n;
-}
-
-void execute_wild_card(GameState *game, int wild_colour)
-{
-    if (wild_colour >= 1 && wild_colour <= 4) {
-        // Map 1-4 to enum 0-3 (Red=0, Blue=1, Green=2, Yellow=3)
-        game->played_cards[game->current_card_idx].colour = (cardColour)(wild_colour - 1);
-    } else {
-        // Default to Red if user didn't pick
-        game->played_cards[game->current_card_idx].colour = CARD_COLOUR_RED;
-    }
-}
-
-// For when a player plays a power card/wild card
-void execute_card_effect(Card *c, GameState *game, int wild_colour)
-{
-    switch (c->value)
-    {
-    case CARD_VALUE_SKIP:
-        execute_skip_card(game);
-        break;
-    case CARD_VALUE_REVERSE:
-        execute_reverse_card(game);
-        break;
-    case CARD_VALUE_DRAW_TWO:
-        execute_draw_two_card(game);
-        break;
-    case CARD_VALUE_WILD:
-        execute_wild_card(game, wild_colour);
-        break;
-    case CARD_VALUE_WILD_DRAW_FOUR:
-        execute_wild_card(game, wild_colour);
-        for(int i = 0; i < 4; i++) {
-            int victim = (game->current_player + game->direction + game->num_players) % game->num_players;
-            player_add_card(&game->players[victim], deckDraw(&game->deck));
-        }
-        break;
-    default:
-        break;
-    }
-}
-
-#endif // CARD
-
-// Jason
-#ifndef PLAYER
-#define PLAYER
-#define MAX_HAND_SIZE 64
-
-void player_init(Player *player, const char *name)
-{
-    strncpy(player->player_name, name, NAME_SIZE - 1); // copy the name given into the player itself
-    player->hand_size = 0;                             // Cards given during start of round
-}
-
-bool player_play_card(Player *player, uint8_t card_played, GameState *game, int wild_colour)
-{
-    Card *chosen_card = &player->hand_cards[card_played];
-    Card *top_card = &game->played_cards[game->current_card_idx];
-
-    if (!playable_card(chosen_card, top_card))
-    {
-        printf("> Invalid card played! Card not playable on top of pile.\n");
-        return false;
-    }
-    game->played_cards[++game->current_card_idx] = *chosen_card;
-
-    player->hand_cards[card_played] = player->hand_cards[player->hand_size - 1]; // Replace played card with last card
-    player->hand_size--;
-
-    execute_card_effect(&game->played_cards[game->current_card_idx], game, wild_colour);
-    return true;
-}
-
-// For displaying the Player's hand
-int player_check_hand(Player *player)
-{
-    for (int i = 0; i < player->hand_size - 1; i++)
-    {
-        Card hand_card = player->hand_cards[i];
-        display_card(&hand_card);
-    }
-    return 0;
-}
-
-bool player_turn(int player_index, GameState *game) {
-  Player *P = &game->players[player_index];
-  char *cmd = game->stored_move;
-  char msg[100];
-
-  if (strncmp(cmd, "DRAW", 4) == 0) {
-    printf("> You draw a card...");
-    Card card_drawn = deckDraw(&game->deck);
-    player_add_card(P, card_drawn);
-
-    //Sending message to game.log
-    snprintf(msg, sizeof(msg), "Player %s drew a card", P->player_name);
-    enqueue_log(msg);
-    return true;
-  } else if (strncmp(cmd, "MOVE", 4) == 0) {
-    int card_index;
-    int colour_code = 0; // Default 0
-    int uno_declaration = 0;
-
-    // Get the Index and colour after cmd "MOVE"
-    if(P->hand_size == 2){
-        sscanf(cmd + 5, "%d %d", &card_index, &uno_declaration);
-    }
-    else{
-    sscanf(cmd + 5, "%d %d", &card_index, &colour_code);
-    }
-
-    // Since client sends 1-based index, Server need to convert to 0-based
-    int actual_index = card_index - 1;
-
-    if (actual_index >= 0 && actual_index < P->hand_size) {
-
-        bool move_successful = player_play_card(P, actual_index, game, colour_code);
-
-        if (move_successful)
-        {
-            Card *c = &game->played_cards[game->current_card_idx];
-            printf("> Player %s played card %d (%s)\n", P->player_name, c->value, get_colour_name(c->colour));
-            // Send the card Details for logging
-            snprintf(msg, sizeof(msg), "Player %s played %d (%s)", P->player_name, c->value, get_colour_name(c->colour));
-            enqueue_log(msg);
-
-            check_for_uno(P, game, uno_declaration);
-            return true;
-        } else {
-            return false;
-        }
-        
-    
-    } else {
-    Card *c = &game->played_cards[game->current_card_idx];
-    printf("Error: Player %s tried invalid index %d (%s)\n", P->player_name, c->value, get_colour_name(c->colour));
-    //Sending message to game.log
-    snprintf(msg, sizeof(msg), "Player %s tried invalid play index %d (%s)", P->player_name, c->value, get_colour_name(c->colour));
-    enqueue_log(msg);
-
-    //PENALTY: DRAW A CARD
-    player_add_card(P, deckDraw(&game->deck));
-
-    return false;
-    }
-  }
-  return false;
-}
-
-#endif
-
-void format_card_to_string(Card *c, char *buffer) {
-    const char *colour = get_colour_name(c->colour);
-
-    if (c->type == CARD_NUMBER_TYPE) {
-        sprintf(buffer, "%d (%s)", c->value, colour);
-    } else {
-        const char *type_str;
-        switch (c->type) {
-            case CARD_SKIP_TYPE: type_str = "SKIP"; break;
-            case CARD_REVERSE_TYPE: type_str = "REVERSE"; break;
-            case CARD_DRAW_TWO_TYPE: type_str = "DRAW TWO"; break;
-            case CARD_WILD_TYPE: type_str = "WILD"; break;
-            case CARD_WILD_DRAW_FOUR_TYPE: type_str = "WILD DRAW FOUR"; break;
-            default: type_str = "UNKNOWN"; break;
-        }
-        sprintf(buffer, "%s %s", type_str, colour);
-    }
-}
-
-void check_for_uno(Player *player, GameState *game, int uno_declaration){  
-    if(player->hand_size == 1){
-        if(uno_declaration == 0){
-            printf("Uh oh! You didn't say Uno! You'll now draw two cards!");
-            player->hand_cards[player->hand_size++] = deckDraw(&game->deck);
-            player->hand_cards[player->hand_size++] = deckDraw(&game->deck);
-        }
-        else{
-            printf("Player %d has declared uno!", game->current_player);
-        }
-    }
-}
-
-void deckInit(Deck *onoDeck)
-{
-    uint8_t top_index = 0;
-    int w = 0;
-    // Adding coloured cards into the deck
-    for (int i = 0; i < 4; i++)
-    {
-        // Number cards (0-9)
-        for (int j = 0; j < 10; j++)
-        {
-          // Creating 4 copies of the number card
-          for (int k = 0; k < 4; k++) {
-            onoDeck->deckCards[top_index++] = (Card){
-              .colour = (cardColour)i,
-              .type = CARD_NUMBER_TYPE,
-              .value = (uint8_t)j};
-            }
-        }
-
-        // Power cards (Skip [10], Reverse[11], Draw Two[12])
-        for (int l = 10; l < 13; l++)
-        {
-            // Ensuring the card is given its correct cardType
-            switch (l)
-            {
-            case 10:
-                w = 1;
-                break;
-            case 11:
-                w = 2;
-                break;
-            case 12:
-                w = 3;
-                break;
-            }
-            // Creating 4 copies of the power cards
-            for (int m= 1; m < 4; m++)
-            {
-                onoDeck->deckCards[top_index++] = (Card){
-                    .colour = (cardColour)i,
-                    .type = (cardType)w,
-                    .value = (uint8_t)l};
-            }
-        }
-    }
-
-    // 4 Wild Cards
-    for (int l = 0; l < 4; l++)
-    {
-        onoDeck->deckCards[top_index++] = (Card){
-            .colour = CARD_COLOUR_BLACK,
-            .type = CARD_WILD_TYPE,
-            .value = CARD_VALUE_WILD};
-    }
-
-    // 8 Wild Card Draw Fours
-    for (int m = 0; m < 8; m++)
-    {
-        onoDeck->deckCards[top_index++] = (Card){
-            .colour = CARD_COLOUR_BLACK,
-            .type = CARD_WILD_DRAW_FOUR_TYPE,
-            .value = CARD_VALUE_WILD_DRAW_FOUR};
-    }
-
-    // Ensure pointer is now at top card
-    onoDeck->top_index = 0;
-}
-
-void deckShuffle(Deck *onoDeck)
-{
-    // Random Number Generator Seed
-    for (int i = DECK_SIZE - 1; i > 0; i--)
-    {
-        int j = rand() % (i + 1); // Generate Random Number between 0 to DECK_SIZE (220)
-        Card temp = onoDeck->deckCards[i];
-        onoDeck->deckCards[i] = onoDeck->deckCards[j];
-        onoDeck->deckCards[j] = temp;
-    }
-}
-
-void player_add_card(Player *player, Card new_card)
-{
-    if (player->hand_size < MAX_HAND_SIZE)
-    {
-        player->hand_cards[player->hand_size] = new_card;
-        player->hand_size++;
-    }
-}
-
-bool check_for_winner(Player *player)
-{
-    if(player->hand_size == 0){
-        shm->winner_pid = player->pid;
-        shm->game_over = 1;
-        return true;
-    }
-  return false;
-}
-
-void decide_next_player(GameState *game)
-{
-    int n = game->num_players;
-    int attempts = 0;
-
-    game->current_player = (game->next_player + n) % n;
-
-    while(!game->players[game->current_player].is_active && attempts < n) {
-        game->current_player = (game->current_player + game->direction + n) % n;
-        attempts++;
-    }
-
-    game->next_player = (game->current_player + game->direction + n) % n;
-
-    attempts = 0;
-    while(!game->players[game->next_player].is_active && attempts < n) {
-        game->next_player = (game->next_player + game->direction + n) % n;
-        attempts++;
-    }
-}
-
-// Pass logging mechanism
-void enqueue_log(char *msg) {
-    time_t now = time(NULL);
-
-    struct tm t;
-    localtime_r(&now, &t);
-
-    char timed_msg[LOG_MSG_LEN];
-
-    int time_len = strftime(timed_msg, LOG_MSG_LEN, "[%H:%M:%S] ", &t);
-    
-    snprintf(timed_msg + time_len, LOG_MSG_LEN - time_len, "%s", msg);
-
-    sem_wait(&shm->logger.space_left);
-    pthread_mutex_lock(&shm->logger.lock);    
-    
-    strncpy(shm->logger.queue[shm->logger.tail], timed_msg, LOG_MSG_LEN - 1);
-    shm->logger.queue[shm->logger.tail][LOG_MSG_LEN - 1] = '\0';
-    
-    shm->logger.tail = (shm->logger.tail + 1) % LOG_QUEUE_SIZE;
-    
-    pthread_mutex_unlock(&shm->logger.lock);
-    sem_post(&shm->logger.count);
-}
-
-// THE ACTUAL THREAD LOGGING
-void *logger_thread_func(void *arg) {
-    LogQueue *lq = (LogQueue *)arg;
-
-    FILE *fp = fopen("game.log", "a");
-    if (!fp) {
-        perror("Logger failed to open file");
-        pthread_exit(NULL);
-    }
-
-    while (1) {
-        sem_wait(&lq->count);
-
-        pthread_mutex_lock(&lq->lock);
-
-        char buffer[LOG_MSG_LEN];
-        strcpy(buffer, lq->queue[lq->head]);
-
-        lq->head = (lq->head + 1) % LOG_QUEUE_SIZE;
-
-        pthread_mutex_unlock(&lq->lock);
-        sem_post(&lq->space_left);
-
-        fprintf(fp, "%s\n", buffer);
-        fflush(fp); // Ensure it saves immediately
-
-        if (strcmp(buffer, "SERVER_SHUTDOWN") == 0) break;
-    }
-
-    fclose(fp);
-    return NULL;
-}
-
-// If player disconnect
-void handle_disconnect(int player_index, char *player_name, int fd) {
-    char log_msg[LOG_MSG_LEN];
-
-    snprintf(log_msg, LOG_MSG_LEN, "DISCONNECT: Player %s (Index %d) left.", player_name, player_index);
-    enqueue_log(log_msg);
-
-    if (fd != -1) {
-        close(fd);
-    }
-
-    printf("Player %s disconnected. Cleaning up child process...\n", player_name);
-    shm->players[player_index].is_active = 0;
-
-    pthread_mutex_lock(&shm->game_lock);
-    shm->move_ready = 1;
-    shm->player_move_index = player_index;
-    pthread_cond_broadcast(&shm->turn_cond);
-    pthread_mutex_unlock(&shm->game_lock);
-    exit(0);
-}
-
-void update_player_client(int player_index, int pipe_fd) {
-    char msg[1024] = {0};
-    char card_str[50];
-
-    // Send top card on pile
-    Card *top_card = &shm->played_cards[shm->current_card_idx];
-    format_card_to_string(top_card, card_str);
-
-    strcat(msg, "PILE:");
-    strcat(msg, card_str);
-    strcat(msg, "\n");
-
-    // Send player's hand
-    strcat(msg, "HAND:");
-    Player *P = &shm->players[player_index];
-
-    for (int i = 0; i < P->hand_size; i++) {
-        format_card_to_string(&P->hand_cards[i], card_str);
-        strcat(msg, card_str);
-
-        // Add comma if not the last card
-        if (i < P->hand_size - 1) {
-            strcat(msg, ",");
-        }
-    }
-    strcat(msg, "\n");
-
-    // Send the message to the player
-    write(pipe_fd, msg, strlen(msg));
-}
-
-int get_card_score(Card *c) {
-    if (c->type == CARD_NUMBER_TYPE) {
-        return c->value;
-    } else if (c->type == CARD_WILD_TYPE || c->type == CARD_WILD_DRAW_FOUR_TYPE) {
-        return 50;
-    } else {
-        return 20;
-    }
-}
-
-void save_scores(GameState *game) {
-    FILE *fp = fopen("scores.txt", "a");
-    if (!fp) {
-        perror("Failed to open scores.txt");
-        return;
-    }
-
-    time_t now = time(NULL);
-    char *time_str = ctime(&now);
-    time_str[strcspn(time_str, "\n")] = '\0';
-
-    fprintf(fp, "[%s] GAME SCORES: ", time_str);
-    printf("\nSaving Final Scores:\n");
-
-    for (int i = 0; i < game->num_players; i++) {
-        Player *P = &game->players[i];
-        int total_score = 0;
-
-        for (int j = 0; j < P->hand_size; j++) {
-            total_score += get_card_score(&P->hand_cards[j]);
-        }
-
-        fprintf(fp, "%s: %d points; ", P->player_name, total_score);
-        printf(" - %s: %d points\n", P->player_name, total_score);
-    }
-
-    fprintf(fp, "\n");
-    fclose(fp);
-    printf("Scores saved to scores.txt\n");
-}
-// function to clean up child processes of disconnected players
-void reap_child_processes(Player *player) {
-    
-    pid_t check = waitpid(player->pid, NULL, WNOHANG);
-
-    if(check > 0){
-        char log_msg[LOG_MSG_LEN];
-        snprintf(log_msg, LOG_MSG_LEN, "Child %s with PID of %d has been reaped after disconnection.", player->player_name, player->pid);
-        enqueue_log(log_msg);
-        }
-    else if(check == -1){
-        perror("reaping child process failed");
-    }
-}
-        
-// Game starts
-int main() {
-    signal(SIGINT, signal_handler); // handles server shutdown via Ctrl+C
-    signal(SIGPIPE, SIG_IGN); // Ignore SIGPIPE to prevent crashes on broken pipes
-    int num_players = 0;
-    int countdown = 60;
-    char player_names[5][NAME_SIZE];
-    int client_pid_list[5];
-    char raw_buffer[128];
-
-    int player_pipes[5];
-    for (int i=0; i<5; i++)
-        player_pipes[i] = -1;
-
-    shm = mmap(NULL, sizeof(GameState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-
-    if(shm == MAP_FAILED) {
-      perror("mmap failed");
-      return 1;
-    }
-
-    // Initialize Sync Premitives in Shared Memory
-    sem_init(&shm->logger.count, 1, 0); 
-    sem_init(&shm->logger.space_left, 1, LOG_QUEUE_SIZE);
-    pthread_mutexattr_t attr;
-    pthread_mutexattr_init(&attr);
-    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
-    pthread_mutex_init(&shm->logger.lock, &attr);
-
-    pthread_mutex_init(&shm->game_lock, &attr);
-
-    pthread_condattr_t cattr;
-    pthread_condattr_init(&cattr);
-    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
-    pthread_cond_init(&shm->turn_cond, &cattr);
-
-    pthread_t log_tid;
-    pthread_create(&log_tid, NULL, logger_thread_func, (void *)&shm->logger);
-
-    unlink(JOIN_FIFO); // Remove any existing FIFO
-    if (mkfifo(JOIN_FIFO, 0666) == -1) {
-        perror("Failed to create join FIFO");
-        enqueue_log("Failed to create join FIFO");
-        return 1;
-    }
-
-    int join_fd = open(JOIN_FIFO, O_RDONLY | O_NONBLOCK);
-    if (join_fd == -1) {
-        perror("Failed to open join FIFO");
-        enqueue_log("Failed to open join FIFO");
-        unlink(JOIN_FIFO);
-        return 1;
-    }
-
-    enqueue_log("Server started, waiting for players to join.");
-
-    for (int i = countdown; i > 0 && server_running ; i--) { 
-        int n = read(join_fd, raw_buffer, sizeof(raw_buffer)-1);
-        if (n > 0) {
-            raw_buffer[n] = '\0';
-            char *line = strtok(raw_buffer, "\n");
-
-            while (line != NULL) {
-                int client_pid;
-                char temp_name[NAME_SIZE];
-                if (sscanf(line, "%d %49[^\n]", &client_pid, temp_name) == 2) {
-                    if (num_players < 5) {
-                        strncpy(player_names[num_players], temp_name, NAME_SIZE);
-                        client_pid_list[num_players] = client_pid;
-
-                        strncpy(shm->players[num_players].player_name, temp_name, NAME_SIZE);
-                        shm->players[num_players].pid = client_pid;
-                        shm->players[num_players].is_active = 1;
-                        shm->players[num_players].hand_size = 0;
-
-                        char log_msg[LOG_MSG_LEN];
-                        snprintf(log_msg, LOG_MSG_LEN, "Player joined: %s (PID: %d)", temp_name, client_pid);
-                        enqueue_log(log_msg);
-                        
-                        char client_fifo[64];
-                        snprintf(client_fifo, 64, "/tmp/client_%d", client_pid);
-                        int c_fd = open(client_fifo, O_WRONLY);
-                        if (c_fd != -1) {
-                            write(c_fd, "Welcome to the game!\n", 21);
-                            player_pipes[num_players] = c_fd;
-                        }
-
-                        num_players++;
-                        shm->num_players = num_players;
-                    }
-                }
-                line = strtok(NULL, "\n");
-            }
-        }
-
-        printf("\033[2J\033[H"); // Clear Screen and move cursor to top
-        printf("Initiated Server Client of Ono Card Ono Game\n");
-        printf("Waiting for players to join...\n");
-        printf("Current players: %d\n", num_players);
-        printf("Time left to join: %d seconds\n", i - 1);
-        printf("Players:\n");
-        for(int p=0; p<num_players; p++)
-            printf(" - %s\n", player_names[p]);
-        fflush(stdout);
-
-        if (i == 0 && (num_players > 1 || num_players < 6))
-            break;
-
-        if (num_players == 5)
-            break;
-            
-        sleep(1);
-    }
-    close(join_fd);
-    unlink(JOIN_FIFO);
-
-    printf("\033[2J\033[H");
-    fflush(stdout);
-
-    // initialize game state
-    shm->direction = 1;
-    shm->current_player = 0;
-    shm->current_card_idx = 0;
-    shm->next_player = shm->current_player + shm->direction;
-
-    if (num_players > 1 && num_players < 6) {
-        printf("Game starting with %d players!\n", num_players);
-        for (int i = 0; i < num_players; i++) {
-            printf("Player %s\n", player_names[i]); // and then followed with line 213 for loop
-        }
-
-        deckInit(&shm->deck);
-        deckShuffle(&shm->deck);
-        
-        for (int i=0; i<num_players; i++){
-            for (int c=0; c<START_CARD_DECK; c++)
-                player_add_card(&shm->players[i], deckDraw(&shm->deck));
-        }
-
-        for (int i=0; i < num_players; i++) {
-            pid_t pid = fork();
-
-            if (pid == 0) {
-                char client_in_fifo[64];
-                snprintf(client_in_fifo, 64, "/tmp/client_%d_in", client_pid_list[i]);
-                int player_fd = open(client_in_fifo, O_RDONLY);
-                if(player_fd == -1){
-                    perror("Child failed to open player input pipe");
-                    exit(1);
-                }
-
-                while (1) {
-                    char buffer[1024];
-                    int n = read(player_fd, buffer, sizeof(buffer));
-
-                    if (n > 0) {
-                        // Process Game Move [ELSA PART]
-
-                        buffer[n] = '\0'; //convert from bytes to C string 
-                        pthread_mutex_lock(&shm->game_lock); // freeze game state, prevent others from altering
-
-                        // copy move into gamestate (store the move)
-                        strncpy(shm->stored_move, buffer, (sizeof(shm->stored_move)-1)); //minus 1 to exlude '\0'
-
-                        shm->move_ready = 1; // ready for next player's move 
-                        shm->player_move_index = i; // updates the player who sent the moves
-
-                        pthread_cond_signal(&shm->turn_cond); // wake up parent process
-                        pthread_mutex_unlock(&shm->game_lock); // unfreeze gamestate, allow others to alter
-
-                    } else if (n == 0) {
-                        handle_disconnect(i, player_names[i], player_fd);
-                    }
-                }
-                exit(0);
-            }
-        }
-        // Round Robin Scheduler, Parent Process [ELSA PART] 
-        // Check winner
-
-        while(!shm->game_over && server_running) {
-
-            pthread_mutex_lock(&shm->game_lock);// locks game
-            uint8_t player = shm->current_player;     
-            pthread_mutex_unlock(&shm->game_lock);// unlocks game
-
-            update_player_client(player, player_pipes[player]);
-
-            // inform next player of their move
-            write(player_pipes[player], "TURN\n", 5); 
-
-            pthread_mutex_lock(&shm->game_lock);
-            // wait until player finished move + make sure its the same player signaling
-            while((!shm->move_ready || shm->player_move_index != player) && server_running) {
-                pthread_cond_wait(&shm->turn_cond, &shm->game_lock);
-            }
-
-            if (!server_running) {
-                pthread_mutex_unlock(&shm->game_lock);
-                break;
-            }
-
-            // Check if the player is still active
-            if (!shm->players[player].is_active) {
-                printf("Player %s has disconnected. Skipping their turn.\n", shm->players[player].player_name);
-                shm->move_ready = 0;
-
-                decide_next_player(shm);
-
-                for(int p=0; p< shm->num_players ; p++) {
-                    if (shm->players[p].is_active) {
-                        update_player_client(p, player_pipes[p]);
-                    }
-                }
-                pthread_mutex_unlock(&shm->game_lock);
-                continue; // Skip to next iteration if player disconnected
-            }
-
-            //apply move changes 
-            bool success = player_turn(player, shm);
-            shm->move_ready = 0;
-            
-
-            if(!shm->players[player].is_active){
-                pthread_mutex_unlock(&shm->game_lock);  
-                //reap child processes if any players disconnected
-                reap_child_processes(&shm->players[player]);
-                pthread_mutex_lock(&shm->game_lock);  
-            }
- 
-            if (success) {
-                if (check_for_winner(&shm->players[player])) {
-                    shm->game_over = true;
-
-                    for (int i = 0; i < shm->num_players; i++)
-                    {
-                        write(player_pipes[i], "GAME_OVER\n", 10);
-                    }
-                    
-                } else {
-                    decide_next_player(shm);
-
-                    for(int p=0; p< shm->num_players ; p++) {
-                        if (shm->players[p].is_active) {
-                            update_player_client(p, player_pipes[p]);
-                        }
-                    }
-                }
-            } else {
-                // Invalid move, player draws a card as penalty
-                write(player_pipes[player], "INVALID_MOVE\n", 13);
-                player_add_card(&shm->players[player], deckDraw(&shm->deck));
-                update_player_client(player, player_pipes[player]);
-            }
-            pthread_mutex_unlock(&shm->game_lock);
-        }
-    } else {    
-        fprintf(stderr, "Number of players must be between 2 and 5.\n");
-        return 1;
-    }
-
-    printf("Game over! Winner PID: %d\n", shm->winner_pid);
-    save_scores(shm);
-    
-    // Close all player pipes 
-    for(int i = 0; i < num_players; i ++){
-        
-        bool check = player_pipes[i] != -1;
-        if(check){
-            close(player_pipes[i]);
-            // set the player pipes to -1 to show it is closed
-            player_pipes[i] = -1;
-        }
-    }
-
-    // Clean up the remaining child processes
-    for(int i = 0; i < num_players; i++){
-        reap_child_processes(&shm->players[i]);
-    }
-
-    // clean up shared memory 
-    if(munmap(shm, sizeof(GameState)) == -1){
-        perror("freeing shared memory failed");
-    }   
-
-    enqueue_log("SERVER_SHUTDOWN");
-    pthread_join(log_tid, NULL);
-    return 0;
-}
-
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <zlib.h>
+#include "shm_ring.h"
+#include "history.h"
+
+// implement a global flag to show server is running
+volatile sig_atomic_t server_running = 1;
+
+#define LOG_QUEUE_SIZE 50
+#define LOG_MSG_LEN 100
+#define SHARD_LOG_SLOTS 256    // lines a reactor may log before the logger catches up
+#define LOG_DRAIN_MS 100       // the logger looks at the reactors' rings at least this often
+#define NAME_SIZE 50
+#define START_CARD_DECK 7
+#define JOIN_FIFO "/tmp/join_fifo"
+#define DECK_SIZE 220
+#define MAX_PLAYERS 100      // party tables; the lobby default stays TABLE_SIZE
+#define PLAYERS_PER_DECK 10  // another deck is shuffled in for every 10 seats
+#define HAND_INITIAL_CAP 16
+#define OUTBOX_SLOTS 16
+#define OUTBOX_MSG_LEN 1024
+#define OUTBOX_STALL_MS 5000
+#define MAX_SHARDS 64
+#define HANDOFF_SLOTS 64
+#define TABLE_SIZE 5
+#define LOBBY_WAIT 60
+#define TABLE_DRAIN_MS 1000
+#define JUMP_IN_WINDOW_MS 30
+#define SEAT_QUEUE_LEN 8        // moves a seat may have waiting, a power of two
+#define JOIN_READ_SIZE 65536
+#define JOIN_LINE_MAX 128
+#define JOIN_CONNECT_MS 5000
+#define LOG_ROTATE_MB 8
+#define LOG_ROTATE_KEEP 5
+#define RESUME_GRACE_S 30
+#define SESSION_SLOTS 8192
+#define REATTACH_SLOTS 16
+#define ADMIN_SOCKET "/tmp/ono_admin.sock"
+#define ADMIN_VIEWS 1024
+#define ODDS_BUDGET_MS 20       // time spent on one estimate, however big the table
+#define ODDS_MAX_TURNS 1000     // a rollout still going by then goes to the lowest score
+#define ADMIN_SLOTS 16
+#define ADMIN_CLIENTS 8
+#define ARENA_BLOCK_SIZE (256 * 1024)
+#define ARENA_POOL_SIZE 64
+#define INPUT_POOL_MAX 128      // idle pre-forked input workers, at most
+#define DECK_POOL_SIZE 8        // shuffled decks kept ready for new tables
+#define ENDGAME_MAX_CARDS 24    // cards left in all hands together before the solver is tried
+#define ENDGAME_MAX_SEATS 6
+#define ENDGAME_MAX_PLY 48      // a win further off than this is not looked for
+#define ENDGAME_NODES 200000    // positions searched for one move, at most
+#define ENDGAME_BUDGET_MS 10    // and time spent on a hint, well inside a turn
+#define HINT_SLOTS 8            // HINT requests a reactor's solver thread may have in hand
+#define ENDGAME_TT_BITS 16      // transposition table of 2^16 entries
+
+// Per-table arena: the table, its GameState, outboxes, deck, hands and history
+// rows are all carved out of it and handed back in one go when the table ends.
+// Blocks are shared mappings, so the first one (which holds the GameState) is
+// seen by the input children; more are chained on when it fills up. Arenas of
+// finished tables wait in a pool for the next tables, blocks and all, so once
+// they have grown to the size of the games being played no memory is mapped
+// or allocated while tables come and go.
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;            // bytes mapped, this header included
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock first;       // the arena sits at the start of its own first block
+    ArenaBlock *cur;        // where allocation goes on
+    unsigned serial;        // order of creation, processes forked later have it mapped
+} Arena;
+
+#define ARENA_ALIGN(n) (((n) + 63) & ~(size_t)63)
+
+static Arena *arena_pool[ARENA_POOL_SIZE];
+static int arena_pool_len = 0;
+static pthread_mutex_t arena_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+atomic_long arena_bytes_mapped;
+atomic_uint arena_serials;  // arenas created so far
+
+static ArenaBlock *arena_map(size_t size, size_t header) {
+    ArenaBlock *b = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (b == MAP_FAILED) return NULL;
+    b->next = NULL;
+    b->size = size;
+    b->used = ARENA_ALIGN(header);
+    atomic_fetch_add(&arena_bytes_mapped, size);
+    return b;
+}
+
+Arena *arena_new(void) {
+    Arena *a = (Arena *)arena_map(ARENA_BLOCK_SIZE, sizeof(Arena));
+    if (!a) return NULL;
+    a->cur = &a->first;
+    a->serial = atomic_fetch_add(&arena_serials, 1) + 1; // only once it is mapped
+    return a;
+}
+
+// Zeroed memory from the arena, NULL only if a new block could not be mapped
+void *arena_alloc(Arena *a, size_t size) {
+    ArenaBlock *b = a->cur;
+
+    size = ARENA_ALIGN(size);
+    // blocks chained on by an earlier table are reused before mapping more
+    while (b->size - b->used < size && b->next) b = b->next;
+    if (b->size - b->used < size) {
+        size_t want = ARENA_ALIGN(sizeof(ArenaBlock)) + size;
+        ArenaBlock *grown = arena_map(want > ARENA_BLOCK_SIZE ? want : ARENA_BLOCK_SIZE, sizeof(ArenaBlock));
+        if (!grown) return NULL;
+        b->next = grown;
+        b = grown;
+    }
+
+    void *p = (char *)b + b->used;
+    b->used += size;
+    a->cur = b;
+    memset(p, 0, size);
+    return p;
+}
+
+// Forget every allocation, keep the blocks
+void arena_reset(Arena *a) {
+    a->first.used = ARENA_ALIGN(sizeof(Arena));
+    for (ArenaBlock *b = a->first.next; b; b = b->next) b->used = ARENA_ALIGN(sizeof(ArenaBlock));
+    a->cur = &a->first;
+}
+
+void arena_release(Arena *a) {
+    ArenaBlock *b = a->first.next;
+    while (b) {
+        ArenaBlock *next = b->next;
+        atomic_fetch_sub(&arena_bytes_mapped, b->size);
+        munmap(b, b->size);
+        b = next;
+    }
+    atomic_fetch_sub(&arena_bytes_mapped, a->first.size);
+    munmap(a, a->first.size);
+}
+
+// An arena for a new table, from the pool if one is free
+Arena *arena_get(void) {
+    Arena *a = NULL;
+
+    pthread_mutex_lock(&arena_pool_lock);
+    if (arena_pool_len > 0) a = arena_pool[--arena_pool_len];
+    pthread_mutex_unlock(&arena_pool_lock);
+    return a ? a : arena_new();
+}
+
+// Give a finished table's arena back, everything in it goes at once
+void arena_put(Arena *a) {
+    arena_reset(a);
+    pthread_mutex_lock(&arena_pool_lock);
+    if (arena_pool_len < ARENA_POOL_SIZE) {
+        arena_pool[arena_pool_len++] = a;
+        a = NULL;
+    }
+    pthread_mutex_unlock(&arena_pool_lock);
+    if (a) arena_release(a);
+}
+
+// Map `count` arenas up front so the first tables do not have to
+void arena_pool_fill(int count) {
+    for (int i = 0; i < count && i < ARENA_POOL_SIZE; i++) {
+        Arena *a = arena_new();
+        if (!a) break;
+        arena_put(a);
+    }
+}
+
+static int arena_pool_count(void) {
+    pthread_mutex_lock(&arena_pool_lock);
+    int n = arena_pool_len;
+    pthread_mutex_unlock(&arena_pool_lock);
+    return n;
+}
+
+typedef enum cardColor {
+    CARD_COLOUR_RED = 0,
+    CARD_COLOUR_BLUE = 1,
+    CARD_COLOUR_GREEN = 2,
+    CARD_COLOUR_YELLOW = 3,
+    CARD_COLOUR_BLACK = 4 
+} cardColour;
+
+typedef enum cardType {
+    CARD_NUMBER_TYPE = 0,
+    CARD_SKIP_TYPE = 1,
+    CARD_REVERSE_TYPE = 2,
+    CARD_DRAW_TWO_TYPE = 3,
+    CARD_WILD_TYPE = 4,
+    CARD_WILD_DRAW_FOUR_TYPE = 5
+} cardType;
+
+typedef enum cardValue {
+    CARD_VALUE_NONE = -1,
+    CARD_VALUE_0 = 0,
+    CARD_VALUE_1 = 1,
+    CARD_VALUE_2 = 2,
+    CARD_VALUE_3 = 3,
+    CARD_VALUE_4 = 4,
+    CARD_VALUE_5 = 5,
+    CARD_VALUE_6 = 6,
+    CARD_VALUE_7 = 7,
+    CARD_VALUE_8 = 8,
+    CARD_VALUE_9 = 9,
+    CARD_VALUE_SKIP = 10,
+    CARD_VALUE_REVERSE = 11,
+    CARD_VALUE_DRAW_TWO = 12,
+    CARD_VALUE_WILD = 13,
+    CARD_VALUE_WILD_DRAW_FOUR = 14
+} cardValue;
+
+typedef struct {
+  cardColour colour;
+  cardType type;
+  cardValue value;
+} Card;
+
+// 4 cards of each colour, of each type (+4 is 8 copies), times the number of
+// decks shuffled together; deckCards is on the heap, see deckInit()/deckFree()
+typedef struct deck
+{
+    Card *deckCards;
+    int size;           // DECK_SIZE * decks
+    int top_index;
+    unsigned int seed; // per deck rand_r() state so games can run in parallel
+} Deck;
+int w;
+
+#define CARD_VALUES 15 // 0-9, skip, reverse, draw two, wild, wild draw four
+
+// Count-histogram view of a hand, kept in step with hand_cards by
+// player_add_card()/player_remove_card() so rule queries need no scan.
+// hand_cards stays the ordered view behind the client's 1-based indexes.
+typedef struct {
+    uint16_t counts[5][CARD_VALUES]; // [colour][value], black holds the wilds
+    uint16_t colour_count[5];
+    uint16_t value_count[CARD_VALUES];
+    uint8_t colour_mask;    // bit c set while a card of colour c is held
+    uint16_t value_mask;    // bit v set while a card of value v is held
+    int score;              // running get_card_score() total
+} HandIndex;
+
+typedef struct {
+    char player_name[NAME_SIZE];
+    pid_t pid;
+    pid_t input_pid; // server child reading this player's input pipe
+    int is_active;
+    uint64_t token;              // seat reclaim token handed out at join, 0 = none
+    struct timespec away_since;  // pipe closed, seat held for the grace window (zero = connected)
+    Card *hand_cards;            // grown by player_add_card(), freed by game_free()
+    Arena *arena;                // where the hand grows, NULL = heap
+    int hand_size;
+    int hand_cap;
+    unsigned hand_changes;       // bumped on every add/remove, game_publish() copies changed hands only
+    HandIndex hand_index;
+    int ring_next;               // turn ring of active seats in seat order, see seat_step()
+    int ring_prev;
+} Player;
+
+typedef enum GameDirection
+{
+    GAME_DIRECTION_NONE = 0,
+    GAME_DIRECTION_LEFT = -1,
+    GAME_DIRECTION_RIGHT = 1
+} GameDirection;
+
+typedef struct {
+    char queue[LOG_QUEUE_SIZE][LOG_MSG_LEN];
+    int head; 
+    int tail;
+    int len;
+    // semaphore function (mostly for logging)
+    sem_t count;
+    sem_t space_left;
+    pthread_mutex_t lock;
+} LogQueue;
+
+// A line a reactor logged, stamped by the logger when it writes it out
+typedef struct {
+    time_t when;
+    char msg[LOG_MSG_LEN];
+} ShardLogLine;
+
+// One line of input, a single move
+typedef struct {
+  char cmd[64];
+  uint32_t seq;              // numbered per seat from 1, in the order the lines were read
+  struct timespec arrived;   // CLOCK_MONOTONIC, taken when the input child read it
+} SeatMove;
+
+// Every seat's moves wait in their own queue, so a move sent out of turn never
+// overwrites the current player's and a burst of lines arrives whole and in order.
+// Single producer (the seat's input child) and single consumer (the reactor),
+// no lock: the child fills a slot then moves tail, the reactor reads then moves head.
+typedef struct {
+  atomic_uint head;          // next move to apply, only the reactor moves it
+  atomic_uint tail;          // next free slot, only the input child moves it
+  atomic_uint waiters;       // input child asleep on head (futex word), the queue being full
+  uint32_t next_seq;         // input child's numbering, carries on across a resume
+  SeatMove slots[SEAT_QUEUE_LEN];
+} SeatQueue;
+
+// One bit per seat, e.g. the seats whose jump-in was turned down
+#define SEAT_WORDS ((MAX_PLAYERS + 63) / 64)
+typedef struct {
+  uint64_t bits[SEAT_WORDS];
+} SeatSet;
+
+// What the clients are shown of a game: the reactor publishes one after every
+// change (still under game_lock) and serializes the PILE/HAND frames from it
+// after dropping the lock, so pipe writes never hold up the input children.
+// The hand copies are table arena memory (shared with the input children), but
+// only the owning reactor reads them.
+typedef struct {
+  uint32_t version;
+  Card top;
+  int current_player;
+  int direction;
+  int num_players;
+  int active[MAX_PLAYERS];
+  int hand_size[MAX_PLAYERS];
+  Card *hands[MAX_PLAYERS];
+  int hand_cap[MAX_PLAYERS];
+  unsigned hand_seen[MAX_PLAYERS]; // Player.hand_changes at the last copy
+} GameSnapshot;
+
+typedef struct {
+  Deck deck;
+  Player players[MAX_PLAYERS];
+  Card played_cards[DECK_SIZE]; // the pile, a ring: only the top card is ever read
+  int current_card_idx;
+
+  int num_players;
+  int active_players;  // seats still in the turn ring
+  int current_player;
+  int next_player;
+  int winner_pid; // 0 = No winner determined
+  int direction; // 1 = Clockwise | 1 == Anti-clockwise
+  int game_over;
+  int quiet; // headless games (tournaments, simulations): no stdout, no game.log
+  Arena *arena; // owns hands and deck for a server table, NULL = heap
+
+  // Sync prmitives for the Game State
+  pthread_mutex_t game_lock;
+
+  // store player moves (card being played)
+  char stored_move[64];      // move being applied by the scheduler
+  SeatQueue moves[MAX_PLAYERS]; // input of every seat, in turn or not
+  atomic_int moves_ready;       // moves in all the queues, so arbitration can skip the scan
+
+  GameSnapshot snap;         // written and read by the owning reactor only
+
+} GameState;
+
+// Moves are printed on the server's terminal as well, but only while it plays a
+// single game: with reactors every table would queue on stdout's lock
+bool echo_moves = true;
+
+static inline bool game_echo(GameState *game) {
+    return !game->quiet && echo_moves;
+}
+// Logger queue is shared by every table and every input child
+LogQueue *logq;
+
+// Outbound queue per client, only the parent process touches these
+typedef enum OutboxMsgKind {
+    OUTBOX_MSG_EVENT = 0,  // TURN, INVALID_MOVE, GAME_OVER (never dropped)
+    OUTBOX_MSG_STATE = 1   // PILE/HAND frame, a newer one replaces a stale one
+} OutboxMsgKind;
+
+typedef struct {
+    OutboxMsgKind kind;
+    size_t len;
+    char data[OUTBOX_MSG_LEN];
+    char *big;              // frames longer than data (huge hands), kept for reuse until the table ends
+    size_t big_cap;
+} OutboxMsg;
+
+static inline const char *outbox_msg_bytes(const OutboxMsg *m) {
+    return m->len > OUTBOX_MSG_LEN ? m->big : m->data;
+}
+
+typedef struct {
+    int fd;
+    ShmChannel *chan;       // set instead of fd for shared memory clients
+    int player_index;
+    OutboxMsg msgs[OUTBOX_SLOTS];
+    int head;
+    int count;
+    size_t sent;            // bytes of msgs[head] already written
+    size_t queued_bytes;
+
+    // stats for the high-water report
+    size_t high_water_bytes;
+    int high_water_msgs;
+    int coalesced;
+
+    struct timespec stalled_since; // zero while the client keeps up
+    int disconnected;       // slow consumer policy kicked in, fd is closed
+    int drop_reported;      // scheduler has been told about it
+    int hung_up;            // the client closed its end, the seat can still be reclaimed
+    const char *drop_reason;
+    pthread_mutex_t lock;
+} Outbox;
+
+typedef enum TablePhase {
+    TABLE_PLAYING = 0,
+    TABLE_DRAINING = 1,  // GAME_OVER queued, waiting for the pipes to empty
+    TABLE_FINISHED = 2
+} TablePhase;
+
+struct Shard;
+
+// A client that joined and is waiting for (or holding) a seat
+typedef struct {
+    char name[NAME_SIZE];
+    int pid;
+    int fd;                 // client output FIFO, -1 for shared memory clients (or not open yet)
+    ShmChannel *chan;
+    int queue_pos;          // last QUEUE position sent, 0 = none yet
+    struct timespec joined;
+    uint64_t token;         // issued at join, or the one a RESUME join presented
+    int resume;             // RESUME join: take back the seat `token` was issued for
+} Seat;
+
+// A client taking back its seat, passed from the lobby to the owning reactor
+typedef struct {
+    int table_id;
+    int seat;
+    Seat client;
+} Reattach;
+
+// Estimated chance of each seat winning, for the move count it was worked out at
+typedef struct {
+    int table_id;
+    unsigned long moves;
+    int rollouts;
+    float win[MAX_PLAYERS];
+} TableOdds;
+
+// What the admin endpoint may see of a table, copied out by its reactor
+typedef struct {
+    int table_id;
+    int shard;
+    TablePhase phase;
+    int num_players;
+    int current_player;
+    int direction;
+    char pile[50];
+    Card top;               // the pile card itself, a wild carries the colour picked
+    int deck_size;
+    int deck_left;
+    unsigned long moves;
+    struct {
+        char name[NAME_SIZE];
+        int pid;
+        int hand_size;
+        int score;
+        int active;
+        int away;
+        int queued_msgs;    // outbox depth
+        size_t queued_bytes;
+    } players[MAX_PLAYERS];
+} TableInfo;
+
+// Seqlock slot: the reactor bumps seq to odd, rewrites info, bumps it back to even.
+// Readers copy info and retry if seq moved, so they never wait on game_lock.
+typedef struct {
+    atomic_uint seq;
+    atomic_int in_use;
+    TableInfo info;
+    atomic_uint odds_seq;   // the same kind of seqlock, written by the odds estimator
+    TableOdds odds;
+} TableView;
+
+typedef enum AdminOp {
+    ADMIN_KICK = 0,
+    ADMIN_DRAW = 1,
+    ADMIN_END = 2
+} AdminOp;
+
+// Admin command for a table, run by the reactor that owns it, which also replies
+typedef struct {
+    AdminOp op;
+    int table_id;
+    int seat;
+    int count;
+    int reply_fd;           // dup of the admin connection, closed by the reactor
+} AdminCmd;
+
+// One move of a game in progress, turned into history columns when the game ends
+typedef struct {
+    uint32_t game;          // filled in when the game is handed to the history file
+    uint16_t turn;
+    uint8_t player;
+    uint8_t card;
+    uint8_t action;
+    uint8_t hand;
+} HistoryRow;
+
+// One game, owned by exactly one reactor for its whole life
+typedef struct Table {
+    int id;
+    GameState *game;        // mmap shared with this table's input children
+    Outbox *outboxes;       // one per seat
+    TablePhase phase;
+    int awaiting;           // seat that was sent TURN, -1 if none
+    struct timespec deadline; // zero = no timer armed (jump-in window or drain)
+    struct timespec pile_changed; // jump-ins that arrived earlier aimed at an older pile
+    TableView *view;        // admin snapshot slot, NULL if every slot was taken
+    int view_dirty;         // state changed since the last publish
+    unsigned long moves;
+    HistoryRow *history;    // deal and every move, in order
+    int history_len;
+    int history_cap;
+    uint16_t turn;
+    uint32_t move_seq[MAX_PLAYERS]; // last sequence number taken from each seat's queue
+    int state_pending;      // waiting players still to be sent the latest state
+    Arena *arena;           // holds the table, its game and everything they allocate
+    struct Shard *shard;
+    struct Table *next;
+} Table;
+
+// A reactor thread and the disjoint set of tables it runs
+typedef struct Shard {
+    int id;
+    int cpu;                // -1 = not pinned
+    pthread_t tid;
+
+    // lock-free single producer (lobby) / single consumer (reactor) ring
+    Table *handoff[HANDOFF_SLOTS];
+    atomic_uint handoff_head;
+    atomic_uint handoff_tail;
+    atomic_int live_tables;
+
+    // same kind of ring for clients reclaiming a seat at one of this shard's tables
+    Reattach reattach[REATTACH_SLOTS];
+    atomic_uint reattach_head;
+    atomic_uint reattach_tail;
+
+    // and for admin commands (the admin thread is the producer)
+    AdminCmd admin[ADMIN_SLOTS];
+    atomic_uint admin_head;
+    atomic_uint admin_tail;
+
+    int bell_pipe[2];       // input children write their table id here
+    int wake_pipe[2];       // hand-offs and outbox wakeups
+
+    // finished games waiting to fill a history block
+    HistoryRow *history;
+    int history_len;
+    int history_cap;
+    HistoryGame *history_games;
+    int history_games_len;
+    int history_games_cap;
+    char *history_block;    // the block being written
+    size_t history_block_cap;
+    // HINT is searched on the shard's own solver thread, not the reactor: a
+    // request goes in at hint_tail, the solver answers it in place and moves
+    // hint_solved, the reactor sends the answer and moves hint_head
+    struct EndgameSolver *solver; // NULL while hints are off
+    struct HintJob *hints;  // HINT_SLOTS of them
+    atomic_uint hint_head;
+    atomic_uint hint_solved;
+    atomic_uint hint_tail;
+    atomic_int hint_stop;
+    sem_t hint_wake;
+    pthread_t solver_tid;
+
+    // lines logged on this reactor: it is the only producer, the logger the consumer
+    ShardLogLine log[SHARD_LOG_SLOTS];
+    atomic_uint log_head;
+    atomic_uint log_tail;
+    atomic_ulong log_dropped;   // lines lost to a full ring
+
+    Table *tables;          // only touched by the reactor thread
+    int seats;              // seats at those tables, sizes the poll set
+    struct pollfd *pfds;    // poll set, grown as tables arrive
+    Outbox **pfd_owners;
+    int pfd_cap;
+    unsigned long moves;
+    unsigned long tables_played;
+    struct timespec started;
+} Shard;
+
+Shard shards[MAX_SHARDS];
+int num_shards = 1;
+atomic_int lobby_open = 1;
+atomic_int next_table_id = 1;
+int resume_grace_ms = RESUME_GRACE_S * 1000; // 0 = a closed pipe loses the seat at once
+bool endgame_hints = false;    // hints see every hand, so they are for practice tables
+TableView table_views[ADMIN_VIEWS];
+atomic_int lobby_waiting;
+
+void signal_handler(int sig);
+void enqueue_log(char *msg);
+void *logger_thread_func(void *arg);
+void player_add_card(Player *player, Card new_card);
+void player_remove_card(Player *player, int index);
+int get_card_score(Card *c);
+void check_for_uno(Player *player, GameState *game, int uno_declaration);
+void decide_next_player(GameState *game);
+int seat_step(GameState *game, int seat, int direction);
+void deckInit(Deck *onoDeck, int decks);
+void deckShuffle(Deck *onoDeck);
+void execute_card_effect(Card *c, GameState *game, int wild_colour);
+void execute_wild_card(GameState *game, int wild_colour);
+bool check_for_winner(Player *player, GameState *game);
+bool player_turn(int player_index, GameState *game);
+bool player_play_card(Player *player, int card_played, GameState *game, int wild_colour);
+void reap_child_processes(Player *player);
+ShmChannel *lobby_attach_shm(int client_pid);
+
+void signal_handler(int signal){
+
+    (void)signal; // avoiding parameter warning by casting to void
+    server_running = 0;
+    // reactors poll with a short timeout, so they notice on their own
+}
+
+Card deckDraw(Deck *onoDeck)
+{
+    if (onoDeck->top_index >= onoDeck->size)
+    {
+        onoDeck->top_index = 0;
+        deckShuffle(onoDeck);
+    }
+
+    return onoDeck->deckCards[onoDeck->top_index++];
+}
+
+#ifndef CARD
+#define CARD
+
+// For displaying cards
+bool playable_card(Card *card, Card *top_card)
+{
+    // Card is playable when
+    // 1. Same value as top card
+    // 2. Same colour as top card
+    // 3. The card is a wild card5
+    // 4. Same card type as top card
+
+    // Check if same value
+    if ((card->value != CARD_VALUE_NONE && top_card->value != CARD_VALUE_NONE) && card->value == top_card->value)
+    {
+        return true;
+    }
+
+    // Check for same colour
+    else if (card->colour == top_card->colour || top_card->colour == CARD_COLOUR_BLACK)
+    {
+        return true;
+    }
+
+    // Check for same card type
+    else if ((card->type != CARD_NUMBER_TYPE && top_card->type != CARD_NUMBER_TYPE) && card->type == top_card->type)
+    {
+        return true;
+    }
+
+    // Check for wild cards
+    else if (card->type == CARD_WILD_TYPE || card->type == CARD_WILD_DRAW_FOUR_TYPE)
+    {
+        return true;
+    }
+
+    else
+    {
+        return false;
+    }
+}
+
+const char *get_colour_name(cardColour c)
+{
+    switch (c)
+    {
+    case CARD_COLOUR_RED:
+        return "Red";
+    case CARD_COLOUR_BLUE:
+        return "Blue";
+    case CARD_COLOUR_GREEN:
+        return "Green";
+    case CARD_COLOUR_YELLOW:
+        return "Yellow";
+    case CARD_COLOUR_BLACK:
+        return "Wild";
+    default:
+        return "Unknown";
+    }
+}
+
+void display_card(Card *card)
+{
+    printf("[%d (%s)]", card->value, get_colour_name(card->colour));
+}
+
+void execute_reverse_card(GameState *game)
+{
+    game->direction *= -1;
+    game->next_player = seat_step(game, game->current_player, game->direction);
+}
+
+void execute_skip_card(GameState *game)
+{
+    game->next_player = seat_step(game, game->next_player, game->direction);
+}
+
+void execute_draw_two_card(GameState *game)
+{
+    player_add_card(&game->players[game->next_player], deckDraw(&game->deck));
+    player_add_card(&game->players[game->next_player], deckDraw(&game->deck));
+
+    game->next_player = seat_step(game, game->current_player, game->direction);
+}
+
+void execute_wild_card(GameState *game, int wild_colour)
+{
+    if (wild_colour >= 1 && wild_colour <= 4) {
+        // Map 1-4 to enum 0-3 (Red=0, Blue=1, Green=2, Yellow=3)
+        game->played_cards[game->current_card_idx].colour = (cardColour)(wild_colour - 1);
+    } else {
+        // Default to Red if user didn't pick
+        game->played_cards[game->current_card_idx].colour = CARD_COLOUR_RED;
+    }
+}
+
+// For when a player plays a power card/wild card
+void execute_card_effect(Card *c, GameState *game, int wild_colour)
+{
+    switch (c->value)
+    {
+    case CARD_VALUE_SKIP:
+        execute_skip_card(game);
+        break;
+    case CARD_VALUE_REVERSE:
+        execute_reverse_card(game);
+        break;
+    case CARD_VALUE_DRAW_TWO:
+        execute_draw_two_card(game);
+        break;
+    case CARD_VALUE_WILD:
+        execute_wild_card(game, wild_colour);
+        break;
+    case CARD_VALUE_WILD_DRAW_FOUR:
+        execute_wild_card(game, wild_colour);
+        for(int i = 0; i < 4; i++) {
+            int victim = seat_step(game, game->current_player, game->direction);
+            player_add_card(&game->players[victim], deckDraw(&game->deck));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+#endif // CARD
+
+// Jason
+#ifndef PLAYER
+#define PLAYER
+
+void player_init(Player *player, const char *name)
+{
+    strncpy(player->player_name, name, NAME_SIZE - 1); // copy the name given into the player itself
+    player->hand_size = 0;                             // Cards given during start of round
+    memset(&player->hand_index, 0, sizeof(player->hand_index));
+}
+
+bool player_play_card(Player *player, int card_played, GameState *game, int wild_colour)
+{
+    Card *chosen_card = &player->hand_cards[card_played];
+    Card *top_card = &game->played_cards[game->current_card_idx];
+
+    if (!playable_card(chosen_card, top_card))
+    {
+        if (game_echo(game)) printf("> Invalid card played! Card not playable on top of pile.\n");
+        return false;
+    }
+    game->current_card_idx = (game->current_card_idx + 1) % DECK_SIZE;
+    game->played_cards[game->current_card_idx] = *chosen_card;
+
+    player_remove_card(player, card_played);
+
+    execute_card_effect(&game->played_cards[game->current_card_idx], game, wild_colour);
+    return true;
+}
+
+// For displaying the Player's hand
+int player_check_hand(Player *player)
+{
+    for (int i = 0; i < player->hand_size - 1; i++)
+    {
+        Card hand_card = player->hand_cards[i];
+        display_card(&hand_card);
+    }
+    return 0;
+}
+
+bool player_turn(int player_index, GameState *game) {
+  Player *P = &game->players[player_index];
+  char *cmd = game->stored_move;
+  char msg[100];
+
+  if (strncmp(cmd, "DRAW", 4) == 0) {
+    if (game_echo(game)) printf("> You draw a card...");
+    Card card_drawn = deckDraw(&game->deck);
+    player_add_card(P, card_drawn);
+
+    //Sending message to game.log
+    snprintf(msg, sizeof(msg), "Player %s drew a card", P->player_name);
+    if (!game->quiet) enqueue_log(msg);
+    return true;
+  } else if (strncmp(cmd, "MOVE", 4) == 0) {
+    int card_index;
+    int colour_code = 0; // Default 0
+    int uno_declaration = 0;
+
+    // Get the Index and colour after cmd "MOVE"
+    if(P->hand_size == 2){
+        sscanf(cmd + 5, "%d %d", &card_index, &uno_declaration);
+    }
+    else{
+    sscanf(cmd + 5, "%d %d", &card_index, &colour_code);
+    }
+
+    // Since client sends 1-based index, Server need to convert to 0-based
+    int actual_index = card_index - 1;
+
+    if (actual_index >= 0 && actual_index < P->hand_size) {
+
+        bool move_successful = player_play_card(P, actual_index, game, colour_code);
+
+        if (move_successful)
+        {
+            Card *c = &game->played_cards[game->current_card_idx];
+            if (game_echo(game)) printf("> Player %s played card %d (%s)\n", P->player_name, c->value, get_colour_name(c->colour));
+            // Send the card Details for logging
+            snprintf(msg, sizeof(msg), "Player %s played %d (%s)", P->player_name, c->value, get_colour_name(c->colour));
+            if (!game->quiet) enqueue_log(msg);
+
+            check_for_uno(P, game, uno_declaration);
+            return true;
+        } else {
+            return false;
+        }
+        
+    
+    } else {
+    Card *c = &game->played_cards[game->current_card_idx];
+    if (game_echo(game)) printf("Error: Player %s tried invalid index %d (%s)\n", P->player_name, c->value, get_colour_name(c->colour));
+    //Sending message to game.log
+    snprintf(msg, sizeof(msg), "Player %s tried invalid play index %d (%s)", P->player_name, c->value, get_colour_name(c->colour));
+    if (!game->quiet) enqueue_log(msg);
+
+    //PENALTY: DRAW A CARD
+    player_add_card(P, deckDraw(&game->deck));
+
+    return false;
+    }
+  }
+  return false;
+}
+
+#endif
+
+void format_card_to_string(const Card *c, char *buffer) {
+    const char *colour = get_colour_name(c->colour);
+
+    if (c->type == CARD_NUMBER_TYPE) {
+        sprintf(buffer, "%d (%s)", c->value, colour);
+    } else {
+        const char *type_str;
+        switch (c->type) {
+            case CARD_SKIP_TYPE: type_str = "SKIP"; break;
+            case CARD_REVERSE_TYPE: type_str = "REVERSE"; break;
+            case CARD_DRAW_TWO_TYPE: type_str = "DRAW TWO"; break;
+            case CARD_WILD_TYPE: type_str = "WILD"; break;
+            case CARD_WILD_DRAW_FOUR_TYPE: type_str = "WILD DRAW FOUR"; break;
+            default: type_str = "UNKNOWN"; break;
+        }
+        sprintf(buffer, "%s %s", type_str, colour);
+    }
+}
+
+void check_for_uno(Player *player, GameState *game, int uno_declaration){  
+    if(player->hand_size == 1){
+        if(uno_declaration == 0){
+            if (game_echo(game)) printf("Uh oh! You didn't say Uno! You'll now draw two cards!");
+            player_add_card(player, deckDraw(&game->deck));
+            player_add_card(player, deckDraw(&game->deck));
+        }
+        else{
+            if (game_echo(game)) printf("Player %d has declared uno!", game->current_player);
+        }
+    }
+}
+
+int table_decks = 0; // decks per table, 0 = one per PLAYERS_PER_DECK seats
+
+// How many decks are shuffled together for a table of num_players
+int deck_count(int num_players)
+{
+    if (table_decks > 0) return table_decks;
+    return 1 + (num_players - 1) / PLAYERS_PER_DECK;
+}
+
+void deckInit(Deck *onoDeck, int decks)
+{
+    int top_index = 0;
+    int w = 0;
+
+    if (decks < 1) decks = 1;
+    if (onoDeck->size != DECK_SIZE * decks) {
+        free(onoDeck->deckCards);
+        onoDeck->size = DECK_SIZE * decks;
+        onoDeck->deckCards = malloc(sizeof(Card) * onoDeck->size);
+        if (!onoDeck->deckCards) {
+            perror("Failed to allocate the deck");
+            exit(1);
+        }
+    }
+    memset(onoDeck->deckCards, 0, sizeof(Card) * DECK_SIZE);
+
+    // Adding coloured cards into the deck
+    for (int i = 0; i < 4; i++)
+    {
+        // Number cards (0-9)
+        for (int j = 0; j < 10; j++)
+        {
+          // Creating 4 copies of the number card
+          for (int k = 0; k < 4; k++) {
+            onoDeck->deckCards[top_index++] = (Card){
+              .colour = (cardColour)i,
+              .type = CARD_NUMBER_TYPE,
+              .value = (uint8_t)j};
+            }
+        }
+
+        // Power cards (Skip [10], Reverse[11], Draw Two[12])
+        for (int l = 10; l < 13; l++)
+        {
+            // Ensuring the card is given its correct cardType
+            switch (l)
+            {
+            case 10:
+                w = 1;
+                break;
+            case 11:
+                w = 2;
+                break;
+            case 12:
+                w = 3;
+                break;
+            }
+            // Creating 4 copies of the power cards
+            for (int m= 1; m < 4; m++)
+            {
+                onoDeck->deckCards[top_index++] = (Card){
+                    .colour = (cardColour)i,
+                    .type = (cardType)w,
+                    .value = (uint8_t)l};
+            }
+        }
+    }
+
+    // 4 Wild Cards
+    for (int l = 0; l < 4; l++)
+    {
+        onoDeck->deckCards[top_index++] = (Card){
+            .colour = CARD_COLOUR_BLACK,
+            .type = CARD_WILD_TYPE,
+            .value = CARD_VALUE_WILD};
+    }
+
+    // 8 Wild Card Draw Fours
+    for (int m = 0; m < 8; m++)
+    {
+        onoDeck->deckCards[top_index++] = (Card){
+            .colour = CARD_COLOUR_BLACK,
+            .type = CARD_WILD_DRAW_FOUR_TYPE,
+            .value = CARD_VALUE_WILD_DRAW_FOUR};
+    }
+
+    // The other decks are copies of the first
+    for (int d = 1; d < decks; d++)
+        memcpy(onoDeck->deckCards + d * DECK_SIZE, onoDeck->deckCards, sizeof(Card) * DECK_SIZE);
+
+    // Ensure pointer is now at top card
+    onoDeck->top_index = 0;
+    if (onoDeck->seed == 0) onoDeck->seed = (unsigned int)rand();
+}
+
+void deckFree(Deck *onoDeck)
+{
+    free(onoDeck->deckCards);
+    onoDeck->deckCards = NULL;
+    onoDeck->size = 0;
+}
+
+// Shuffled decks made ahead of time by the input pool thread (see
+// input_pool_thread_func()), so seating a table only copies one. Empty unless
+// the server started the pool; headless games always shuffle their own.
+static Card *deck_pool[DECK_POOL_SIZE];
+static int deck_pool_len = 0;
+static int deck_pool_decks = 0;     // decks combined in every pooled deck
+static pthread_mutex_t deck_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Fill `onoDeck` (already sized for `decks`) from the pool, false if none is ready
+bool deck_take_shuffled(Deck *onoDeck, int decks)
+{
+    Card *cards = NULL;
+
+    if (onoDeck->size != DECK_SIZE * decks || !onoDeck->deckCards) return false;
+    pthread_mutex_lock(&deck_pool_lock);
+    if (deck_pool_len > 0 && deck_pool_decks == decks) cards = deck_pool[--deck_pool_len];
+    pthread_mutex_unlock(&deck_pool_lock);
+    if (!cards) return false;
+
+    memcpy(onoDeck->deckCards, cards, sizeof(Card) * onoDeck->size);
+    free(cards);
+    onoDeck->top_index = 0;
+    if (onoDeck->seed == 0) onoDeck->seed = (unsigned int)rand();
+    return true;
+}
+
+// Shuffle one more deck into the pool, false once it is full
+bool deck_pool_refill(Deck *scratch)
+{
+    pthread_mutex_lock(&deck_pool_lock);
+    bool full = deck_pool_len >= DECK_POOL_SIZE || deck_pool_decks == 0;
+    int decks = deck_pool_decks;
+    pthread_mutex_unlock(&deck_pool_lock);
+    if (full) return false;
+
+    deckInit(scratch, decks);
+    deckShuffle(scratch);
+    Card *cards = malloc(sizeof(Card) * scratch->size);
+    if (!cards) return false;
+    memcpy(cards, scratch->deckCards, sizeof(Card) * scratch->size);
+
+    pthread_mutex_lock(&deck_pool_lock);
+    if (deck_pool_len < DECK_POOL_SIZE) {
+        deck_pool[deck_pool_len++] = cards;
+        cards = NULL;
+    }
+    pthread_mutex_unlock(&deck_pool_lock);
+    free(cards);
+    return true;
+}
+
+void deckShuffle(Deck *onoDeck)
+{
+    // Random Number Generator Seed
+    for (int i = onoDeck->size - 1; i > 0; i--)
+    {
+        int j = rand_r(&onoDeck->seed) % (i + 1); // Generate Random Number between 0 to size (220 per deck)
+        Card temp = onoDeck->deckCards[i];
+        onoDeck->deckCards[i] = onoDeck->deckCards[j];
+        onoDeck->deckCards[j] = temp;
+    }
+}
+
+static void hand_index_add(HandIndex *h, Card *c)
+{
+    h->counts[c->colour][c->value]++;
+    h->colour_count[c->colour]++;
+    h->value_count[c->value]++;
+    h->colour_mask |= 1u << c->colour;
+    h->value_mask |= 1u << c->value;
+    h->score += get_card_score(c);
+}
+
+static void hand_index_remove(HandIndex *h, Card *c)
+{
+    h->counts[c->colour][c->value]--;
+    if (--h->colour_count[c->colour] == 0) h->colour_mask &= ~(1u << c->colour);
+    if (--h->value_count[c->value] == 0) h->value_mask &= ~(1u << c->value);
+    h->score -= get_card_score(c);
+}
+
+// playable_card() against the whole hand at once
+bool hand_has_playable(HandIndex *h, Card *top_card)
+{
+    if (h->colour_mask & (1u << CARD_COLOUR_BLACK)) return true; // wilds always play
+    if (top_card->colour == CARD_COLOUR_BLACK) return h->colour_mask != 0;
+    if (h->colour_mask & (1u << top_card->colour)) return true;
+    // same value also covers same power card type
+    return top_card->value != CARD_VALUE_NONE && (h->value_mask & (1u << top_card->value));
+}
+
+// Is there a card with this exact colour and value in hand
+bool hand_holds(HandIndex *h, Card *card)
+{
+    return h->counts[card->colour][card->value] > 0;
+}
+
+// Grow a card array to hold at least `need` cards, false if out of memory.
+// With an arena the cards move to a bigger piece of it (the old one is only
+// reclaimed with the arena), without one they are realloc()ed.
+bool cards_reserve(Arena *arena, Card **cards, int *cap, int need)
+{
+    if (need <= *cap) return true;
+
+    int new_cap = *cap > 0 ? *cap : HAND_INITIAL_CAP;
+    while (new_cap < need) new_cap *= 2;
+
+    Card *grown;
+    if (arena) {
+        grown = arena_alloc(arena, sizeof(Card) * new_cap);
+        if (grown && *cap > 0) memcpy(grown, *cards, sizeof(Card) * *cap);
+    } else {
+        grown = realloc(*cards, sizeof(Card) * new_cap);
+    }
+    if (!grown) return false;
+    *cards = grown;
+    *cap = new_cap;
+    return true;
+}
+
+void player_add_card(Player *player, Card new_card)
+{
+    if (!cards_reserve(player->arena, &player->hand_cards, &player->hand_cap, player->hand_size + 1))
+    {
+        perror("Failed to grow hand");
+        return;
+    }
+    player->hand_cards[player->hand_size] = new_card;
+    player->hand_size++;
+    player->hand_changes++;
+    hand_index_add(&player->hand_index, &new_card);
+}
+
+void player_remove_card(Player *player, int index)
+{
+    hand_index_remove(&player->hand_index, &player->hand_cards[index]);
+    player->hand_cards[index] = player->hand_cards[player->hand_size - 1]; // Replace played card with last card
+    player->hand_size--;
+    player->hand_changes++;
+}
+
+bool check_for_winner(Player *player, GameState *game)
+{
+    if(player->hand_size == 0){
+        game->winner_pid = player->pid;
+        game->game_over = 1;
+        return true;
+    }
+  return false;
+}
+
+// Turn ring: the active seats, linked in seat order, so moving on, skipping
+// and reversing cost the same at a table of 100 as at a table of 2. A seat
+// that leaves is unlinked but keeps its own links, which lead back into the ring.
+void seat_ring_init(GameState *game)
+{
+    int n = game->num_players;
+
+    for (int i = 0; i < n; i++) {
+        game->players[i].ring_next = (i + 1) % n;
+        game->players[i].ring_prev = (i + n - 1) % n;
+    }
+    game->active_players = n;
+}
+
+// Relink every seat from is_active alone, for a player_leave() that was cut
+// short by an input child dying with game_lock held
+void seat_ring_repair(GameState *game)
+{
+    int n = game->num_players;
+    int count = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (game->players[i].is_active) count++;
+    }
+    game->active_players = count;
+    if (count == 0) return;
+
+    for (int i = 0; i < n; i++) {
+        int next = (i + 1) % n;
+        int prev = (i + n - 1) % n;
+        while (!game->players[next].is_active) next = (next + 1) % n;
+        while (!game->players[prev].is_active) prev = (prev + n - 1) % n;
+        game->players[i].ring_next = next;
+        game->players[i].ring_prev = prev;
+    }
+}
+
+// game_lock is robust: the input children take it too, and one that dies
+// holding it (SIGKILL, a crash) hands it to the next taker instead of leaving
+// the table locked for good. All a child does under it is mark its seat away
+// or take it out of play, so relinking the ring makes the game whole again.
+void lock_game(GameState *game)
+{
+    if (pthread_mutex_lock(&game->game_lock) == EOWNERDEAD) {
+        seat_ring_repair(game);
+        pthread_mutex_consistent(&game->game_lock);
+        enqueue_log("An input process died holding the game lock, seats relinked");
+    }
+}
+
+// Take a seat out of play, caller holds game_lock if any
+void player_leave(GameState *game, int seat)
+{
+    Player *P = &game->players[seat];
+
+    if (!P->is_active) return;
+    P->is_active = 0;
+    game->players[P->ring_prev].ring_next = P->ring_next;
+    game->players[P->ring_next].ring_prev = P->ring_prev;
+    game->active_players--;
+}
+
+// The active seat after `seat` going in `direction`; `seat` itself may have left
+int seat_step(GameState *game, int seat, int direction)
+{
+    int next = seat;
+
+    for (int hops = 0; hops < game->num_players; hops++) {
+        Player *P = &game->players[next];
+        next = direction < 0 ? P->ring_prev : P->ring_next;
+        if (game->players[next].is_active) break;
+    }
+    return next;
+}
+
+void decide_next_player(GameState *game)
+{
+    int seat = game->next_player;
+
+    // the seat picked as next may have left since
+    game->current_player = game->players[seat].is_active ? seat : seat_step(game, seat, game->direction);
+    game->next_player = seat_step(game, game->current_player, game->direction);
+}
+
+// Start a game for the seats already named in game->players: everyone active
+// and in the turn ring, START_CARD_DECK cards each from `decks` combined decks
+void game_deal(GameState *game, int decks)
+{
+    for (int i = 0; i < game->num_players; i++) {
+        Player *P = &game->players[i];
+        P->is_active = 1;
+        P->arena = game->arena;
+        P->hand_size = 0;
+        memset(&P->hand_index, 0, sizeof(P->hand_index));
+    }
+    seat_ring_init(game);
+
+    // deckInit() keeps a deck that already has the right size
+    if (game->arena && game->deck.size != DECK_SIZE * decks) {
+        game->deck.deckCards = arena_alloc(game->arena, sizeof(Card) * DECK_SIZE * decks);
+        game->deck.size = game->deck.deckCards ? DECK_SIZE * decks : 0;
+    }
+
+    game->direction = 1;
+    game->current_player = 0;
+    game->current_card_idx = 0;
+    game->next_player = seat_step(game, game->current_player, game->direction);
+
+    if (!deck_take_shuffled(&game->deck, decks)) {
+        deckInit(&game->deck, decks);
+        deckShuffle(&game->deck);
+    }
+    for (int i = 0; i < game->num_players; i++) {
+        for (int c = 0; c < START_CARD_DECK; c++)
+            player_add_card(&game->players[i], deckDraw(&game->deck));
+    }
+}
+
+// Heap memory behind a game: hands, their published copies and the deck.
+// A game with an arena only lets go of them, the arena is reset as a whole.
+void game_free(GameState *game)
+{
+    if (game->arena) {
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            game->players[i].hand_cards = NULL;
+            game->snap.hands[i] = NULL;
+        }
+        game->deck.deckCards = NULL;
+        return;
+    }
+
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        free(game->players[i].hand_cards);
+        game->players[i].hand_cards = NULL;
+        game->players[i].hand_cap = 0;
+        game->players[i].hand_size = 0;
+        free(game->snap.hands[i]);
+        game->snap.hands[i] = NULL;
+        game->snap.hand_cap[i] = 0;
+    }
+    deckFree(&game->deck);
+}
+
+
+typedef enum MoveOutcome {
+    MOVE_APPLIED = 0,   // turn passed on to the next player
+    MOVE_WON = 1,       // player emptied their hand
+    MOVE_REJECTED = 2   // invalid move, penalty card drawn, same player again
+} MoveOutcome;
+
+// Rules half of a scheduler step: apply game->stored_move for `player`.
+// Shared by the reactor and headless games, caller holds game_lock if any.
+MoveOutcome game_apply_move(GameState *game, int player) {
+    bool success = player_turn(player, game);
+
+    if (!success) {
+        // Invalid move, player draws a card as penalty
+        player_add_card(&game->players[player], deckDraw(&game->deck));
+        return MOVE_REJECTED;
+    }
+
+    if (check_for_winner(&game->players[player], game)) {
+        return MOVE_WON;
+    }
+
+    decide_next_player(game);
+    return MOVE_APPLIED;
+}
+
+// Jump-in house rule: a card identical to the top of the pile (same colour
+// and value, so never a wild) may be played by anyone, in turn or not
+bool jump_in_allowed(GameState *game, int player, const char *cmd) {
+    Player *P = &game->players[player];
+    Card *top = &game->played_cards[game->current_card_idx];
+    int card_index;
+
+    if (!P->is_active || strncmp(cmd, "MOVE", 4) != 0 || !hand_holds(&P->hand_index, top)) return false;
+    if (sscanf(cmd + 4, "%d", &card_index) != 1) return false;
+    if (card_index < 1 || card_index > P->hand_size) return false;
+
+    Card *c = &P->hand_cards[card_index - 1];
+    return c->colour != CARD_COLOUR_BLACK && c->colour == top->colour && c->value == top->value;
+}
+
+// Apply game->stored_move out of turn: play continues from whoever jumped in
+MoveOutcome game_apply_jump_in(GameState *game, int player) {
+    char msg[100];
+
+    game->next_player = player;
+    decide_next_player(game);
+
+    snprintf(msg, sizeof(msg), "Player %s jumped in", game->players[player].player_name);
+    if (game_echo(game)) printf("> %s\n", msg);
+    if (!game->quiet) enqueue_log(msg);
+    return game_apply_move(game, player);
+}
+
+#ifndef BOT
+#define BOT
+
+typedef enum BotStrategy {
+    BOT_FIRST = 0,      // first playable card in hand order
+    BOT_RANDOM = 1,     // any playable card
+    BOT_GREEDY = 2,     // dump the card worth the most penalty points
+    BOT_SOLVER = 3      // greedy, but plays a forced win once the endgame solver finds one
+} BotStrategy;
+
+const char *bot_strategy_name(BotStrategy strategy) {
+    switch (strategy) {
+    case BOT_RANDOM: return "random";
+    case BOT_GREEDY: return "greedy";
+    case BOT_SOLVER: return "solver";
+    default: return "first";
+    }
+}
+
+BotStrategy bot_strategy_from_name(const char *name) {
+    if (strcmp(name, "random") == 0) return BOT_RANDOM;
+    if (strcmp(name, "greedy") == 0) return BOT_GREEDY;
+    if (strcmp(name, "solver") == 0) return BOT_SOLVER;
+    return BOT_FIRST;
+}
+
+// Write the command a bot in seat `player` would send, in client format.
+// BOT_SOLVER plays greedy here, see bot_solver_move() for its endgame.
+void bot_choose_move(GameState *game, int player, BotStrategy strategy, unsigned int *seed, char *cmd, size_t size) {
+    Player *P = &game->players[player];
+    Card *top = &game->played_cards[game->current_card_idx];
+    int count = 0;
+    int pick = -1;
+
+    if (!hand_has_playable(&P->hand_index, top)) {
+        snprintf(cmd, size, "DRAW\n");
+        return;
+    }
+
+    // hands have no size limit, so count the playable cards instead of listing them
+    for (int i = 0; i < P->hand_size; i++) {
+        if (!playable_card(&P->hand_cards[i], top)) continue;
+        count++;
+        if (pick == -1 || (strategy >= BOT_GREEDY && get_card_score(&P->hand_cards[i]) > get_card_score(&P->hand_cards[pick])))
+            pick = i;
+    }
+
+    if (strategy == BOT_RANDOM) {
+        int nth = rand_r(seed) % count;
+        for (int i = 0; i < P->hand_size; i++) {
+            if (playable_card(&P->hand_cards[i], top) && nth-- == 0) {
+                pick = i;
+                break;
+            }
+        }
+    }
+
+    // with two cards left the second number is the uno declaration
+    if (P->hand_size == 2) {
+        snprintf(cmd, size, "MOVE %d 1\n", pick + 1);
+        return;
+    }
+
+    int best = 0;
+    for (int c = 1; c < 4; c++) {
+        if (P->hand_index.colour_count[c] > P->hand_index.colour_count[best]) best = c;
+    }
+    snprintf(cmd, size, "MOVE %d %d\n", pick + 1, best + 1);
+}
+
+#endif // BOT
+
+// Endgame solver: once few cards are left, the rest of the game is searched
+// exactly for a forced win of the player to move (the root player). A
+// position is every hand, the top of the pile, the direction and whose turn
+// it is. Cards drawn or handed out as penalties are unknown, so they become
+// jokers that may turn out to be any card. The opponents are taken to play
+// together against the root player and any of them going out is a loss; the
+// root player never counts on a card it has not seen, so having to draw or
+// being given cards is a loss too. A win found this way holds however the
+// others play and whatever the deck holds. The search is alpha-beta with a
+// Zobrist-hashed transposition table, as the same hands come up again through
+// other orders of play, and it gives up once over its node or time budget.
+#ifndef ENDGAME
+#define ENDGAME
+
+#define ENDGAME_COLOURED 52         // kinds 0-51: colour * 13 + value (0-9, skip, reverse, draw two)
+#define ENDGAME_WILD 52
+#define ENDGAME_WILD_DRAW_FOUR 53
+#define ENDGAME_KINDS 54
+#define ENDGAME_MAX_JOKERS 32       // an opponent given more is not worth following
+#define ENDGAME_MAX_MOVES 80          // 52 coloured kinds, 8 wild picks, a draw, the jump-ins
+#define ENDGAME_DRAW (-1)
+#define ENDGAME_WIN 10000           // less the plies it takes
+#define ENDGAME_LOSS (-ENDGAME_WIN)
+
+typedef struct {
+    int8_t seat;
+    int8_t kind;            // ENDGAME_DRAW to draw a card
+    int8_t colour;          // picked for a wild
+    int8_t joker;           // an unknown card played as `kind`
+} EndgameMove;
+
+typedef struct {
+    uint8_t counts[ENDGAME_MAX_SEATS][ENDGAME_KINDS];
+    uint8_t size[ENDGAME_MAX_SEATS];
+    uint8_t jokers[ENDGAME_MAX_SEATS];
+    int8_t seats;           // seats still in, renumbered 0.. in seat order
+    int8_t root;
+    int8_t current;
+    int8_t direction;
+    int8_t top_colour;
+    int8_t top_value;
+    bool jump_ins;          // opponents may play an identical card out of turn
+    uint64_t key;
+    int seat_of[ENDGAME_MAX_SEATS]; // index in game->players
+} EndgamePos;
+
+enum { ENDGAME_EXACT = 0, ENDGAME_LOWER = 1, ENDGAME_UPPER = 2 };
+
+typedef struct {
+    uint64_t key;
+    int16_t score;          // from this position on, see endgame_tt_store()
+    uint8_t depth;          // plies left before the horizon when it was stored
+    uint8_t bound;
+    uint8_t generation;     // entries of earlier searches are ignored
+    EndgameMove move;       // tried first when the position comes up again
+} EndgameEntry;
+
+typedef struct EndgameSolver {
+    EndgameEntry *tt;
+    uint8_t generation;
+    long nodes;
+    long max_nodes;
+    long long deadline_ns;  // 0 = no time limit
+    bool aborted;
+} EndgameSolver;
+
+typedef enum EndgameOutcome {
+    ENDGAME_UNSOLVED = 0,       // over budget, or not an endgame
+    ENDGAME_FORCED_WIN = 1,
+    ENDGAME_NO_FORCED_WIN = 2
+} EndgameOutcome;
+
+typedef struct {
+    EndgameOutcome outcome;
+    EndgameMove move;       // the first move of the win
+    int plies;              // moves by everyone until the root player is out
+    long nodes;
+} EndgameResult;
+
+static uint64_t endgame_z_card[ENDGAME_MAX_SEATS][ENDGAME_KINDS][ENDGAME_MAX_CARDS + 1];
+static uint64_t endgame_z_joker[ENDGAME_MAX_SEATS][ENDGAME_MAX_JOKERS + 1];
+static uint64_t endgame_z_top[5][CARD_VALUES];
+static uint64_t endgame_z_turn[ENDGAME_MAX_SEATS];
+static uint64_t endgame_z_reversed;
+static pthread_once_t endgame_z_once = PTHREAD_ONCE_INIT;
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Fixed keys, so a search gives the same answer in every run
+static void endgame_zobrist_init(void) {
+    uint64_t state = 0x4f4e4f;
+
+    for (int s = 0; s < ENDGAME_MAX_SEATS; s++) {
+        for (int k = 0; k < ENDGAME_KINDS; k++) {
+            for (int n = 0; n <= ENDGAME_MAX_CARDS; n++) endgame_z_card[s][k][n] = splitmix64(&state);
+        }
+        for (int n = 0; n <= ENDGAME_MAX_JOKERS; n++) endgame_z_joker[s][n] = splitmix64(&state);
+        endgame_z_turn[s] = splitmix64(&state);
+    }
+    for (int c = 0; c < 5; c++) {
+        for (int v = 0; v < CARD_VALUES; v++) endgame_z_top[c][v] = splitmix64(&state);
+    }
+    endgame_z_reversed = splitmix64(&state);
+}
+
+EndgameSolver *endgame_solver_new(void) {
+    EndgameSolver *s = calloc(1, sizeof(EndgameSolver));
+    if (!s) return NULL;
+    s->tt = calloc((size_t)1 << ENDGAME_TT_BITS, sizeof(EndgameEntry));
+    if (!s->tt) {
+        free(s);
+        return NULL;
+    }
+    pthread_once(&endgame_z_once, endgame_zobrist_init);
+    return s;
+}
+
+void endgame_solver_free(EndgameSolver *s) {
+    if (!s) return;
+    free(s->tt);
+    free(s);
+}
+
+// Every change to a position goes through these, so the key stays in step
+static void endgame_set_count(EndgamePos *p, int seat, int kind, int count) {
+    p->key ^= endgame_z_card[seat][kind][p->counts[seat][kind]] ^ endgame_z_card[seat][kind][count];
+    p->counts[seat][kind] = count;
+}
+
+static void endgame_set_jokers(EndgamePos *p, int seat, int jokers) {
+    p->key ^= endgame_z_joker[seat][p->jokers[seat]] ^ endgame_z_joker[seat][jokers];
+    p->jokers[seat] = jokers;
+}
+
+static void endgame_set_top(EndgamePos *p, int colour, int value) {
+    p->key ^= endgame_z_top[p->top_colour][p->top_value] ^ endgame_z_top[colour][value];
+    p->top_colour = colour;
+    p->top_value = value;
+}
+
+static void endgame_set_turn(EndgamePos *p, int current, int direction) {
+    p->key ^= endgame_z_turn[p->current] ^ endgame_z_turn[current];
+    if (direction != p->direction) p->key ^= endgame_z_reversed;
+    p->current = current;
+    p->direction = direction;
+}
+
+static int endgame_step(const EndgamePos *p, int seat, int direction) {
+    return (seat + direction + p->seats) % p->seats;
+}
+
+static int endgame_kind(const Card *c) {
+    if (c->colour == CARD_COLOUR_BLACK) return c->value == CARD_VALUE_WILD ? ENDGAME_WILD : ENDGAME_WILD_DRAW_FOUR;
+    return c->colour * 13 + c->value;
+}
+
+// Build the position of `game` with the player to move as the root player.
+// False unless it is small enough to solve: at most ENDGAME_MAX_CARDS cards
+// in all hands together and ENDGAME_MAX_SEATS players still in.
+bool endgame_position(GameState *game, bool jump_ins, EndgamePos *p) {
+    Card *top = &game->played_cards[game->current_card_idx];
+    int cards = 0;
+
+    memset(p, 0, sizeof(*p));
+    p->root = -1;
+    for (int i = 0; i < game->num_players; i++) {
+        Player *P = &game->players[i];
+        if (!P->is_active) continue;
+        cards += P->hand_size;
+        if (p->seats == ENDGAME_MAX_SEATS || cards > ENDGAME_MAX_CARDS) return false;
+        if (i == game->current_player) p->root = p->seats;
+        p->seat_of[p->seats++] = i;
+    }
+    if (p->root < 0 || p->seats < 2 || top->colour == CARD_COLOUR_BLACK) return false;
+
+    // the turn ring runs in seat order; next_player is always the step after
+    // the current player between moves, so it follows from the direction
+    p->current = p->root;
+    p->direction = game->direction < 0 ? -1 : 1;
+    p->top_colour = top->colour;
+    p->top_value = top->value;
+    p->jump_ins = jump_ins;
+    p->key = endgame_z_turn[p->current] ^ endgame_z_top[p->top_colour][p->top_value];
+    if (p->direction < 0) p->key ^= endgame_z_reversed;
+    for (int s = 0; s < p->seats; s++) {
+        Player *P = &game->players[p->seat_of[s]];
+        for (int k = 0; k < ENDGAME_KINDS; k++) p->key ^= endgame_z_card[s][k][0];
+        p->key ^= endgame_z_joker[s][0];
+        for (int i = 0; i < P->hand_size; i++) {
+            int k = endgame_kind(&P->hand_cards[i]);
+            endgame_set_count(p, s, k, p->counts[s][k] + 1);
+        }
+        p->size[s] = P->hand_size;
+    }
+    return true;
+}
+
+// Cards from the deck, unknown ones: false when that settles the search
+static bool endgame_give(EndgamePos *p, int seat, int cards) {
+    if (seat == p->root || p->jokers[seat] + cards > ENDGAME_MAX_JOKERS) return false;
+    endgame_set_jokers(p, seat, p->jokers[seat] + cards);
+    p->size[seat] += cards;
+    return true;
+}
+
+// Apply a move as player_turn() and game_apply_move() would for m->seat, who
+// is p->current. ENDGAME_WIN or ENDGAME_LOSS if that ends it, 0 if play goes on.
+static int endgame_play(EndgamePos *p, const EndgameMove *m) {
+    int seat = m->seat;
+    int direction = p->direction;
+
+    if (m->kind == ENDGAME_DRAW) {
+        if (!endgame_give(p, seat, 1)) return ENDGAME_LOSS;
+        endgame_set_turn(p, endgame_step(p, seat, direction), direction);
+        return 0;
+    }
+
+    // with two cards the second number of MOVE is the uno call, a wild goes red
+    bool uno_call = p->size[seat] == 2;
+    if (m->joker) endgame_set_jokers(p, seat, p->jokers[seat] - 1);
+    else endgame_set_count(p, seat, m->kind, p->counts[seat][m->kind] - 1);
+    p->size[seat]--;
+
+    if (m->kind >= ENDGAME_COLOURED) {
+        int value = m->kind == ENDGAME_WILD ? CARD_VALUE_WILD : CARD_VALUE_WILD_DRAW_FOUR;
+        endgame_set_top(p, uno_call ? CARD_COLOUR_RED : m->colour, value);
+    } else {
+        endgame_set_top(p, m->kind / 13, m->kind % 13);
+    }
+    if (p->size[seat] == 0) return seat == p->root ? ENDGAME_WIN : ENDGAME_LOSS;
+
+    int next = endgame_step(p, seat, direction);
+    switch (p->top_value) {
+    case CARD_VALUE_SKIP:
+        next = endgame_step(p, next, direction);
+        break;
+    case CARD_VALUE_REVERSE:
+        direction = -direction;
+        next = endgame_step(p, seat, direction);
+        break;
+    case CARD_VALUE_DRAW_TWO:
+        if (!endgame_give(p, next, 2)) return ENDGAME_LOSS;
+        break;
+    case CARD_VALUE_WILD_DRAW_FOUR:
+        if (!endgame_give(p, next, 4)) return ENDGAME_LOSS;
+        break;
+    }
+    endgame_set_turn(p, next, direction);
+    return 0;
+}
+
+static bool endgame_playable(const EndgamePos *p, int kind) {
+    return kind >= ENDGAME_COLOURED || kind / 13 == p->top_colour || kind % 13 == p->top_value;
+}
+
+static int endgame_add_plays(const EndgamePos *p, int seat, int kind, bool joker, EndgameMove *out, int n) {
+    if (kind < ENDGAME_COLOURED) {
+        out[n++] = (EndgameMove){ seat, kind, 0, joker };
+        return n;
+    }
+    if (p->size[seat] == 2) { // goes red whatever is picked
+        out[n++] = (EndgameMove){ seat, kind, CARD_COLOUR_RED, joker };
+        return n;
+    }
+    for (int c = 0; c < 4; c++) out[n++] = (EndgameMove){ seat, kind, c, joker };
+    return n;
+}
+
+// Moves from a position: the player to move first, then the opponents
+// jumping in. Returns how many of them are the player to move's own.
+static int endgame_moves(const EndgamePos *p, EndgameMove *out, int *count) {
+    int seat = p->current;
+    int n = 0;
+
+    for (int k = 0; k < ENDGAME_KINDS; k++) {
+        if (!endgame_playable(p, k)) continue;
+        if (p->counts[seat][k] > 0) n = endgame_add_plays(p, seat, k, false, out, n);
+        else if (p->jokers[seat] > 0) n = endgame_add_plays(p, seat, k, true, out, n);
+    }
+    if (seat != p->root) out[n++] = (EndgameMove){ seat, ENDGAME_DRAW, 0, 0 };
+    int own = n;
+
+    // only a coloured card can be identical to the pile
+    if (p->jump_ins && p->top_value < CARD_VALUE_WILD) {
+        int k = p->top_colour * 13 + p->top_value;
+        for (int s = 0; s < p->seats; s++) {
+            if (s == seat || s == p->root) continue;
+            if (p->counts[s][k] > 0 || p->jokers[s] > 0) out[n++] = (EndgameMove){ s, k, 0, p->counts[s][k] == 0 };
+        }
+    }
+    *count = n;
+    return own;
+}
+
+// Likely cut-offs first: for the opponents, cards that load the root player
+// with unknown ones; for the root player, cards that keep the turn.
+static int endgame_move_order(const EndgamePos *p, const EndgameMove *m) {
+    if (m->kind == ENDGAME_DRAW) return 0;
+    int value = m->kind >= ENDGAME_COLOURED ? (m->kind == ENDGAME_WILD ? CARD_VALUE_WILD : CARD_VALUE_WILD_DRAW_FOUR) : m->kind % 13;
+    bool hits_root = endgame_step(p, m->seat, p->direction) == p->root;
+
+    if (m->seat != p->root && hits_root && (value == CARD_VALUE_DRAW_TWO || value == CARD_VALUE_WILD_DRAW_FOUR)) return 4;
+    if (value == CARD_VALUE_SKIP || value == CARD_VALUE_REVERSE) return 3;
+    if (value == CARD_VALUE_DRAW_TWO || value == CARD_VALUE_WILD_DRAW_FOUR) return 2;
+    return 1;
+}
+
+static void endgame_sort(const EndgamePos *p, EndgameMove *moves, int n, const EndgameMove *first) {
+    int order[ENDGAME_MAX_MOVES];
+
+    for (int i = 0; i < n; i++) {
+        bool tt_move = first && memcmp(&moves[i], first, sizeof(*first)) == 0;
+        order[i] = tt_move ? 5 : endgame_move_order(p, &moves[i]);
+    }
+    for (int i = 1; i < n; i++) { // a few dozen moves at most, insertion sort will do
+        EndgameMove m = moves[i];
+        int o = order[i];
+        int j = i - 1;
+        for (; j >= 0 && order[j] < o; j--) {
+            moves[j + 1] = moves[j];
+            order[j + 1] = order[j];
+        }
+        moves[j + 1] = m;
+        order[j + 1] = o;
+    }
+}
+
+static long long endgame_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Wins are stored as plies from the position they were found in, since the
+// same position comes up at different depths
+static void endgame_tt_store(EndgameSolver *s, const EndgamePos *p, int ply, int depth, int score, int bound, const EndgameMove *move) {
+    EndgameEntry *e = &s->tt[p->key & (((size_t)1 << ENDGAME_TT_BITS) - 1)];
+
+    e->key = p->key;
+    e->score = score > 0 ? score + ply : score;
+    e->depth = depth;
+    e->bound = bound;
+    e->generation = s->generation;
+    e->move = move ? *move : (EndgameMove){ -1, ENDGAME_DRAW, 0, 0 };
+}
+
+static int endgame_search(EndgameSolver *s, const EndgamePos *p, int ply, int alpha, int beta, EndgameMove *best);
+
+static int endgame_child(EndgameSolver *s, const EndgamePos *p, const EndgameMove *m, int ply, int alpha, int beta) {
+    EndgamePos next = *p;
+
+    if (m->seat != p->current) endgame_set_turn(&next, m->seat, next.direction); // jumps in
+    int end = endgame_play(&next, m);
+    if (end == ENDGAME_WIN) return ENDGAME_WIN - (ply + 1);
+    if (end == ENDGAME_LOSS) return ENDGAME_LOSS;
+    return endgame_search(s, &next, ply + 1, alpha, beta, NULL);
+}
+
+// Score for the root player: ENDGAME_WIN less the plies to the win, or
+// ENDGAME_LOSS if there is no forced win before the horizon
+static int endgame_search(EndgameSolver *s, const EndgamePos *p, int ply, int alpha, int beta, EndgameMove *best) {
+    if (++s->nodes > s->max_nodes) s->aborted = true;
+    if ((s->nodes & 1023) == 0 && s->deadline_ns && endgame_now_ns() > s->deadline_ns) s->aborted = true;
+    if (s->aborted) return 0;
+    if (ply >= ENDGAME_MAX_PLY) return ENDGAME_LOSS;
+
+    int depth = ENDGAME_MAX_PLY - ply;
+    EndgameEntry *e = &s->tt[p->key & (((size_t)1 << ENDGAME_TT_BITS) - 1)];
+    EndgameMove *tt_move = NULL;
+    if (e->key == p->key && e->generation == s->generation) {
+        int score = e->score > 0 ? e->score - ply : e->score;
+        if (!best && e->depth >= depth) {
+            if (e->bound == ENDGAME_EXACT) return score;
+            if (e->bound == ENDGAME_LOWER && score >= beta) return score;
+            if (e->bound == ENDGAME_UPPER && score <= alpha) return score;
+        }
+        if (e->move.seat >= 0) tt_move = &e->move;
+    }
+
+    EndgameMove moves[ENDGAME_MAX_MOVES];
+    int count;
+    int own = endgame_moves(p, moves, &count);
+    bool root_turn = p->current == p->root;
+
+    if (root_turn && own == 0) return ENDGAME_LOSS; // would have to draw
+    endgame_sort(p, moves + own, count - own, NULL);
+    endgame_sort(p, moves, own, tt_move);
+
+    int alpha0 = alpha;
+    int beta0 = beta;
+    EndgameMove chosen = { -1, ENDGAME_DRAW, 0, 0 };
+
+    // the opponents minimise: their moves on their own turn and their jump-ins
+    // at any turn. On its own turn the root player maximises over its moves,
+    // but gets no more than the jump-ins leave it.
+    int min_score = ENDGAME_WIN;
+    for (int i = root_turn ? own : 0; i < count && min_score > alpha; i++) {
+        int v = endgame_child(s, p, &moves[i], ply, alpha, beta < min_score ? beta : min_score);
+        if (s->aborted) return 0;
+        if (v < min_score) {
+            min_score = v;
+            chosen = moves[i];
+        }
+    }
+    int score = min_score;
+
+    if (root_turn && min_score > alpha) {
+        int max_score = ENDGAME_LOSS;
+        int cap = beta < min_score ? beta : min_score;
+        for (int i = 0; i < own && max_score < cap; i++) {
+            int v = endgame_child(s, p, &moves[i], ply, alpha > max_score ? alpha : max_score, cap);
+            if (s->aborted) return 0;
+            if (v > max_score) {
+                max_score = v;
+                chosen = moves[i];
+                if (best) *best = moves[i];
+            }
+        }
+        if (max_score < score) score = max_score;
+    }
+
+    int bound = score <= alpha0 ? ENDGAME_UPPER : score >= beta0 ? ENDGAME_LOWER : ENDGAME_EXACT;
+    endgame_tt_store(s, p, ply, depth, score, bound, chosen.seat >= 0 ? &chosen : NULL);
+    return score;
+}
+
+// Search `p` for a forced win of its root player within `max_nodes`
+// positions and `budget_ms` (0 = nodes only, which gives the same answer on
+// every run)
+EndgameResult endgame_solve(EndgameSolver *s, const EndgamePos *p, long max_nodes, int budget_ms) {
+    EndgameResult result = { ENDGAME_UNSOLVED, { -1, ENDGAME_DRAW, 0, 0 }, 0, 0 };
+
+    if (++s->generation == 0) { // wrapped, old entries would look current
+        memset(s->tt, 0, sizeof(EndgameEntry) << ENDGAME_TT_BITS);
+        s->generation = 1;
+    }
+    s->nodes = 0;
+    s->max_nodes = max_nodes;
+    s->deadline_ns = budget_ms > 0 ? endgame_now_ns() + budget_ms * 1000000LL : 0;
+    s->aborted = false;
+
+    int score = endgame_search(s, p, 0, ENDGAME_LOSS, ENDGAME_WIN, &result.move);
+    result.nodes = s->nodes;
+    if (s->aborted) return result;
+    if (score > 0 && result.move.seat == p->root) {
+        result.outcome = ENDGAME_FORCED_WIN;
+        result.plies = ENDGAME_WIN - score;
+    } else {
+        result.outcome = ENDGAME_NO_FORCED_WIN;
+    }
+    return result;
+}
+
+// The root player's card for a move: 1-based index in its hand, and the colour
+// code MOVE takes (1-4, 0 if the card is not a wild)
+int endgame_move_card(GameState *game, const EndgamePos *p, const EndgameMove *m, int *colour_code) {
+    Player *P = &game->players[p->seat_of[m->seat]];
+
+    *colour_code = m->kind >= ENDGAME_COLOURED ? m->colour + 1 : 0;
+    for (int i = 0; i < P->hand_size; i++) {
+        if (endgame_kind(&P->hand_cards[i]) == m->kind) return i + 1;
+    }
+    return 0;
+}
+
+// A BOT_SOLVER seat: the forced win if the solver finds one within
+// ENDGAME_NODES, the greedy move otherwise. No time limit, so a seeded
+// tournament still replays the same.
+void bot_solver_move(EndgameSolver *s, GameState *game, int player, unsigned int *seed, char *cmd, size_t size) {
+    EndgamePos p;
+
+    if (s && player == game->current_player && endgame_position(game, false, &p)) {
+        EndgameResult r = endgame_solve(s, &p, ENDGAME_NODES, 0);
+        if (r.outcome == ENDGAME_FORCED_WIN) {
+            int colour;
+            int index = endgame_move_card(game, &p, &r.move, &colour);
+            if (game->players[player].hand_size == 2) colour = 1; // the uno call
+            snprintf(cmd, size, "MOVE %d %d\n", index, colour);
+            return;
+        }
+    }
+    bot_choose_move(game, player, BOT_SOLVER, seed, cmd, size);
+}
+
+#endif // ENDGAME
+
+// Log rotation: game.log and scores.txt roll over by size or age. The writer only
+// renames the full segment and reopens the file; a background thread gzips the
+// segment and deletes the oldest ones beyond the retention limit.
+typedef struct {
+    long max_bytes;         // 0 = no size limit
+    int max_age;            // seconds, 0 = no age limit
+    int keep;               // rotated segments kept per file
+} RotatePolicy;
+
+RotatePolicy log_rotation = { LOG_ROTATE_MB * 1024L * 1024L, 0, LOG_ROTATE_KEEP };
+
+typedef struct {
+    const char *path;
+    FILE *fp;
+    long bytes;             // size of the active segment
+    time_t opened;
+} LogFile;
+
+LogFile game_log = { .path = "game.log" };
+LogFile scores_log = { .path = "scores.txt" };
+
+// Wakes the compressor thread, which sweeps every rotated segment on disk,
+// so a segment is never lost track of however far behind it falls
+struct {
+    int pending;
+    int running;
+    pthread_t tid;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} rotateq = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+static int rotate_compress(const char *segment) {
+    char gz_path[300];
+    char buffer[65536];
+    size_t n;
+    bool ok = true;
+
+    snprintf(gz_path, sizeof(gz_path), "%s.gz", segment);
+    FILE *in = fopen(segment, "rb");
+    if (!in) return -1;
+    gzFile out = gzopen(gz_path, "wb6");
+    if (!out) {
+        fclose(in);
+        return -1;
+    }
+
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (gzwrite(out, buffer, (unsigned)n) != (int)n) {
+            ok = false;
+            break;
+        }
+    }
+    fclose(in);
+    if (gzclose(out) != Z_OK) ok = false;
+
+    if (!ok) {
+        unlink(gz_path);
+        return -1;
+    }
+    unlink(segment);
+    return 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// True for a name logfile_rotate() gives a segment of `base`, that is
+// <base>.<YYYYmmdd-HHMMSS>-<seq>, or the same with .gz once compressed.
+// Anything else next to the log (game.log.bak, an editor's swap file) is left alone.
+static bool rotate_is_segment(const char *name, const char *base, bool *compressed) {
+    static const char shape[] = "dddddddd-dddddd-dddd";
+    size_t base_len = strlen(base);
+
+    if (strncmp(name, base, base_len) != 0 || name[base_len] != '.') return false;
+    name += base_len + 1;
+    for (size_t i = 0; i < sizeof(shape) - 1; i++) {
+        bool ok = shape[i] == 'd' ? isdigit((unsigned char)name[i]) : name[i] == shape[i];
+        if (!ok) return false;
+    }
+    name += sizeof(shape) - 1;
+    *compressed = strcmp(name, ".gz") == 0;
+    return *compressed || *name == '\0';
+}
+
+// Segments are named <base>.<YYYYmmdd-HHMMSS>-<seq>[.gz], so name order is age order.
+// Deletes all but the newest `keep`, then compresses the ones still plain.
+static void rotate_sweep(const char *base, int keep) {
+    DIR *dir = opendir(".");
+    if (!dir) return;
+
+    char **names = NULL;
+    int count = 0, cap = 0;
+    struct dirent *de;
+    bool compressed;
+
+    while ((de = readdir(dir)) != NULL) {
+        if (!rotate_is_segment(de->d_name, base, &compressed)) continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 16;
+            names = realloc(names, sizeof(char *) * cap);
+        }
+        names[count++] = strdup(de->d_name);
+    }
+    closedir(dir);
+
+    qsort(names, count, sizeof(char *), compare_names);
+    for (int i = 0; i < count; i++) {
+        rotate_is_segment(names[i], base, &compressed);
+
+        if (i < count - keep) {
+            unlink(names[i]);
+        } else if (!compressed && rotate_compress(names[i]) == -1) {
+            fprintf(stderr, "Failed to compress %s, left as is\n", names[i]);
+        }
+        free(names[i]);
+    }
+    free(names);
+}
+
+void *rotate_thread_func(void *arg) {
+    (void)arg;
+
+    // compression only gets CPU time nobody else wants
+    struct sched_param param = { 0 };
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+        setpriority(PRIO_PROCESS, 0, 19);
+    }
+
+    pthread_mutex_lock(&rotateq.lock);
+    while (rotateq.running || rotateq.pending) {
+        if (!rotateq.pending) {
+            pthread_cond_wait(&rotateq.cond, &rotateq.lock);
+            continue;
+        }
+        rotateq.pending = 0;
+        pthread_mutex_unlock(&rotateq.lock);
+
+        rotate_sweep(game_log.path, log_rotation.keep);
+        rotate_sweep(scores_log.path, log_rotation.keep);
+
+        pthread_mutex_lock(&rotateq.lock);
+    }
+    pthread_mutex_unlock(&rotateq.lock);
+    return NULL;
+}
+
+void rotate_start(void) {
+    rotateq.running = 1;
+    pthread_create(&rotateq.tid, NULL, rotate_thread_func, NULL);
+}
+
+// Finishes a pending sweep, then stops the thread
+void rotate_stop(void) {
+    pthread_mutex_lock(&rotateq.lock);
+    rotateq.running = 0;
+    pthread_cond_signal(&rotateq.cond);
+    pthread_mutex_unlock(&rotateq.lock);
+    pthread_join(rotateq.tid, NULL);
+}
+
+// Rename the active segment out of the way and reopen an empty one
+static void logfile_rotate(LogFile *lf) {
+    static atomic_int seq;
+    char segment[256];
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm_now;
+
+    fclose(lf->fp);
+    lf->fp = NULL;
+
+    localtime_r(&now, &tm_now);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_now);
+    snprintf(segment, sizeof(segment), "%s.%s-%04d", lf->path, stamp, atomic_fetch_add(&seq, 1) % 10000);
+
+    if (rename(lf->path, segment) == -1) {
+        perror("Failed to rotate log");
+        return;
+    }
+
+    // the writer never waits on the compressor, it only leaves a note
+    pthread_mutex_lock(&rotateq.lock);
+    rotateq.pending = 1;
+    pthread_cond_signal(&rotateq.cond);
+    pthread_mutex_unlock(&rotateq.lock);
+}
+
+// Returns the stream to append one record to, rotating first if it is due
+FILE *logfile_begin(LogFile *lf) {
+    if (lf->fp && lf->bytes > 0) {
+        bool too_big = log_rotation.max_bytes > 0 && lf->bytes >= log_rotation.max_bytes;
+        bool too_old = log_rotation.max_age > 0 && time(NULL) - lf->opened >= log_rotation.max_age;
+        if (too_big || too_old) logfile_rotate(lf);
+    }
+
+    if (!lf->fp) {
+        struct stat st;
+        lf->fp = fopen(lf->path, "a");
+        if (!lf->fp) return NULL;
+        lf->bytes = fstat(fileno(lf->fp), &st) == 0 ? st.st_size : 0;
+        lf->opened = time(NULL);
+    }
+    return lf->fp;
+}
+
+// Record written: push it to the file and account for its size
+void logfile_end(LogFile *lf) {
+    fflush(lf->fp); // Ensure it saves immediately
+    lf->bytes = ftell(lf->fp);
+}
+
+void logfile_close(LogFile *lf) {
+    if (lf->fp) fclose(lf->fp);
+    lf->fp = NULL;
+}
+
+// Reactor whose ring this thread logs to; forked children go back to the shared queue
+static __thread Shard *log_shard;
+
+// A reactor's line goes on its own ring, no lock and no waiting: when the
+// logger is that far behind the line is counted and dropped instead
+static void shard_log(Shard *s, const char *msg) {
+    unsigned tail = atomic_load_explicit(&s->log_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->log_head, memory_order_acquire);
+    if (tail - head == SHARD_LOG_SLOTS) {
+        atomic_fetch_add_explicit(&s->log_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    ShardLogLine *line = &s->log[tail % SHARD_LOG_SLOTS];
+    line->when = time(NULL);
+    snprintf(line->msg, LOG_MSG_LEN, "%s", msg);
+    atomic_store_explicit(&s->log_tail, tail + 1, memory_order_release);
+
+    // only the first line after the logger emptied the ring wakes it, the rest
+    // are picked up in the same pass or at the next LOG_DRAIN_MS tick
+    if (tail == head) sem_post(&logq->count);
+}
+
+// Pass logging mechanism
+void enqueue_log(char *msg) {
+    if (!logq) return; // tools that link the game code run without a logger
+
+    if (log_shard) {
+        shard_log(log_shard, msg);
+        return;
+    }
+
+    time_t now = time(NULL);
+
+    struct tm t;
+    localtime_r(&now, &t);
+
+    char timed_msg[LOG_MSG_LEN];
+
+    int time_len = strftime(timed_msg, LOG_MSG_LEN, "[%H:%M:%S] ", &t);
+    
+    snprintf(timed_msg + time_len, LOG_MSG_LEN - time_len, "%s", msg);
+
+    sem_wait(&logq->space_left);
+    pthread_mutex_lock(&logq->lock);    
+    
+    strncpy(logq->queue[logq->tail], timed_msg, LOG_MSG_LEN - 1);
+    logq->queue[logq->tail][LOG_MSG_LEN - 1] = '\0';
+    
+    logq->tail = (logq->tail + 1) % LOG_QUEUE_SIZE;
+    logq->len++;
+    
+    pthread_mutex_unlock(&logq->lock);
+    sem_post(&logq->count);
+}
+
+// Write out what one reactor logged since the last pass
+static void logger_drain_shard(Shard *s, FILE *fp, unsigned long *dropped) {
+    unsigned head = atomic_load_explicit(&s->log_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&s->log_tail, memory_order_acquire);
+
+    for (; head != tail; head++) {
+        ShardLogLine *line = &s->log[head % SHARD_LOG_SLOTS];
+        struct tm t;
+        char stamp[16];
+        localtime_r(&line->when, &t);
+        strftime(stamp, sizeof(stamp), "[%H:%M:%S] ", &t);
+        fprintf(fp, "%s%s\n", stamp, line->msg);
+    }
+    atomic_store_explicit(&s->log_head, head, memory_order_release);
+
+    unsigned long lost = atomic_load_explicit(&s->log_dropped, memory_order_relaxed);
+    if (lost != *dropped) {
+        fprintf(fp, "LOG: reactor %d dropped %lu line(s)\n", s->id, lost - *dropped);
+        *dropped = lost;
+    }
+}
+
+// Write out the shared queue; true once it held the shutdown line
+static bool logger_drain_queue(LogQueue *lq, FILE *fp) {
+    bool stop = false;
+
+    pthread_mutex_lock(&lq->lock);
+    while (lq->len > 0) {
+        char *line = lq->queue[lq->head];
+        fprintf(fp, "%s\n", line);
+
+        // skip the "[HH:MM:SS] " prefix added by enqueue_log
+        const char *body = strchr(line, ']');
+        if (body && strcmp(body + 2, "SERVER_SHUTDOWN") == 0) stop = true;
+
+        lq->head = (lq->head + 1) % LOG_QUEUE_SIZE;
+        lq->len--;
+        sem_post(&lq->space_left);
+    }
+    pthread_mutex_unlock(&lq->lock);
+    return stop;
+}
+
+// THE ACTUAL THREAD LOGGING
+void *logger_thread_func(void *arg) {
+    LogQueue *lq = (LogQueue *)arg;
+    unsigned long dropped[MAX_SHARDS] = {0};
+    bool stop = false;
+
+    if (!logfile_begin(&game_log)) {
+        perror("Logger failed to open file");
+        pthread_exit(NULL);
+    }
+
+    while (!stop) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += LOG_DRAIN_MS * 1000000L;
+        until.tv_sec += until.tv_nsec / 1000000000L;
+        until.tv_nsec %= 1000000000L;
+        sem_timedwait(&lq->count, &until);
+
+        // take every pending wakeup first: whatever they announced is written
+        // below, and anything posted after this is left for the next pass
+        while (sem_trywait(&lq->count) == 0) {}
+
+        FILE *fp = logfile_begin(&game_log);
+        if (!fp) continue;
+        for (int i = 0; i < num_shards; i++) logger_drain_shard(&shards[i], fp, &dropped[i]);
+        stop = logger_drain_queue(lq, fp);
+        logfile_end(&game_log); // one flush for the whole batch
+    }
+
+    logfile_close(&game_log);
+    return NULL;
+}
+
+// Tell the reactor that owns this table something changed
+void ring_table(Table *t) {
+    int id = t->id;
+    write(t->shard->bell_pipe[1], &id, sizeof(id));
+}
+
+// If player disconnect. A player that quit is gone for good; a closed pipe only
+// marks the seat away, a new client with the seat's token may take it back
+// until the reactor's grace timer runs out.
+void handle_disconnect(Table *t, int player_index, char *player_name, int fd, bool quit) {
+    GameState *game = t->game;
+    char log_msg[LOG_MSG_LEN];
+    bool hold = !quit && resume_grace_ms > 0;
+
+    // the reactor may SIGTERM this child at any moment (a resume, the table
+    // ending); hold that off while it has the log queue or game_lock
+    sigset_t term, old_mask;
+    sigemptyset(&term);
+    sigaddset(&term, SIGTERM);
+    sigprocmask(SIG_BLOCK, &term, &old_mask);
+
+    snprintf(log_msg, LOG_MSG_LEN, "DISCONNECT: Player %s (Index %d) %s.", player_name, player_index,
+        hold ? "lost connection" : "left");
+    enqueue_log(log_msg);
+
+    if (fd != -1) {
+        close(fd);
+    }
+
+    // plain write(), stdio locks may have been held by another thread at fork time
+    char out[128];
+    int len = hold
+        ? snprintf(out, sizeof(out), "Player %s disconnected. Seat held for %d seconds...\n", player_name, resume_grace_ms / 1000)
+        : snprintf(out, sizeof(out), "Player %s disconnected. Cleaning up child process...\n", player_name);
+    write(STDOUT_FILENO, out, len);
+
+    lock_game(game);
+    if (!game->players[player_index].is_active) {
+        // kicked or skipped already, nothing to hold
+    } else if (hold) {
+        clock_gettime(CLOCK_MONOTONIC, &game->players[player_index].away_since);
+    } else {
+        player_leave(game, player_index);
+    }
+    pthread_mutex_unlock(&game->game_lock);
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    ring_table(t);
+    _exit(0); // no stdio flush, the buffers are copies of the server's
+}
+
+static long ms_since(const struct timespec *then) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - then->tv_sec) * 1000 + (now.tv_nsec - then->tv_nsec) / 1000000;
+}
+
+static int ms_until(const struct timespec *when) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (when->tv_sec - now.tv_sec) * 1000 + (when->tv_nsec - now.tv_nsec) / 1000000;
+    return ms < 0 ? 0 : (int)ms;
+}
+
+static void timespec_add_ms(struct timespec *ts, long ms) {
+    ts->tv_nsec += ms * 1000000;
+    ts->tv_sec += ts->tv_nsec / 1000000000;
+    ts->tv_nsec %= 1000000000;
+}
+
+static bool timespec_before(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+void outbox_init(Outbox *ob, int player_index, int fd) {
+    memset(ob, 0, sizeof(*ob));
+    pthread_mutex_init(&ob->lock, NULL);
+    ob->player_index = player_index;
+    ob->fd = fd;
+
+    // the scheduler must never block on a client that stopped reading
+    if (fd != -1) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    } else {
+        ob->disconnected = 1;
+        ob->drop_reason = "no output pipe";
+    }
+}
+
+void outbox_init_shm(Outbox *ob, int player_index, ShmChannel *chan) {
+    outbox_init(ob, player_index, -1);
+    ob->chan = chan;
+    ob->disconnected = 0;
+    ob->drop_reason = NULL;
+}
+
+// Point a seat's outbox at the pipe or channel of the client that took the seat back.
+// Whatever was queued for the old client is thrown away, a full snapshot follows.
+void outbox_rebind(Outbox *ob, int fd, ShmChannel *chan) {
+    pthread_mutex_lock(&ob->lock);
+    if (ob->fd != -1) close(ob->fd);
+    if (ob->chan) {
+        atomic_store(&ob->chan->closed, 1);
+        shm_ring_wake(&ob->chan->response);
+        munmap(ob->chan, sizeof(ShmChannel));
+    }
+
+    ob->fd = fd;
+    ob->chan = chan;
+    if (fd != -1) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    ob->head = ob->count = 0;
+    ob->sent = ob->queued_bytes = 0;
+    ob->stalled_since.tv_sec = ob->stalled_since.tv_nsec = 0;
+    ob->disconnected = ob->drop_reported = ob->hung_up = 0;
+    ob->drop_reason = NULL;
+    pthread_mutex_unlock(&ob->lock);
+}
+
+// caller holds ob->lock
+static void outbox_disconnect_locked(Outbox *ob, const char *reason) {
+    if (ob->disconnected) return;
+
+    ob->disconnected = 1;
+    ob->drop_reason = reason;
+    if (ob->fd != -1) {
+        close(ob->fd);
+        ob->fd = -1;
+    }
+    if (ob->chan) {
+        atomic_store(&ob->chan->closed, 1);
+        shm_ring_wake(&ob->chan->response);
+    }
+    ob->head = ob->count = 0;
+    ob->sent = ob->queued_bytes = 0;
+}
+
+// Shared memory clients: copy whole messages into the response ring
+static size_t outbox_flush_ring_locked(Outbox *ob) {
+    bool pushed = false;
+
+    if (atomic_load(&ob->chan->closed)) {
+        ob->hung_up = 1;
+        outbox_disconnect_locked(ob, "client closed its channel");
+        return 0;
+    }
+
+    while (ob->count > 0) {
+        OutboxMsg *m = &ob->msgs[ob->head];
+        // a frame longer than a ring slot goes in slot sized pieces, the
+        // client reads the ring as a byte stream and splits it into lines
+        size_t n = m->len - ob->sent;
+        if (n > SHM_RING_MSG_LEN) n = SHM_RING_MSG_LEN;
+        if (!shm_ring_push(&ob->chan->response, outbox_msg_bytes(m) + ob->sent, n)) {
+            // ring full, same stall clock as a full pipe
+            if (ob->stalled_since.tv_sec == 0)
+                clock_gettime(CLOCK_MONOTONIC, &ob->stalled_since);
+            break;
+        }
+        pushed = true;
+        ob->sent += n;
+        ob->queued_bytes -= n;
+        ob->stalled_since.tv_sec = ob->stalled_since.tv_nsec = 0;
+        if (ob->sent == m->len) {
+            ob->head = (ob->head + 1) % OUTBOX_SLOTS;
+            ob->count--;
+            ob->sent = 0;
+        }
+    }
+
+    if (pushed) shm_ring_wake(&ob->chan->response);
+    return ob->queued_bytes;
+}
+
+// Write as much as the pipe takes right now, returns bytes still queued
+static size_t outbox_flush_locked(Outbox *ob) {
+    if (ob->chan && !ob->disconnected) return outbox_flush_ring_locked(ob);
+
+    while (ob->count > 0 && !ob->disconnected) {
+        OutboxMsg *m = &ob->msgs[ob->head];
+        ssize_t n = write(ob->fd, outbox_msg_bytes(m) + ob->sent, m->len - ob->sent);
+
+        if (n > 0) {
+            ob->sent += n;
+            ob->queued_bytes -= n;
+            ob->stalled_since.tv_sec = ob->stalled_since.tv_nsec = 0;
+
+            if (ob->sent == m->len) {
+                ob->head = (ob->head + 1) % OUTBOX_SLOTS;
+                ob->count--;
+                ob->sent = 0;
+            }
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1 && errno == EAGAIN) {
+            // pipe buffer full, start the stall clock
+            if (ob->stalled_since.tv_sec == 0)
+                clock_gettime(CLOCK_MONOTONIC, &ob->stalled_since);
+            break;
+        } else {
+            // EPIPE (SIGPIPE is ignored) or any other write error
+            ob->hung_up = errno == EPIPE;
+            outbox_disconnect_locked(ob, "client closed its pipe");
+        }
+    }
+    return ob->queued_bytes;
+}
+
+// Queue a message for a client and try to push it out straight away.
+// Slow consumer policy: a STATE frame replaces the stale one still waiting
+// in the queue, and if the queue is still full the client gets dropped.
+bool outbox_send(Outbox *ob, OutboxMsgKind kind, const char *data, size_t len) {
+    pthread_mutex_lock(&ob->lock);
+    if (ob->disconnected) {
+        pthread_mutex_unlock(&ob->lock);
+        return false;
+    }
+
+    OutboxMsg *slot = NULL;
+    if (kind == OUTBOX_MSG_STATE) {
+        for (int i = 0; i < ob->count; i++) {
+            int idx = (ob->head + i) % OUTBOX_SLOTS;
+            // a frame that is half written has to go out as it is
+            if (ob->msgs[idx].kind == OUTBOX_MSG_STATE && !(i == 0 && ob->sent > 0)) {
+                slot = &ob->msgs[idx];
+                ob->queued_bytes -= slot->len;
+                ob->coalesced++;
+                break;
+            }
+        }
+    }
+
+    if (slot == NULL) {
+        if (ob->count == OUTBOX_SLOTS) {
+            outbox_disconnect_locked(ob, "outbound queue overflow");
+            pthread_mutex_unlock(&ob->lock);
+            return false;
+        }
+        slot = &ob->msgs[(ob->head + ob->count) % OUTBOX_SLOTS];
+        ob->count++;
+    }
+
+    // a frame too long for the slot goes to its heap buffer, grown as needed;
+    // if that fails the frame is cut short as the client would take it anyway
+    char *dst = slot->data;
+    if (len > OUTBOX_MSG_LEN) {
+        if (len > slot->big_cap) {
+            char *big = realloc(slot->big, len);
+            if (big) {
+                slot->big = big;
+                slot->big_cap = len;
+            }
+        }
+        if (len <= slot->big_cap) dst = slot->big;
+        else len = OUTBOX_MSG_LEN;
+    }
+    slot->kind = kind;
+    slot->len = len;
+    memcpy(dst, data, len);
+    ob->queued_bytes += len;
+
+    if (ob->queued_bytes > ob->high_water_bytes) ob->high_water_bytes = ob->queued_bytes;
+    if (ob->count > ob->high_water_msgs) ob->high_water_msgs = ob->count;
+
+    // leftovers are flushed by the reactor once the pipe is writable
+    outbox_flush_locked(ob);
+    bool alive = !ob->disconnected;
+    pthread_mutex_unlock(&ob->lock);
+    return alive;
+}
+
+// Same as handle_disconnect but run by the reactor for a dropped client.
+// A client that hung up keeps its seat for the grace window, a slow one loses it.
+void outbox_report_drop(Table *t, int player_index, const char *reason, bool hung_up) {
+    GameState *game = t->game;
+    char log_msg[LOG_MSG_LEN];
+
+    lock_game(game);
+    Player *P = &game->players[player_index];
+    if (P->is_active && hung_up && resume_grace_ms > 0) {
+        if (P->away_since.tv_sec == 0) clock_gettime(CLOCK_MONOTONIC, &P->away_since);
+    } else if (P->is_active) {
+        printf("Player %s dropped: %s\n", P->player_name, reason);
+        snprintf(log_msg, LOG_MSG_LEN, "SLOW_CONSUMER: Player %.40s dropped (%s)", P->player_name, reason);
+        enqueue_log(log_msg);
+
+        player_leave(game, player_index);
+    }
+    pthread_mutex_unlock(&game->game_lock);
+}
+
+// Stall timeouts and drops that still have to reach the game state,
+// returns true if a player was dropped
+bool outbox_check_policy(Table *t) {
+    bool dropped = false;
+
+    for (int p = 0; p < t->game->num_players; p++) {
+        Outbox *ob = &t->outboxes[p];
+        const char *reason = NULL;
+        bool hung_up = false;
+
+        pthread_mutex_lock(&ob->lock);
+        if (!ob->disconnected && ob->count > 0 && ob->stalled_since.tv_sec != 0
+            && ms_since(&ob->stalled_since) > OUTBOX_STALL_MS) {
+            outbox_disconnect_locked(ob, "stopped reading for too long");
+        }
+        if (ob->disconnected && !ob->drop_reported) {
+            ob->drop_reported = 1;
+            reason = ob->drop_reason;
+            hung_up = ob->hung_up;
+        }
+        pthread_mutex_unlock(&ob->lock);
+
+        // never hold an outbox lock while taking game_lock
+        if (reason && t->phase == TABLE_PLAYING) {
+            outbox_report_drop(t, p, reason, hung_up);
+            dropped = true;
+        }
+    }
+    return dropped;
+}
+
+void outbox_report_high_water(Table *t) {
+    char log_msg[LOG_MSG_LEN];
+
+    printf("\nOutbound queue high-water marks (table %d):\n", t->id);
+    for (int p = 0; p < t->game->num_players; p++) {
+        Outbox *ob = &t->outboxes[p];
+        Player *P = &t->game->players[p];
+
+        printf(" - %s: %zu bytes, %d messages, %d stale frames coalesced%s%s\n",
+            P->player_name, ob->high_water_bytes, ob->high_water_msgs, ob->coalesced,
+            ob->disconnected ? ", dropped: " : "", ob->disconnected ? ob->drop_reason : "");
+        snprintf(log_msg, LOG_MSG_LEN, "OUTBOX %.40s: high-water %zu bytes / %d msgs, %d coalesced",
+            P->player_name, ob->high_water_bytes, ob->high_water_msgs, ob->coalesced);
+        enqueue_log(log_msg);
+    }
+}
+
+// Copy what the clients see into game->snap. Caller holds game_lock. The
+// reactor that owns the table is the only writer and the only reader, so a
+// plain copy will do; other threads see the table through its TableView.
+void game_publish(GameState *game) {
+    GameSnapshot *snap = &game->snap;
+
+    snap->version++;
+    snap->top = game->played_cards[game->current_card_idx];
+    snap->current_player = game->current_player;
+    snap->direction = game->direction;
+    snap->num_players = game->num_players;
+    for (int p = 0; p < game->num_players; p++) {
+        Player *P = &game->players[p];
+        snap->active[p] = P->is_active;
+
+        // a move changes one or two hands, the rest are already current
+        if (snap->hand_seen[p] == P->hand_changes) continue;
+        if (!cards_reserve(game->arena, &snap->hands[p], &snap->hand_cap[p], P->hand_size)) continue;
+        if (P->hand_size > 0) memcpy(snap->hands[p], P->hand_cards, sizeof(Card) * P->hand_size);
+        snap->hand_size[p] = P->hand_size;
+        snap->hand_seen[p] = P->hand_changes;
+    }
+}
+
+// Text of a frame being built for one client. It starts in `local` and only
+// moves to the heap for a hand too long for OUTBOX_MSG_LEN; the struct must
+// not be copied while `text` may point at `local`.
+typedef struct {
+    char *text;
+    size_t len;
+    size_t cap;
+    char local[OUTBOX_MSG_LEN];
+} Frame;
+
+void frame_init(Frame *f, const char *text) {
+    f->text = f->local;
+    f->cap = sizeof(f->local);
+    f->len = snprintf(f->local, f->cap, "%s", text);
+}
+
+void frame_free(Frame *f) {
+    if (f->text != f->local) free(f->text);
+    f->text = f->local;
+}
+
+// Room for n more bytes and the terminator, NULL if memory ran out
+static char *frame_room(Frame *f, size_t n) {
+    if (f->len + n + 1 > f->cap) {
+        size_t cap = f->cap;
+        while (f->len + n + 1 > cap) cap *= 2;
+        char *text = realloc(f->text == f->local ? NULL : f->text, cap);
+        if (!text) return NULL;
+        if (f->text == f->local) memcpy(text, f->local, f->len + 1);
+        f->text = text;
+        f->cap = cap;
+    }
+    return f->text + f->len;
+}
+
+static bool frame_append(Frame *f, const char *s) {
+    size_t n = strlen(s);
+    char *at = frame_room(f, n);
+    if (!at) return false;
+    memcpy(at, s, n + 1);
+    f->len += n;
+    return true;
+}
+
+// PILE/HAND frame for one player, appended to f. The whole hand goes on one
+// line however long it is; only running out of memory cuts it short.
+void format_player_state(const GameSnapshot *snap, int player_index, Frame *f) {
+    char card_str[50];
+
+    // Send top card on pile
+    format_card_to_string(&snap->top, card_str);
+    frame_append(f, "PILE:");
+    frame_append(f, card_str);
+    frame_append(f, "\nHAND:");
+
+    // Send player's hand
+    for (int i = 0; i < snap->hand_size[player_index]; i++) {
+        format_card_to_string(&snap->hands[player_index][i], card_str);
+        // Add comma if not the first card
+        if (i > 0 && !frame_append(f, ",")) break;
+        if (!frame_append(f, card_str)) break;
+    }
+    frame_append(f, "\n");
+}
+
+// TURN prompt for one player, appended to f like format_player_state():
+// "TURN <hand size> <playable> <wild>". The two masks are hex strings, one digit
+// per four cards in hand order (the first digit's 1 bit is card 1): which cards
+// may be played on the pile, and which of those need a colour. The client uses
+// them to refuse a move the server would turn down. Only when memory runs out
+// is a bare TURN sent, and the client goes back to sending moves unchecked.
+void format_turn(const GameSnapshot *snap, int player_index, Frame *f) {
+    static const char hex[] = "0123456789abcdef";
+    int hand_size = snap->hand_size[player_index];
+    int digits = hand_size > 0 ? (hand_size + 3) / 4 : 1;
+
+    char *at = frame_room(f, 2 * digits + 32);
+    if (!at) {
+        frame_append(f, "TURN\n");
+        return;
+    }
+
+    int len = sprintf(at, "TURN %d ", hand_size);
+    char *playable = at + len;
+    char *wild = playable + digits + 1;
+    memset(playable, 0, 2 * digits + 1);
+    for (int i = 0; i < hand_size; i++) {
+        Card *c = &snap->hands[player_index][i];
+        if (!playable_card(c, (Card *)&snap->top)) continue;
+        playable[i / 4] |= 1 << (i % 4);
+        if (c->type == CARD_WILD_TYPE || c->type == CARD_WILD_DRAW_FOUR_TYPE) wild[i / 4] |= 1 << (i % 4);
+    }
+    for (int d = 0; d < digits; d++) {
+        playable[d] = hex[(int)playable[d]];
+        wild[d] = hex[(int)wild[d]];
+    }
+    playable[digits] = ' ';
+    wild[digits] = '\n';
+    wild[digits + 1] = '\0';
+    f->len += len + 2 * digits + 2;
+}
+
+// Queue the player's PILE/HAND frame, built from the last published snapshot
+void update_player_client(GameState *game, int player_index, Outbox *ob) {
+    Frame f;
+    frame_init(&f, "");
+
+    format_player_state(&game->snap, player_index, &f);
+
+    // Queue the message for the player
+    outbox_send(ob, OUTBOX_MSG_STATE, f.text, f.len);
+    frame_free(&f);
+}
+
+int get_card_score(Card *c) {
+    if (c->type == CARD_NUMBER_TYPE) {
+        return c->value;
+    } else if (c->type == CARD_WILD_TYPE || c->type == CARD_WILD_DRAW_FOUR_TYPE) {
+        return 50;
+    } else {
+        return 20;
+    }
+}
+
+// Penalty points still held in a hand, the lower the better
+int player_score(Player *P) {
+    return P->hand_index.score;
+}
+
+void save_scores(GameState *game) {
+    // several reactors can finish a game at the same time
+    static pthread_mutex_t scores_lock = PTHREAD_MUTEX_INITIALIZER;
+
+    pthread_mutex_lock(&scores_lock);
+    FILE *fp = logfile_begin(&scores_log);
+    if (!fp) {
+        perror("Failed to open scores.txt");
+        pthread_mutex_unlock(&scores_lock);
+        return;
+    }
+
+    time_t now = time(NULL);
+    char time_str[32];
+    ctime_r(&now, time_str);
+    time_str[strcspn(time_str, "\n")] = '\0';
+
+    fprintf(fp, "[%s] GAME SCORES: ", time_str);
+    printf("\nSaving Final Scores:\n");
+
+    for (int i = 0; i < game->num_players; i++) {
+        Player *P = &game->players[i];
+        int total_score = player_score(P);
+
+        fprintf(fp, "%s: %d points; ", P->player_name, total_score);
+        printf(" - %s: %d points\n", P->player_name, total_score);
+    }
+
+    fprintf(fp, "\n");
+    logfile_end(&scores_log);
+    pthread_mutex_unlock(&scores_lock);
+    printf("Scores saved to scores.txt\n");
+}
+// function to clean up child processes of disconnected players
+void reap_child_processes(Player *player) {
+    if (player->input_pid <= 0) return;
+
+    pid_t check = waitpid(player->input_pid, NULL, WNOHANG);
+
+    if(check > 0){
+        char log_msg[LOG_MSG_LEN];
+        snprintf(log_msg, LOG_MSG_LEN, "Child %.30s with PID of %d has been reaped after disconnection.", player->player_name, player->input_pid);
+        enqueue_log(log_msg);
+        player->input_pid = 0;
+        }
+    else if(check == -1){
+        perror("reaping child process failed");
+    }
+}
+
+// Hand one move (a line, the newline optional) over to the reactor. A full
+// queue holds the player up until the reactor gets through it, nothing is dropped.
+static void input_child_store(Table *t, int i, const char *line, const struct timespec *arrived) {
+    GameState *game = t->game;
+    SeatQueue *q = &game->moves[i];
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head;
+
+    // full: sleep on head until the reactor frees a slot, the way a shared
+    // memory ring's consumer sleeps on its seq
+    while (tail - (head = atomic_load(&q->head)) >= SEAT_QUEUE_LEN) {
+        atomic_fetch_add(&q->waiters, 1);
+        // a slot freed after the load above changed head, so the wait returns at once
+        syscall(SYS_futex, &q->head, FUTEX_WAIT, head, NULL, NULL, 0);
+        atomic_fetch_sub(&q->waiters, 1);
+    }
+
+    // a SIGTERM from the reactor (resume, table over) waits until the move is
+    // published: dying between the count and the tail would leave moves_ready
+    // one too high for the rest of the game
+    sigset_t term, old_mask;
+    sigemptyset(&term);
+    sigaddset(&term, SIGTERM);
+    sigprocmask(SIG_BLOCK, &term, &old_mask);
+
+    SeatMove *m = &q->slots[tail % SEAT_QUEUE_LEN];
+    size_t len = strcspn(line, "\n");
+    if (len >= sizeof(m->cmd)) len = sizeof(m->cmd) - 1;
+    memcpy(m->cmd, line, len);
+    m->cmd[len] = '\0';
+    m->seq = ++q->next_seq;
+    m->arrived = *arrived;
+
+    // counted before it is visible, so moves_ready never falls short of what is queued
+    atomic_fetch_add(&game->moves_ready, 1);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    sigprocmask(SIG_SETMASK, &old_mask, NULL); // not across a doorbell write that may block
+    ring_table(t); // wake up the reactor
+}
+
+// Bytes from the client, split into moves. A read() may end mid-line or hold
+// several lines; the part of a line still to come waits in `in`.
+typedef struct {
+    char buf[256];
+    size_t len;
+} InputLines;
+
+static void input_child_feed(Table *t, int i, InputLines *in, const char *data, size_t n, int fd) {
+    struct timespec arrived;
+    // stamp it before anything else, jump-in arbitration goes by arrival
+    clock_gettime(CLOCK_MONOTONIC, &arrived);
+
+    for (size_t k = 0; k < n; k++) {
+        if (data[k] != '\n') {
+            if (in->len < sizeof(in->buf) - 1) in->buf[in->len++] = data[k]; // an overlong line is cut
+            continue;
+        }
+        in->buf[in->len] = '\0';
+        in->len = 0;
+        if (strncmp(in->buf, "QUIT", 4) == 0) handle_disconnect(t, i, t->game->players[i].player_name, fd, true);
+        if (in->buf[0] != '\0') input_child_store(t, i, in->buf, &arrived);
+    }
+}
+
+// Shared memory client: sleep on the request ring's futex instead of read()
+void input_child_loop_shm(Table *t, int i, ShmChannel *chan) {
+    Player *P = &t->game->players[i];
+    char buffer[SHM_RING_MSG_LEN + 1];
+    InputLines in = {0};
+
+    while (1) {
+        int n = shm_ring_pop(&chan->request, buffer, SHM_RING_MSG_LEN);
+
+        if (n >= 0) {
+            // a message is a whole line, the newline may have been left off
+            if (n == 0 || buffer[n - 1] != '\n') buffer[n++] = '\n';
+            input_child_feed(t, i, &in, buffer, n, -1);
+            continue;
+        }
+
+        // no EOF on a ring, so check the flag and that the client still exists
+        if (atomic_load(&chan->closed) || (kill(P->pid, 0) == -1 && errno == ESRCH)) {
+            handle_disconnect(t, i, P->player_name, -1, false);
+        }
+        shm_ring_wait(&chan->request, 1000);
+    }
+}
+
+// Child process: forwards one player's input into the table's shared state.
+// `chan` is the seat's shared memory channel, NULL for a FIFO client.
+void input_child_loop(Table *t, int i, ShmChannel *chan) {
+    GameState *game = t->game;
+    Player *P = &game->players[i];
+
+    if (chan) {
+        input_child_loop_shm(t, i, chan);
+    }
+
+    char client_in_fifo[64];
+    snprintf(client_in_fifo, 64, "/tmp/client_%d_in", P->pid);
+
+    // the client creates its input FIFO only after we opened its output one
+    int player_fd = -1;
+    for (int tries = 0; tries < 100 && player_fd == -1; tries++) {
+        player_fd = open(client_in_fifo, O_RDONLY);
+        if (player_fd == -1 && errno == ENOENT) usleep(50000);
+        else if (player_fd == -1 && errno != EINTR) break;
+    }
+    if(player_fd == -1){
+        char out[128];
+        int len = snprintf(out, sizeof(out), "Child failed to open player input pipe: %s\n", strerror(errno));
+        write(STDERR_FILENO, out, len);
+        handle_disconnect(t, i, P->player_name, -1, false);
+    }
+
+    InputLines in = {0};
+
+    while (1) {
+        char buffer[1024];
+        int n = read(player_fd, buffer, sizeof(buffer));
+
+        if (n > 0) {
+            // Process Game Move [ELSA PART]
+            input_child_feed(t, i, &in, buffer, n, player_fd);
+
+        } else if (n == 0 || errno != EINTR) {
+            handle_disconnect(t, i, P->player_name, player_fd, false);
+        }
+    }
+}
+
+static bool seat_connected(Seat *seat) {
+    return seat->fd != -1 || seat->chan != NULL;
+}
+
+static void seat_send(Seat *seat, const char *msg, size_t len) {
+    if (seat->chan) {
+        shm_ring_push(&seat->chan->response, msg, len);
+        shm_ring_wake(&seat->chan->response);
+    } else if (seat->fd != -1) {
+        write(seat->fd, msg, len); // non-blocking, a client that is not reading just misses it
+    }
+}
+
+static void seat_release(Seat *seat) {
+    if (seat->fd != -1) close(seat->fd);
+    if (seat->chan) munmap(seat->chan, sizeof(ShmChannel));
+    seat->fd = -1;
+    seat->chan = NULL;
+}
+
+// Seat reclaim tokens: token -> table and seat, filled when a table is handed to a
+// reactor and emptied when it ends. The lobby looks RESUME joins up here, the
+// reactor checks the token against the seat again before giving it away.
+// Open addressing on the (random) token, removed entries leave a tombstone.
+#define SESSION_TOMBSTONE 1
+
+typedef struct {
+    uint64_t token;         // 0 = never used, SESSION_TOMBSTONE = removed
+    int shard;
+    int table_id;
+    int seat;
+} Session;
+
+static Session sessions[SESSION_SLOTS];
+static int sessions_used;   // live entries plus tombstones
+static pthread_mutex_t sessions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t session_new_token(void) {
+    static unsigned int seed;
+    uint64_t token = 0;
+
+    // never 0 or the tombstone, those mark free slots
+    while (token <= SESSION_TOMBSTONE) {
+        if (getrandom(&token, sizeof(token), 0) != sizeof(token)) {
+            if (seed == 0) seed = time(NULL) ^ getpid();
+            token = ((uint64_t)rand_r(&seed) << 32) ^ rand_r(&seed) ^ ((uint64_t)rand_r(&seed) << 16);
+        }
+    }
+    return token;
+}
+
+// caller holds sessions_lock
+static Session *session_slot(uint64_t token, bool insert) {
+    Session *tomb = NULL;
+
+    for (int i = 0; i < SESSION_SLOTS; i++) {
+        Session *e = &sessions[(token + i) & (SESSION_SLOTS - 1)];
+        if (e->token == token) return e;
+        if (e->token == SESSION_TOMBSTONE && !tomb) tomb = e;
+        if (e->token == 0) return insert ? (tomb ? tomb : e) : NULL;
+    }
+    return insert ? tomb : NULL;
+}
+
+// Drop the tombstones once they fill a quarter of the table
+static void session_rehash_locked(void) {
+    static Session old[SESSION_SLOTS];
+
+    memcpy(old, sessions, sizeof(sessions));
+    memset(sessions, 0, sizeof(sessions));
+    sessions_used = 0;
+    for (int i = 0; i < SESSION_SLOTS; i++) {
+        if (old[i].token <= SESSION_TOMBSTONE) continue;
+        *session_slot(old[i].token, true) = old[i];
+        sessions_used++;
+    }
+}
+
+void session_add(uint64_t token, int shard, int table_id, int seat) {
+    pthread_mutex_lock(&sessions_lock);
+    if (sessions_used >= SESSION_SLOTS * 3 / 4) session_rehash_locked();
+
+    // a full table only costs this seat its reclaim
+    Session *e = sessions_used < SESSION_SLOTS * 3 / 4 ? session_slot(token, true) : NULL;
+    if (e) {
+        if (e->token == 0) sessions_used++;
+        *e = (Session){ .token = token, .shard = shard, .table_id = table_id, .seat = seat };
+    }
+    pthread_mutex_unlock(&sessions_lock);
+}
+
+bool session_find(uint64_t token, Session *out) {
+    pthread_mutex_lock(&sessions_lock);
+    Session *e = token > SESSION_TOMBSTONE ? session_slot(token, false) : NULL;
+    if (e) *out = *e;
+    pthread_mutex_unlock(&sessions_lock);
+    return e != NULL;
+}
+
+void session_remove(uint64_t token) {
+    pthread_mutex_lock(&sessions_lock);
+    Session *e = token > SESSION_TOMBSTONE ? session_slot(token, false) : NULL;
+    if (e) e->token = SESSION_TOMBSTONE; // still counted in sessions_used until the rehash
+    pthread_mutex_unlock(&sessions_lock);
+}
+
+// Game history file (see history.h). Every reactor collects the moves of its
+// finished games and appends a whole block at a time under history_lock.
+char history_path[256] = HISTORY_FILE;
+int history_fd = -1;
+pthread_mutex_t history_lock = PTHREAD_MUTEX_INITIALIZER;
+atomic_uint history_next_game = 1;
+
+// Pick up the game numbering where the file left off. A block cut short by a
+// crash is truncated away, so appends always follow a complete block.
+void history_open(void) {
+    history_fd = open(history_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (history_fd == -1) {
+        perror("Failed to open the game history file");
+        return;
+    }
+
+    off_t size = lseek(history_fd, 0, SEEK_END);
+    off_t off = 0;
+    HistoryBlockHeader h;
+    while (off + (off_t)sizeof(h) <= size && pread(history_fd, &h, sizeof(h), off) == sizeof(h)) {
+        if (h.magic != HISTORY_MAGIC || h.version != HISTORY_VERSION || off + h.block_bytes > size) break;
+        if (h.games > 0 && h.max[HIST_COL_GAME] >= atomic_load(&history_next_game))
+            atomic_store(&history_next_game, h.max[HIST_COL_GAME] + 1);
+        off += h.block_bytes;
+    }
+    if (off < size) {
+        fprintf(stderr, "Game history: dropping %lld bytes of an incomplete block\n", (long long)(size - off));
+        ftruncate(history_fd, off);
+    }
+}
+
+static uint8_t history_card(const Card *c) {
+    return history_card_byte(c->colour, c->value);
+}
+
+void table_history_add(Table *t, int player, uint8_t card, HistoryAction action, int hand) {
+    if (t->history_len == t->history_cap) {
+        // rows move up in the table's arena, the old ones go with it
+        HistoryRow *grown = arena_alloc(t->arena, sizeof(HistoryRow) * t->history_cap * 2);
+        if (!grown) return;
+        memcpy(grown, t->history, sizeof(HistoryRow) * t->history_len);
+        t->history = grown;
+        t->history_cap *= 2;
+    }
+    t->history[t->history_len++] = (HistoryRow){
+        .turn = action == HIST_DEAL ? 0 : ++t->turn,
+        .player = player, .card = card, .action = action, .hand = hand > 255 ? 255 : hand
+    };
+}
+
+// Write the reactor's finished games out as one block
+void shard_history_flush(Shard *s) {
+    if (s->history_len == 0 || history_fd == -1) return;
+
+    size_t offsets[HIST_COLUMNS + 1];
+    uint32_t rows = s->history_len, games = s->history_games_len;
+    size_t bytes = history_layout(rows, games, offsets);
+    // one buffer per reactor, reused for every block it writes
+    if (bytes > s->history_block_cap) {
+        char *grown = realloc(s->history_block, bytes);
+        if (!grown) return;
+        s->history_block = grown;
+        s->history_block_cap = bytes;
+    }
+    char *block = s->history_block;
+    memset(block, 0, bytes);
+    HistoryBlockHeader *h = (HistoryBlockHeader *)block;
+
+    *h = (HistoryBlockHeader){ .magic = HISTORY_MAGIC, .version = HISTORY_VERSION,
+        .header_size = sizeof(HistoryBlockHeader), .block_bytes = bytes, .rows = rows, .games = games };
+    for (int c = 0; c < HIST_COLUMNS; c++) h->min[c] = UINT32_MAX;
+
+    uint32_t *game = (uint32_t *)(block + offsets[HIST_COL_GAME]);
+    uint16_t *turn = (uint16_t *)(block + offsets[HIST_COL_TURN]);
+    uint8_t *player = (uint8_t *)(block + offsets[HIST_COL_PLAYER]);
+    uint8_t *card = (uint8_t *)(block + offsets[HIST_COL_CARD]);
+    uint8_t *action = (uint8_t *)(block + offsets[HIST_COL_ACTION]);
+    uint8_t *hand = (uint8_t *)(block + offsets[HIST_COL_HAND]);
+
+    for (uint32_t i = 0; i < rows; i++) {
+        HistoryRow *r = &s->history[i];
+        uint32_t v[HIST_COLUMNS] = { r->game, r->turn, r->player, r->card, r->action, r->hand };
+        game[i] = r->game;
+        turn[i] = r->turn;
+        player[i] = r->player;
+        card[i] = r->card;
+        action[i] = r->action;
+        hand[i] = r->hand;
+        for (int c = 0; c < HIST_COLUMNS; c++) {
+            if (v[c] < h->min[c]) h->min[c] = v[c];
+            if (v[c] > h->max[c]) h->max[c] = v[c];
+        }
+    }
+    memcpy(block + offsets[HIST_COLUMNS], s->history_games, sizeof(HistoryGame) * games);
+
+    // one write per block, so blocks from different reactors never interleave
+    pthread_mutex_lock(&history_lock);
+    if (write(history_fd, block, bytes) != (ssize_t)bytes) perror("Failed to write game history");
+    pthread_mutex_unlock(&history_lock);
+
+    s->history_len = s->history_games_len = 0;
+}
+
+// Hand a finished table's moves to its reactor's pending block
+void shard_history_add_game(Shard *s, Table *t) {
+    GameState *game = t->game;
+    uint32_t id = atomic_fetch_add(&history_next_game, 1);
+    uint8_t winner = HISTORY_NO_WINNER;
+
+    for (int p = 0; p < game->num_players; p++) {
+        if (game->winner_pid != 0 && game->players[p].pid == game->winner_pid) winner = p;
+    }
+
+    // a block holds whole games, close the current one first if this game would overflow it
+    if (s->history_len > 0 && s->history_len + t->history_len > HISTORY_BLOCK_ROWS) shard_history_flush(s);
+
+    if (s->history_len + t->history_len > s->history_cap) {
+        s->history_cap = s->history_len + t->history_len + HISTORY_BLOCK_ROWS;
+        s->history = realloc(s->history, sizeof(HistoryRow) * s->history_cap);
+    }
+    for (int i = 0; i < t->history_len; i++) {
+        s->history[s->history_len] = t->history[i];
+        s->history[s->history_len++].game = id;
+    }
+
+    if (s->history_games_len == s->history_games_cap) {
+        s->history_games_cap = s->history_games_cap ? s->history_games_cap * 2 : 64;
+        s->history_games = realloc(s->history_games, sizeof(HistoryGame) * s->history_games_cap);
+    }
+    s->history_games[s->history_games_len++] = (HistoryGame){
+        .game = id, .turns = t->turn, .players = game->num_players, .winner = winner
+    };
+
+    if (s->history_len >= HISTORY_BLOCK_ROWS) shard_history_flush(s);
+}
+
+// Build a table from seated players, deal the cards and pick a shard later
+Table *table_create(int num_players, Seat seats[]) {
+    Arena *arena = arena_get();
+    if (!arena) {
+        perror("mmap failed");
+        return NULL;
+    }
+
+    // the game goes first so it lands in the arena's first (shared) block
+    GameState *game = arena_alloc(arena, sizeof(GameState));
+    Table *t = arena_alloc(arena, sizeof(Table));
+    Outbox *outboxes = arena_alloc(arena, sizeof(Outbox) * num_players);
+    int history_cap = START_CARD_DECK * num_players + 256;
+    HistoryRow *history = arena_alloc(arena, sizeof(HistoryRow) * history_cap);
+    if (!game || !t || !outboxes || !history) {
+        perror("mmap failed");
+        arena_put(arena);
+        return NULL;
+    }
+    t->arena = arena;
+    t->outboxes = outboxes;
+    t->history = history;
+    t->history_cap = history_cap;
+    game->arena = arena;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&game->game_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    t->id = atomic_fetch_add(&next_table_id, 1);
+    t->game = game;
+    t->awaiting = -1;
+
+    game->num_players = num_players;
+    for (int i = 0; i < num_players; i++) {
+        strncpy(game->players[i].player_name, seats[i].name, NAME_SIZE - 1);
+        game->players[i].pid = seats[i].pid;
+        game->players[i].token = seats[i].token;
+        if (seats[i].chan) {
+            outbox_init_shm(&t->outboxes[i], i, seats[i].chan);
+        } else {
+            outbox_init(&t->outboxes[i], i, seats[i].fd);
+        }
+    }
+
+    // initialize game state
+    game_deal(game, deck_count(num_players));
+    game_publish(game);
+    return t;
+}
+
+void table_destroy(Table *t) {
+    GameState *game = t->game;
+    Arena *arena = t->arena;
+
+    for (int i = 0; i < game->num_players; i++) {
+        Outbox *ob = &t->outboxes[i];
+        pthread_mutex_lock(&ob->lock);
+        if (ob->fd != -1) {
+            close(ob->fd);
+            // set the player pipes to -1 to show it is closed
+            ob->fd = -1;
+        }
+        if (ob->chan) {
+            atomic_store(&ob->chan->closed, 1);
+            shm_ring_wake(&ob->chan->response);
+            munmap(ob->chan, sizeof(ShmChannel));
+            ob->chan = NULL;
+        }
+        for (int m = 0; m < OUTBOX_SLOTS; m++) free(ob->msgs[m].big);
+        pthread_mutex_unlock(&ob->lock);
+        pthread_mutex_destroy(&ob->lock);
+    }
+
+    // Clean up the remaining child processes
+    for (int i = 0; i < game->num_players; i++) {
+        Player *P = &game->players[i];
+        if (P->input_pid > 0) {
+            kill(P->input_pid, SIGTERM);
+            waitpid(P->input_pid, NULL, 0);
+            P->input_pid = 0;
+        }
+    }
+
+    // the game, table and everything they allocated go back in one piece
+    game_free(game);
+    arena_put(arena);
+}
+
+// Send the current player their state and the TURN prompt
+void table_prompt(Table *t) {
+    GameState *game = t->game;
+    int player = game->snap.current_player;
+
+    update_player_client(game, player, &t->outboxes[player]);
+
+    // inform next player of their move, with the cards it may play
+    Frame f;
+    frame_init(&f, "");
+    format_turn(&game->snap, player, &f);
+    outbox_send(&t->outboxes[player], OUTBOX_MSG_EVENT, f.text, f.len);
+    frame_free(&f);
+    t->awaiting = player;
+}
+
+// Record an applied move from the snapshot: the card played, or the one drawn
+static void table_history_move(Table *t, int mover, bool jump_in, MoveOutcome outcome, bool played) {
+    GameSnapshot *snap = &t->game->snap;
+    int hand = snap->hand_size[mover];
+    uint8_t drawn = hand > 0 ? history_card(&snap->hands[mover][hand - 1]) : HISTORY_NO_CARD;
+
+    if (outcome == MOVE_REJECTED) {
+        table_history_add(t, mover, drawn, HIST_INVALID, hand);
+    } else if (played) {
+        HistoryAction action = outcome == MOVE_WON ? HIST_WIN : jump_in ? HIST_JUMP_IN : HIST_PLAY;
+        table_history_add(t, mover, history_card(&snap->top), action, hand);
+    } else {
+        table_history_add(t, mover, drawn, HIST_DRAW, hand);
+    }
+}
+
+// Bring every player but the one prompted up to date. Deferred after a move
+// until the reactor is between events, so the player to move hears first and
+// several moves in a row cost the others one frame.
+void table_flush_state(Table *t) {
+    GameSnapshot *snap = &t->game->snap;
+
+    t->state_pending = 0;
+    for (int p = 0; p < snap->num_players; p++) {
+        if (p != t->awaiting && snap->active[p]) update_player_client(t->game, p, &t->outboxes[p]);
+    }
+}
+
+// Send an event to every seat, after any state they are still owed
+void table_broadcast(Table *t, const char *event) {
+    if (t->state_pending) table_flush_state(t);
+    for (int p = 0; p < t->game->snap.num_players; p++) {
+        outbox_send(&t->outboxes[p], OUTBOX_MSG_EVENT, event, strlen(event));
+    }
+}
+
+static void table_send_rejected(Table *t, const SeatSet *rejected) {
+    for (int w = 0; w < SEAT_WORDS; w++) {
+        for (uint64_t bits = rejected->bits[w]; bits; bits &= bits - 1) {
+            int p = w * 64 + __builtin_ctzll(bits);
+            outbox_send(&t->outboxes[p], OUTBOX_MSG_EVENT, "JUMP_IN_REJECTED\n", 17);
+        }
+    }
+}
+
+void table_finish(Table *t) {
+    t->phase = TABLE_DRAINING;
+    clock_gettime(CLOCK_MONOTONIC, &t->deadline);
+    timespec_add_ms(&t->deadline, TABLE_DRAIN_MS);
+}
+
+// Oldest move in a seat's queue, NULL if it is empty. Only the reactor consumes.
+static SeatMove *seat_queue_peek(GameState *game, int seat) {
+    SeatQueue *q = &game->moves[seat];
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    if (head == atomic_load_explicit(&q->tail, memory_order_acquire)) return NULL;
+    return &q->slots[head % SEAT_QUEUE_LEN];
+}
+
+static unsigned seat_queue_len(GameState *game, int seat) {
+    SeatQueue *q = &game->moves[seat];
+    return atomic_load_explicit(&q->tail, memory_order_acquire) - atomic_load_explicit(&q->head, memory_order_relaxed);
+}
+
+// Drop the move at the head of a seat's queue once it was applied or rejected.
+// Sequence numbers only ever go up by one, a gap would mean a move got lost.
+static void table_move_done(Table *t, int seat) {
+    GameState *game = t->game;
+    SeatQueue *q = &game->moves[seat];
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    uint32_t seq = q->slots[head % SEAT_QUEUE_LEN].seq;
+
+    if (seq != t->move_seq[seat] + 1) {
+        char msg[LOG_MSG_LEN];
+        snprintf(msg, sizeof(msg), "Table %d: %s's moves %u to %u never arrived",
+                 t->id, game->players[seat].player_name, t->move_seq[seat] + 1, seq - 1);
+        enqueue_log(msg);
+    }
+    t->move_seq[seat] = seq;
+    atomic_store(&q->head, head + 1); // the slot is free again
+    atomic_fetch_sub(&game->moves_ready, 1);
+    // no syscall unless the input child is actually waiting for the slot
+    if (atomic_load(&q->waiters) > 0) syscall(SYS_futex, &q->head, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+// Throw away everything a seat has queued (it left, or came back on a new client)
+static void table_moves_clear(Table *t, int seat) {
+    while (seat_queue_peek(t->game, seat)) table_move_done(t, seat);
+}
+
+// Pick the seat whose move is applied next, or -1 to keep waiting. Caller holds game_lock.
+// The awaited player's move goes through at once unless a jump-in arrived before it.
+// A jump-in is only final JUMP_IN_WINDOW_MS after it arrived, so an earlier one that
+// is still on its way to game_lock can beat it; ties go to the next seat in play order.
+// Seats whose jump-in lost are set in *rejected, to be told once the lock is dropped.
+static int table_arbitrate(Table *t, SeatSet *rejected) {
+    GameState *game = t->game;
+    int n = game->num_players;
+    int player = t->awaiting;
+    SeatMove *best = seat_queue_peek(game, player);
+    int winner = best ? player : -1;
+
+    // usually only the awaited seat has moves in, no need to look at the others
+    if ((unsigned)atomic_load(&game->moves_ready) == seat_queue_len(game, player)) return winner;
+
+    for (int k = 1; k < n; k++) {
+        int p = ((player + k * game->direction) % n + n) % n;
+        SeatMove *m;
+
+        // out of turn only a jump-in aimed at the current pile counts, drop the rest
+        while ((m = seat_queue_peek(game, p)) &&
+               (timespec_before(&m->arrived, &t->pile_changed) || !jump_in_allowed(game, p, m->cmd))) {
+            table_move_done(t, p);
+            rejected->bits[p / 64] |= 1ull << (p % 64);
+        }
+        if (!m) continue;
+        if (winner == -1 || timespec_before(&m->arrived, &best->arrived)) {
+            winner = p;
+            best = m;
+        }
+    }
+
+    if (winner == -1 || winner == player) return winner;
+
+    struct timespec closes = best->arrived;
+    timespec_add_ms(&closes, JUMP_IN_WINDOW_MS);
+    if (ms_until(&closes) > 0) {
+        t->deadline = closes; // the reactor calls back when the window closes
+        return -1;
+    }
+    return winner;
+}
+
+// A HINT on its way through the solver thread; the answer only goes out if
+// the table is still at the move it was asked at
+typedef struct HintJob {
+    int table_id;
+    int seat;
+    unsigned long moves;
+    EndgamePos pos;
+    EndgameResult result;
+} HintJob;
+
+static void hint_reply(Table *t, int seat, const char *hint) {
+    Frame f;
+    frame_init(&f, hint);
+    format_turn(&t->game->snap, seat, &f);
+    outbox_send(&t->outboxes[seat], OUTBOX_MSG_EVENT, f.text, f.len);
+    frame_free(&f);
+}
+
+// Solver thread: searches every queued position, then rings the reactor
+void *solver_thread_func(void *arg) {
+    Shard *s = (Shard *)arg;
+
+    while (1) {
+        sem_wait(&s->hint_wake);
+        if (atomic_load(&s->hint_stop)) break;
+
+        unsigned solved = atomic_load_explicit(&s->hint_solved, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&s->hint_tail, memory_order_acquire);
+        for (; solved != tail; solved++) {
+            HintJob *job = &s->hints[solved % HINT_SLOTS];
+            job->result = endgame_solve(s->solver, &job->pos, ENDGAME_NODES, ENDGAME_BUDGET_MS);
+            atomic_store_explicit(&s->hint_solved, solved + 1, memory_order_release);
+        }
+        write(s->wake_pipe[1], "h", 1);
+    }
+    return NULL;
+}
+
+// Answer HINT from the player to move with the first move of a forced win, if
+// the endgame solver finds one in its budget. The search runs on the solver
+// thread and the answer is sent by table_hint_answer(); the table is left as
+// it was, so the player is prompted again with it.
+static void table_hint(Table *t, int seat) {
+    GameState *game = t->game;
+    Shard *s = t->shard;
+
+    if (!s->solver) {
+        hint_reply(t, seat, "HINT OFF\n");
+        return;
+    }
+
+    unsigned tail = atomic_load_explicit(&s->hint_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->hint_head, memory_order_relaxed);
+    HintJob *job = &s->hints[tail % HINT_SLOTS];
+
+    lock_game(game);
+    bool endgame = tail - head < HINT_SLOTS && endgame_position(game, true, &job->pos);
+    pthread_mutex_unlock(&game->game_lock);
+
+    // too many cards left, or the solver is busy with others: nothing to search
+    if (!endgame) {
+        hint_reply(t, seat, "HINT NONE\n");
+        return;
+    }
+    job->table_id = t->id;
+    job->seat = seat;
+    job->moves = t->moves;
+    atomic_store_explicit(&s->hint_tail, tail + 1, memory_order_release);
+    sem_post(&s->hint_wake);
+}
+
+// Round Robin Scheduler step: apply the awaited move (or a jump-in) if it arrived [ELSA PART]
+void table_service(Table *t) {
+    GameState *game = t->game;
+
+    if (t->phase != TABLE_PLAYING) return;
+
+    lock_game(game);
+    memset(&t->deadline, 0, sizeof(t->deadline));
+    t->view_dirty = 1;
+
+    int player = t->awaiting;
+    if (player < 0) {
+        pthread_mutex_unlock(&game->game_lock);
+        return;
+    }
+
+    // Check if the player is still active
+    if (!game->players[player].is_active) {
+        table_moves_clear(t, player);
+
+        // nobody left to play against, the last one seated wins
+        int active = game->active_players;
+        if (active < 2) {
+            int last = seat_step(game, player, game->direction);
+            game->game_over = 1;
+            game->winner_pid = active == 1 ? game->players[last].pid : 0;
+        } else {
+            decide_next_player(game);
+        }
+        game_publish(game);
+        pthread_mutex_unlock(&game->game_lock);
+
+        printf("Player %s has disconnected. Skipping their turn.\n", game->players[player].player_name);
+        table_history_add(t, player, HISTORY_NO_CARD, HIST_SKIP, game->snap.hand_size[player]);
+        if (active < 2) {
+            table_broadcast(t, "GAME_OVER\n");
+            table_finish(t);
+            return;
+        }
+        table_prompt(t);
+        t->state_pending = 1;
+        reap_child_processes(&game->players[player]);
+        table_service(t);
+        return;
+    }
+
+    SeatSet rejected = {0};
+    int mover = table_arbitrate(t, &rejected);
+    if (mover < 0) {
+        pthread_mutex_unlock(&game->game_lock);
+        table_send_rejected(t, &rejected);
+        return;
+    }
+
+    memcpy(game->stored_move, seat_queue_peek(game, mover)->cmd, sizeof(game->stored_move));
+    table_move_done(t, mover);
+
+    // asking for a hint is not a move, the turn stays where it is
+    if (mover == player && strncmp(game->stored_move, "HINT", 4) == 0) {
+        pthread_mutex_unlock(&game->game_lock);
+        table_send_rejected(t, &rejected);
+        table_hint(t, player);
+        table_service(t);
+        return;
+    }
+
+    //apply move changes 
+    int top_before = game->current_card_idx;
+    MoveOutcome outcome = mover == player ? game_apply_move(game, player) : game_apply_jump_in(game, mover);
+    t->shard->moves++;
+    t->moves++;
+    if (game->current_card_idx != top_before) clock_gettime(CLOCK_MONOTONIC, &t->pile_changed);
+
+    // only the rules ran under the lock, the frames are built from the snapshot
+    game_publish(game);
+    pthread_mutex_unlock(&game->game_lock);
+    table_send_rejected(t, &rejected);
+    table_history_move(t, mover, mover != player, outcome, game->current_card_idx != top_before);
+
+    if (outcome == MOVE_WON) {
+        table_broadcast(t, "GAME_OVER\n");
+        table_finish(t);
+        return;
+    } else if (outcome == MOVE_REJECTED) {
+        // Invalid move, player already drew a card as penalty (the prompt shows it)
+        outbox_send(&t->outboxes[mover], OUTBOX_MSG_EVENT, "INVALID_MOVE\n", 13);
+    }
+
+    // the critical path: the player to move gets the new state and TURN before
+    // anyone else, the others are sent theirs when the reactor comes round
+    table_prompt(t);
+    if (outcome == MOVE_APPLIED) t->state_pending = 1;
+
+    // moves still waiting in other slots are judged against the new pile
+    table_service(t);
+}
+
+static TableView *view_claim(void) {
+    for (int i = 0; i < ADMIN_VIEWS; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&table_views[i].in_use, &expected, 1)) return &table_views[i];
+    }
+    return NULL;
+}
+
+// Copy the table into its admin view. Only the reactor changes the fields read
+// here (input children only fill move slots), so game_lock is not needed either.
+void table_publish(Table *t) {
+    TableView *v = t->view;
+    GameState *game = t->game;
+    TableInfo *info = &v->info;
+
+    t->view_dirty = 0;
+    unsigned seq = atomic_load_explicit(&v->seq, memory_order_relaxed);
+    atomic_store_explicit(&v->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    info->table_id = t->id;
+    info->shard = t->shard->id;
+    info->phase = t->phase;
+    info->num_players = game->num_players;
+    info->current_player = game->current_player;
+    info->direction = game->direction;
+    format_card_to_string(&game->played_cards[game->current_card_idx], info->pile);
+    info->top = game->played_cards[game->current_card_idx];
+    info->deck_size = game->deck.size;
+    info->deck_left = game->deck.size - game->deck.top_index;
+    info->moves = t->moves;
+    for (int p = 0; p < game->num_players; p++) {
+        Player *P = &game->players[p];
+        memcpy(info->players[p].name, P->player_name, NAME_SIZE);
+        info->players[p].pid = P->pid;
+        info->players[p].hand_size = P->hand_size;
+        info->players[p].score = P->hand_index.score;
+        info->players[p].active = P->is_active;
+        info->players[p].away = P->away_since.tv_sec != 0;
+        info->players[p].queued_msgs = t->outboxes[p].count;
+        info->players[p].queued_bytes = t->outboxes[p].queued_bytes;
+    }
+
+    atomic_store_explicit(&v->seq, seq + 2, memory_order_release);
+}
+
+// Pre-forked input workers. Forking at table start costs the reactor a fork per
+// seat, so a pool thread forks idle workers ahead of time and the reactor only
+// writes a worker its table and seat. A worker reaches the table through the
+// table's arena, which it shares only if the arena was mapped before the
+// worker was forked, so each worker remembers how many arenas existed then.
+// A worker serves one seat and is gone with it; the pool thread forks a
+// replacement and shuffles decks for the deck pool in the same spare time.
+typedef struct {
+    Table *table;
+    int seat;
+    int shm;                // the client talks over shared memory, map its channel
+} InputJob;
+
+typedef struct {
+    pid_t pid;
+    int fd;                 // write end of the worker's job pipe
+    unsigned arenas;        // arena serials up to this one are mapped in the worker
+} InputWorker;
+
+static InputWorker input_pool[INPUT_POOL_MAX];
+static int input_pool_len = 0;
+static int input_pool_target = 0;   // 0 = no pool, every seat forks its own child
+static pthread_mutex_t input_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t input_pool_cond = PTHREAD_COND_INITIALIZER;
+static atomic_int input_pool_running;
+static pthread_t input_pool_tid;
+
+// The worker only needs its job pipe, the reactors' doorbells and stdout/stderr;
+// dropping the rest keeps it from holding other clients' pipes open
+static void input_worker_close_fds(int job_fd) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) return;
+
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL) {
+        int fd = atoi(e->d_name);
+        bool keep = fd <= STDERR_FILENO || fd == job_fd || fd == dirfd(dir) || e->d_name[0] == '.';
+        for (int i = 0; i < num_shards && !keep; i++) keep = fd == shards[i].bell_pipe[1];
+        if (!keep) close(fd);
+    }
+    closedir(dir);
+}
+
+static void input_worker_main(int job_fd) {
+    InputJob job;
+    ssize_t n;
+
+    input_worker_close_fds(job_fd);
+    do {
+        n = read(job_fd, &job, sizeof(job));
+    } while (n == -1 && errno == EINTR);
+    if (n != sizeof(job)) _exit(0); // pool shut down
+    close(job_fd);
+
+    Table *t = job.table;
+    Player *P = &t->game->players[job.seat];
+    ShmChannel *chan = NULL;
+    if (job.shm && !(chan = lobby_attach_shm(P->pid))) {
+        handle_disconnect(t, job.seat, P->player_name, -1, false);
+    }
+    input_child_loop(t, job.seat, chan);
+    _exit(0);
+}
+
+void *input_pool_thread_func(void *arg) {
+    (void)arg;
+    Deck scratch = {0};
+
+    while (atomic_load(&input_pool_running)) {
+        pthread_mutex_lock(&input_pool_lock);
+        while (atomic_load(&input_pool_running) && input_pool_len >= input_pool_target) {
+            pthread_mutex_unlock(&input_pool_lock);
+            // idle: top up the decks, then sleep until a worker is taken
+            if (deck_pool_refill(&scratch)) {
+                pthread_mutex_lock(&input_pool_lock);
+                continue;
+            }
+            pthread_mutex_lock(&input_pool_lock);
+            if (input_pool_len >= input_pool_target && atomic_load(&input_pool_running))
+                pthread_cond_wait(&input_pool_cond, &input_pool_lock);
+        }
+        pthread_mutex_unlock(&input_pool_lock);
+        if (!atomic_load(&input_pool_running)) break;
+
+        int fds[2];
+        if (pipe(fds) == -1) {
+            perror("Input worker pipe failed");
+            sleep(1);
+            continue;
+        }
+        InputWorker w = { .fd = fds[1], .arenas = atomic_load(&arena_serials) };
+        w.pid = fork();
+        if (w.pid == 0) {
+            log_shard = NULL;
+            close(fds[1]);
+            input_worker_main(fds[0]);
+        }
+        close(fds[0]);
+        if (w.pid == -1) {
+            perror("Input worker fork failed");
+            close(fds[1]);
+            sleep(1);
+            continue;
+        }
+
+        pthread_mutex_lock(&input_pool_lock);
+        input_pool[input_pool_len++] = w;
+        pthread_mutex_unlock(&input_pool_lock);
+    }
+    deckFree(&scratch);
+    return NULL;
+}
+
+// Hand seat `i` of `t` to an idle worker, false if none can reach the table
+static bool input_pool_assign(Table *t, int i) {
+    InputWorker w = { .pid = -1 };
+
+    pthread_mutex_lock(&input_pool_lock);
+    for (int k = input_pool_len - 1; k >= 0; k--) {
+        if (input_pool[k].arenas < t->arena->serial) continue;
+        w = input_pool[k];
+        input_pool[k] = input_pool[--input_pool_len];
+        pthread_cond_signal(&input_pool_cond);
+        break;
+    }
+    pthread_mutex_unlock(&input_pool_lock);
+    if (w.pid == -1) return false;
+
+    InputJob job = { .table = t, .seat = i, .shm = t->outboxes[i].chan != NULL };
+    bool sent = write(w.fd, &job, sizeof(job)) == sizeof(job);
+    close(w.fd);
+    if (!sent) {
+        kill(w.pid, SIGTERM);
+        waitpid(w.pid, NULL, 0);
+        return false;
+    }
+    t->game->players[i].input_pid = w.pid;
+    return true;
+}
+
+// Keep `workers` input workers and DECK_POOL_SIZE decks of `decks` decks ready
+void input_pool_start(int workers, int decks) {
+    input_pool_target = workers < INPUT_POOL_MAX ? workers : INPUT_POOL_MAX;
+    deck_pool_decks = decks;
+    atomic_store(&input_pool_running, 1);
+    pthread_create(&input_pool_tid, NULL, input_pool_thread_func, NULL);
+}
+
+void input_pool_stop(void) {
+    if (!atomic_load(&input_pool_running)) return;
+
+    pthread_mutex_lock(&input_pool_lock);
+    atomic_store(&input_pool_running, 0);
+    pthread_cond_signal(&input_pool_cond);
+    pthread_mutex_unlock(&input_pool_lock);
+    pthread_join(input_pool_tid, NULL);
+
+    for (int k = 0; k < input_pool_len; k++) {
+        close(input_pool[k].fd);
+        kill(input_pool[k].pid, SIGTERM);
+        waitpid(input_pool[k].pid, NULL, 0);
+    }
+    input_pool_len = 0;
+
+    pthread_mutex_lock(&deck_pool_lock);
+    while (deck_pool_len > 0) free(deck_pool[--deck_pool_len]);
+    pthread_mutex_unlock(&deck_pool_lock);
+}
+
+static void table_fork_input(Table *t, int i) {
+    if (input_pool_assign(t, i)) return;
+
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        log_shard = NULL;
+        input_child_loop(t, i, t->outboxes[i].chan);
+        exit(0);
+    }
+    t->game->players[i].input_pid = pid;
+}
+
+// Reactor takes ownership: fork the input children and prompt the first player
+void table_start(Shard *s, Table *t) {
+    GameState *game = t->game;
+    t->shard = s;
+
+    fflush(stdout); // children must not inherit (and later repeat) buffered output
+    for (int i = 0; i < game->num_players; i++) {
+        table_fork_input(t, i);
+    }
+
+    t->next = s->tables;
+    s->tables = t;
+    s->seats += game->num_players;
+    t->view = view_claim();
+    t->view_dirty = t->view != NULL;
+
+    GameSnapshot *snap = &game->snap;
+    for (int p = 0; p < game->num_players; p++) {
+        for (int c = 0; c < snap->hand_size[p]; c++) {
+            table_history_add(t, p, history_card(&snap->hands[p][c]), HIST_DEAL, c + 1);
+        }
+    }
+
+    char log_msg[LOG_MSG_LEN];
+    snprintf(log_msg, LOG_MSG_LEN, "Table %d started on reactor %d with %d players", t->id, s->id, game->num_players);
+    enqueue_log(log_msg);
+
+    table_prompt(t);
+}
+
+static Table *shard_find_table(Shard *s, int id) {
+    for (Table *t = s->tables; t; t = t->next) {
+        if (t->id == id) return t;
+    }
+    return NULL;
+}
+
+// A client presented the token of a seat at this table: hand it the seat, rebind
+// its pipes and send one snapshot (RESUMED, PILE/HAND, and TURN if the table is
+// waiting on that seat) in a single message. The seat never left the turn order.
+void table_reattach(Shard *s, Reattach *r) {
+    Table *t = shard_find_table(s, r->table_id);
+    GameState *game = t ? t->game : NULL;
+    Player *P = game ? &game->players[r->seat] : NULL;
+
+    if (!t || t->phase != TABLE_PLAYING || !P->is_active || P->token != r->client.token) {
+        seat_send(&r->client, "RESUME_FAILED\n", 14);
+        seat_release(&r->client);
+        return;
+    }
+
+    // the old input child may not have noticed yet (shared memory clients are polled)
+    if (P->input_pid > 0) {
+        kill(P->input_pid, SIGTERM);
+        waitpid(P->input_pid, NULL, 0);
+        P->input_pid = 0;
+    }
+    // a child killed asleep on a full queue never took itself off the waiters;
+    // none is running for the seat now, so the new one starts from zero
+    atomic_store(&game->moves[r->seat].waiters, 0);
+    outbox_rebind(&t->outboxes[r->seat], r->client.fd, r->client.chan);
+
+    Frame f;
+    frame_init(&f, "RESUMED\n");
+    lock_game(game);
+    P->pid = r->client.pid;
+    P->away_since.tv_sec = P->away_since.tv_nsec = 0;
+    table_moves_clear(t, r->seat); // typed to the old client against an older pile
+    pthread_mutex_unlock(&game->game_lock);
+    format_player_state(&game->snap, r->seat, &f);
+    if (t->awaiting == r->seat) format_turn(&game->snap, r->seat, &f);
+    outbox_send(&t->outboxes[r->seat], OUTBOX_MSG_EVENT, f.text, f.len);
+    frame_free(&f);
+
+    fflush(stdout);
+    table_fork_input(t, r->seat);
+
+    t->view_dirty = 1;
+    printf("Player %s is back at table %d\n", P->player_name, t->id);
+    char log_msg[LOG_MSG_LEN];
+    snprintf(log_msg, LOG_MSG_LEN, "RESUME: Player %.40s (PID %d) took back seat %d", P->player_name, P->pid, r->seat);
+    enqueue_log(log_msg);
+}
+
+// Seats whose grace window ran out are given up, returns true if one was
+bool table_expire_away(Table *t) {
+    GameState *game = t->game;
+    bool expired = false;
+
+    for (int p = 0; p < game->num_players; p++) {
+        Player *P = &game->players[p];
+        if (P->away_since.tv_sec == 0 || ms_since(&P->away_since) < resume_grace_ms) continue;
+
+        lock_game(game);
+        if (P->is_active && P->away_since.tv_sec != 0) {
+            player_leave(game, p);
+            t->view_dirty = 1;
+            printf("Player %s did not come back, seat given up\n", P->player_name);
+
+            char log_msg[LOG_MSG_LEN];
+            snprintf(log_msg, LOG_MSG_LEN, "RESUME: Player %.40s did not come back in time", P->player_name);
+            enqueue_log(log_msg);
+            expired = true;
+        }
+        P->away_since.tv_sec = P->away_since.tv_nsec = 0;
+        pthread_mutex_unlock(&game->game_lock);
+    }
+    return expired;
+}
+
+void table_end(Shard *s, Table *t) {
+    GameState *game = t->game;
+
+    for (int i = 0; i < game->num_players; i++) session_remove(game->players[i].token);
+    if (t->view) atomic_store(&t->view->in_use, 0);
+    printf("Game over! Winner PID: %d\n", game->winner_pid);
+    save_scores(game);
+    shard_history_add_game(s, t);
+    outbox_report_high_water(t);
+
+    s->tables_played++;
+    s->seats -= game->num_players;
+    table_destroy(t);
+    atomic_fetch_sub(&s->live_tables, 1);
+}
+
+bool handoff_push(Shard *s, Table *t) {
+    unsigned tail = atomic_load_explicit(&s->handoff_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->handoff_head, memory_order_acquire);
+
+    if (tail - head == HANDOFF_SLOTS) return false;
+
+    s->handoff[tail % HANDOFF_SLOTS] = t;
+    atomic_store_explicit(&s->handoff_tail, tail + 1, memory_order_release);
+    atomic_fetch_add(&s->live_tables, 1);
+    write(s->wake_pipe[1], "t", 1);
+    return true;
+}
+
+Table *handoff_pop(Shard *s) {
+    unsigned head = atomic_load_explicit(&s->handoff_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&s->handoff_tail, memory_order_acquire);
+
+    if (head == tail) return NULL;
+
+    Table *t = s->handoff[head % HANDOFF_SLOTS];
+    atomic_store_explicit(&s->handoff_head, head + 1, memory_order_release);
+    return t;
+}
+
+bool reattach_push(Shard *s, Reattach *r) {
+    unsigned tail = atomic_load_explicit(&s->reattach_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->reattach_head, memory_order_acquire);
+
+    if (tail - head == REATTACH_SLOTS) return false;
+
+    s->reattach[tail % REATTACH_SLOTS] = *r;
+    atomic_store_explicit(&s->reattach_tail, tail + 1, memory_order_release);
+    write(s->wake_pipe[1], "r", 1);
+    return true;
+}
+
+bool reattach_pop(Shard *s, Reattach *r) {
+    unsigned head = atomic_load_explicit(&s->reattach_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&s->reattach_tail, memory_order_acquire);
+
+    if (head == tail) return false;
+
+    *r = s->reattach[head % REATTACH_SLOTS];
+    atomic_store_explicit(&s->reattach_head, head + 1, memory_order_release);
+    return true;
+}
+
+bool admin_push(Shard *s, AdminCmd *cmd) {
+    unsigned tail = atomic_load_explicit(&s->admin_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->admin_head, memory_order_acquire);
+
+    if (tail - head == ADMIN_SLOTS) return false;
+
+    s->admin[tail % ADMIN_SLOTS] = *cmd;
+    atomic_store_explicit(&s->admin_tail, tail + 1, memory_order_release);
+    write(s->wake_pipe[1], "a", 1);
+    return true;
+}
+
+bool admin_pop(Shard *s, AdminCmd *cmd) {
+    unsigned head = atomic_load_explicit(&s->admin_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&s->admin_tail, memory_order_acquire);
+
+    if (head == tail) return false;
+
+    *cmd = s->admin[head % ADMIN_SLOTS];
+    atomic_store_explicit(&s->admin_head, head + 1, memory_order_release);
+    return true;
+}
+
+// The reactor must not block on an admin that stopped reading, the reply is short anyway
+static void admin_reply(int fd, const char *reply) {
+    send(fd, reply, strlen(reply), MSG_DONTWAIT | MSG_NOSIGNAL);
+    close(fd);
+}
+
+// Run an admin command on one of this shard's tables and answer on the admin connection
+void table_admin(Shard *s, AdminCmd *cmd) {
+    Table *t = shard_find_table(s, cmd->table_id);
+    char reply[128];
+    char log_msg[LOG_MSG_LEN];
+
+    if (!t || t->phase != TABLE_PLAYING) {
+        snprintf(reply, sizeof(reply), "ERR table %d is not being played\n", cmd->table_id);
+        admin_reply(cmd->reply_fd, reply);
+        return;
+    }
+    GameState *game = t->game;
+    Player *P = &game->players[cmd->seat];
+
+    lock_game(game);
+    switch (cmd->op) {
+    case ADMIN_KICK:
+        player_leave(game, cmd->seat);
+        P->away_since.tv_sec = P->away_since.tv_nsec = 0;
+        snprintf(reply, sizeof(reply), "OK %s kicked from table %d\n", P->player_name, t->id);
+        break;
+    case ADMIN_DRAW:
+        for (int i = 0; i < cmd->count && i < game->deck.size; i++) {
+            player_add_card(P, deckDraw(&game->deck));
+        }
+        snprintf(reply, sizeof(reply), "OK %s now holds %d cards\n", P->player_name, P->hand_size);
+        break;
+    case ADMIN_END:
+        game->game_over = 1;
+        game->winner_pid = 0;
+        snprintf(reply, sizeof(reply), "OK table %d ended\n", t->id);
+        break;
+    }
+    game_publish(game);
+    pthread_mutex_unlock(&game->game_lock);
+
+    if (cmd->op == ADMIN_KICK) outbox_send(&t->outboxes[cmd->seat], OUTBOX_MSG_EVENT, "KICKED\n", 7);
+    if (cmd->op == ADMIN_DRAW) update_player_client(game, cmd->seat, &t->outboxes[cmd->seat]);
+    if (cmd->op == ADMIN_END) table_broadcast(t, "GAME_OVER\n");
+
+    snprintf(log_msg, LOG_MSG_LEN, "ADMIN: %.80s", reply + 3);
+    log_msg[strcspn(log_msg, "\n")] = '\0';
+    enqueue_log(log_msg);
+    admin_reply(cmd->reply_fd, reply);
+
+    t->view_dirty = 1;
+    if (cmd->op == ADMIN_END) table_finish(t);
+    else table_service(t); // a kicked player may be the one the table waits for
+}
+
+// Send what the solver thread found, unless the table moved on meanwhile (the
+// player has had a newer TURN then, and the hint would be for a stale pile)
+static void table_hint_answer(Shard *s, HintJob *job) {
+    Table *t = shard_find_table(s, job->table_id);
+    char msg[64];
+
+    if (!t || t->phase != TABLE_PLAYING || t->moves != job->moves || t->awaiting != job->seat) return;
+
+    if (job->result.outcome == ENDGAME_FORCED_WIN) {
+        int colour;
+        int index = endgame_move_card(t->game, &job->pos, &job->result.move, &colour);
+        snprintf(msg, sizeof(msg), "HINT %d %d %d\n", index, colour, job->result.plies);
+    } else {
+        snprintf(msg, sizeof(msg), "HINT NONE\n");
+    }
+    hint_reply(t, job->seat, msg);
+}
+
+// One event loop per shard: move doorbells, hand-offs, writable pipes, timers
+void *reactor_thread_func(void *arg) {
+    Shard *s = (Shard *)arg;
+    log_shard = s;
+
+    if (s->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(s->cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            fprintf(stderr, "Reactor %d could not be pinned to CPU %d\n", s->id, s->cpu);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &s->started);
+
+    while (1) {
+        Table *t;
+        while ((t = handoff_pop(s)) != NULL) {
+            table_start(s, t);
+        }
+        Reattach r;
+        while (reattach_pop(s, &r)) {
+            table_reattach(s, &r);
+        }
+        AdminCmd cmd;
+        while (admin_pop(s, &cmd)) {
+            table_admin(s, &cmd);
+        }
+        unsigned head = atomic_load_explicit(&s->hint_head, memory_order_relaxed);
+        unsigned solved = atomic_load_explicit(&s->hint_solved, memory_order_acquire);
+        for (; head != solved; head++) {
+            table_hint_answer(s, &s->hints[head % HINT_SLOTS]);
+            atomic_store_explicit(&s->hint_head, head + 1, memory_order_release);
+        }
+
+        if (!server_running) break;
+        if (!atomic_load(&lobby_open) && s->tables == NULL && atomic_load(&s->live_tables) == 0) break;
+
+        // pollfd layout: bell, wake, then every outbox with pending output
+        int needed = 2 + s->seats;
+        if (needed > s->pfd_cap) {
+            s->pfd_cap = needed * 2;
+            s->pfds = realloc(s->pfds, sizeof(struct pollfd) * s->pfd_cap);
+            s->pfd_owners = realloc(s->pfd_owners, sizeof(Outbox *) * s->pfd_cap);
+        }
+        struct pollfd *pfds = s->pfds;
+        Outbox **owners = s->pfd_owners;
+        int nfds = 2;
+        int timeout = 200;
+
+        pfds[0].fd = s->bell_pipe[0];
+        pfds[0].events = POLLIN;
+        pfds[1].fd = s->wake_pipe[0];
+        pfds[1].events = POLLIN;
+
+        for (t = s->tables; t; t = t->next) {
+            // whatever changed since the last poll is visible before we sleep again
+            if (t->state_pending) table_flush_state(t);
+            if (t->view && t->view_dirty) table_publish(t);
+
+            for (int p = 0; p < t->game->num_players; p++) {
+                Outbox *ob = &t->outboxes[p];
+
+                // a ring has nothing to poll, retry it on a short timer
+                if (ob->chan && ob->count > 0) {
+                    pthread_mutex_lock(&ob->lock);
+                    size_t pending = outbox_flush_locked(ob);
+                    pthread_mutex_unlock(&ob->lock);
+                    if (pending > 0 && timeout > 5) timeout = 5;
+                    continue;
+                }
+                if (ob->count > 0 && !ob->disconnected && nfds < s->pfd_cap) {
+                    pfds[nfds].fd = ob->fd;
+                    pfds[nfds].events = POLLOUT;
+                    owners[nfds] = ob;
+                    nfds++;
+                }
+            }
+            if (t->deadline.tv_sec != 0) {
+                int ms = ms_until(&t->deadline);
+                if (ms < timeout) timeout = ms;
+            }
+        }
+
+        poll(pfds, nfds, timeout);
+
+        if (pfds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(s->wake_pipe[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        for (int i = 2; i < nfds; i++) {
+            if (pfds[i].revents == 0) continue;
+            pthread_mutex_lock(&owners[i]->lock);
+            outbox_flush_locked(owners[i]);
+            pthread_mutex_unlock(&owners[i]->lock);
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            int ids[256];
+            ssize_t n;
+            while ((n = read(s->bell_pipe[0], ids, sizeof(ids))) > 0) {
+                for (int i = 0; i < n / (int)sizeof(int); i++) {
+                    t = shard_find_table(s, ids[i]);
+                    if (t) table_service(t);
+                }
+            }
+        }
+
+        // timers and the slow consumer policy, then retire finished tables
+        Table **link = &s->tables;
+        while ((t = *link) != NULL) {
+            if (t->phase == TABLE_PLAYING) {
+                bool window_closed = t->deadline.tv_sec != 0 && ms_until(&t->deadline) == 0;
+                bool dropped = outbox_check_policy(t);
+                if (table_expire_away(t) || dropped || window_closed) table_service(t);
+            } else if (t->phase == TABLE_DRAINING) {
+                bool empty = true;
+                for (int p = 0; p < t->game->num_players; p++) {
+                    if (t->outboxes[p].count > 0 && !t->outboxes[p].disconnected) empty = false;
+                }
+                if (empty || ms_until(&t->deadline) == 0) t->phase = TABLE_FINISHED;
+            }
+
+            if (t->phase == TABLE_FINISHED) {
+                *link = t->next;
+                table_end(s, t);
+            } else {
+                link = &t->next;
+            }
+        }
+    }
+
+    // server shutting down: end whatever is still running
+    while (s->tables) {
+        Table *t = s->tables;
+        s->tables = t->next;
+        table_end(s, t);
+    }
+    shard_history_flush(s);
+    free(s->history);
+    free(s->history_games);
+    free(s->history_block);
+    if (s->solver) {
+        atomic_store(&s->hint_stop, 1);
+        sem_post(&s->hint_wake);
+        pthread_join(s->solver_tid, NULL);
+        sem_destroy(&s->hint_wake);
+        free(s->hints);
+    }
+    endgame_solver_free(s->solver);
+    free(s->pfds);
+    free(s->pfd_owners);
+    return NULL;
+}
+
+void shards_start(int count, bool pin) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+
+    num_shards = count;
+    arena_pool_fill(2 * count);
+    for (int i = 0; i < count; i++) {
+        Shard *s = &shards[i];
+        s->id = i;
+        s->cpu = pin ? (int)(i % cpus) : -1;
+
+        pipe(s->bell_pipe);
+        pipe(s->wake_pipe);
+        fcntl(s->bell_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(s->wake_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(s->wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+        if (endgame_hints) {
+            s->solver = endgame_solver_new();
+            s->hints = s->solver ? calloc(HINT_SLOTS, sizeof(HintJob)) : NULL;
+            if (!s->hints) {
+                endgame_solver_free(s->solver);
+                s->solver = NULL;
+            }
+        }
+        if (s->solver) {
+            sem_init(&s->hint_wake, 0, 0);
+            pthread_create(&s->solver_tid, NULL, solver_thread_func, s);
+        }
+
+        pthread_create(&s->tid, NULL, reactor_thread_func, s);
+    }
+}
+
+// Least loaded shard gets the new table
+void lobby_assign_table(Table *t) {
+    GameState *game = t->game;
+
+    while (server_running) {
+        Shard *best = NULL;
+        for (int i = 0; i < num_shards; i++) {
+            if (!best || atomic_load(&shards[i].live_tables) < atomic_load(&best->live_tables))
+                best = &shards[i];
+        }
+        // registered before the push, the reactor may end the table right away
+        for (int i = 0; i < game->num_players; i++) {
+            session_add(game->players[i].token, best->id, t->id, i);
+        }
+        if (handoff_push(best, t)) return;
+        usleep(1000); // every hand-off ring is full, let the reactors catch up
+    }
+    for (int i = 0; i < game->num_players; i++) session_remove(game->players[i].token);
+    table_destroy(t);
+}
+
+static bool shards_busy(void) {
+    for (int i = 0; i < num_shards; i++) {
+        if (atomic_load(&shards[i].live_tables) > 0) return true;
+    }
+    return false;
+}
+
+void shards_report(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    printf("\nReactor statistics:\n");
+    for (int i = 0; i < num_shards; i++) {
+        Shard *s = &shards[i];
+        double secs = (now.tv_sec - s->started.tv_sec) + (now.tv_nsec - s->started.tv_nsec) / 1e9;
+        printf(" - reactor %d%s: %lu tables, %lu moves, %.1f moves/s\n", s->id,
+            s->cpu >= 0 ? " (pinned)" : "", s->tables_played, s->moves, secs > 0 ? s->moves / secs : 0.0);
+
+        char log_msg[LOG_MSG_LEN];
+        snprintf(log_msg, LOG_MSG_LEN, "REACTOR %d: %lu tables, %lu moves", s->id, s->tables_played, s->moves);
+        enqueue_log(log_msg);
+    }
+}
+
+// Matchmaking queue. Joins are framed out of a carry-over buffer, so a line cut
+// by one read is finished by the next, and waiting players sit in a growable
+// ring in join order until enough of them are connected to fill a table.
+typedef struct {
+    char partial[JOIN_LINE_MAX]; // start of a join line the last read cut off
+    size_t partial_len;
+    Seat *seats;            // ring of `cap` seats, oldest at `head`
+    int head;
+    int count;
+    int cap;
+    int connecting;         // FIFO clients whose output pipe is not open yet
+    int table_size;
+    time_t first_joined;
+} Lobby;
+
+// Map the segment a "SHM <pid> <name>" client created for itself
+ShmChannel *lobby_attach_shm(int client_pid) {
+    char name[64];
+    shm_channel_name(name, sizeof(name), client_pid);
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1) {
+        perror("Failed to open client shared memory");
+        return NULL;
+    }
+
+    ShmChannel *chan = mmap(NULL, sizeof(ShmChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (chan == MAP_FAILED) {
+        perror("Failed to map client shared memory");
+        return NULL;
+    }
+    if (chan->magic != SHM_CHANNEL_MAGIC) {
+        fprintf(stderr, "Client %d shared memory has a bad header\n", client_pid);
+        munmap(chan, sizeof(ShmChannel));
+        return NULL;
+    }
+    return chan;
+}
+
+static Seat *lobby_at(Lobby *lobby, int i) {
+    return &lobby->seats[(lobby->head + i) % lobby->cap];
+}
+
+// First message of a new client: the greeting and the token that reclaims its seat
+static void seat_welcome(Seat *seat) {
+    char msg[64];
+    int len = snprintf(msg, sizeof(msg), "Welcome to the game!\nTOKEN %016llx\n", (unsigned long long)seat->token);
+    seat_send(seat, msg, len);
+}
+
+// RESUME join: pass the client on to the reactor that runs its table
+static void lobby_resume(Seat *seat) {
+    Session session;
+    Reattach r = { .client = *seat };
+
+    if (session_find(seat->token, &session)) {
+        r.table_id = session.table_id;
+        r.seat = session.seat;
+        if (reattach_push(&shards[session.shard], &r)) return;
+    }
+
+    printf("PID %d could not resume: no game holds that seat\n", seat->pid);
+    seat_send(seat, "RESUME_FAILED\n", 14);
+    seat_release(seat);
+}
+
+static void lobby_push(Lobby *lobby, Seat *seat) {
+    if (lobby->count == lobby->cap) {
+        int cap = lobby->cap ? lobby->cap * 2 : 64;
+        Seat *seats = malloc(sizeof(Seat) * cap);
+        for (int i = 0; i < lobby->count; i++) seats[i] = *lobby_at(lobby, i);
+        free(lobby->seats);
+        lobby->seats = seats;
+        lobby->head = 0;
+        lobby->cap = cap;
+    }
+    *lobby_at(lobby, lobby->count) = *seat;
+    lobby->count++;
+}
+
+// One "<pid> <name>" or "SHM <pid> <name>" line, either one may be prefixed with
+// "RESUME <token> " by a client taking back its seat (the name is optional then)
+static void lobby_add_join(Lobby *lobby, const char *line) {
+    Seat seat = { .fd = -1 };
+
+    if (strncmp(line, "RESUME ", 7) == 0) {
+        char *end;
+        seat.token = strtoull(line + 7, &end, 16);
+        if (end == line + 7 || seat.token <= SESSION_TOMBSTONE) return;
+        seat.resume = 1;
+        line = end + strspn(end, " ");
+    }
+
+    bool use_shm = strncmp(line, "SHM ", 4) == 0;
+    int fields = sscanf(line + (use_shm ? 4 : 0), "%d %49[^\n]", &seat.pid, seat.name);
+    if (fields < (seat.resume ? 1 : 2) || seat.pid <= 0) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &seat.joined);
+    if (!seat.resume) seat.token = session_new_token();
+
+    char log_msg[LOG_MSG_LEN];
+    snprintf(log_msg, LOG_MSG_LEN, "Player %s: %s (PID: %d)%s", seat.resume ? "resuming" : "joined",
+        seat.name, seat.pid, use_shm ? " over shm" : "");
+    enqueue_log(log_msg);
+
+    if (use_shm) {
+        seat.chan = lobby_attach_shm(seat.pid);
+        if (!seat.chan) return;
+        if (seat.resume) {
+            lobby_resume(&seat);
+            return;
+        }
+        seat_welcome(&seat);
+    } else {
+        lobby->connecting++; // lobby_connect() opens the client's FIFO
+    }
+
+    if (lobby->count == 0) lobby->first_joined = time(NULL);
+    lobby_push(lobby, &seat);
+}
+
+// Drain the join FIFO, keeping a partial last line for the next call
+void lobby_read_joins(int join_fd, Lobby *lobby) {
+    static char buffer[JOIN_LINE_MAX + JOIN_READ_SIZE + 1];
+
+    while (1) {
+        memcpy(buffer, lobby->partial, lobby->partial_len);
+        ssize_t n = read(join_fd, buffer + lobby->partial_len, JOIN_READ_SIZE);
+        if (n <= 0) return; // EAGAIN: nothing left, 0: no writer at the moment
+
+        size_t len = lobby->partial_len + n;
+        buffer[len] = '\0';
+
+        char *line = buffer;
+        char *nl;
+        while ((nl = memchr(line, '\n', buffer + len - line)) != NULL) {
+            *nl = '\0';
+            lobby_add_join(lobby, line);
+            line = nl + 1;
+        }
+
+        // a line longer than any valid join is garbage, drop it instead of carrying it
+        lobby->partial_len = buffer + len - line;
+        if (lobby->partial_len >= JOIN_LINE_MAX) lobby->partial_len = 0;
+        memcpy(lobby->partial, line, lobby->partial_len);
+    }
+}
+
+// Open the output FIFO of clients that joined recently. A non-blocking open fails
+// with ENXIO until the client opens its end, so one slow client cannot stall the
+// lobby; clients that never show up are dropped after JOIN_CONNECT_MS.
+void lobby_connect(Lobby *lobby) {
+    if (lobby->connecting == 0) return;
+
+    int kept = 0;
+    for (int i = 0; i < lobby->count; i++) {
+        Seat *seat = lobby_at(lobby, i);
+
+        if (!seat_connected(seat)) {
+            char client_fifo[64];
+            snprintf(client_fifo, 64, "/tmp/client_%d", seat->pid);
+            int c_fd = open(client_fifo, O_WRONLY | O_NONBLOCK);
+
+            if (c_fd != -1) {
+                seat->fd = c_fd;
+                lobby->connecting--;
+                if (seat->resume) {
+                    lobby_resume(seat); // never queued, the seat is waiting at its table
+                    continue;
+                }
+                seat_welcome(seat);
+            } else if (errno != ENXIO || ms_since(&seat->joined) > JOIN_CONNECT_MS) {
+                printf("Player %s (PID %d) never opened its pipe, dropped from the queue\n", seat->name, seat->pid);
+                lobby->connecting--;
+                continue;
+            }
+        }
+        *lobby_at(lobby, kept++) = *seat;
+    }
+    lobby->count = kept;
+}
+
+// Tell every waiting player where they stand, only when it changed
+void lobby_announce(Lobby *lobby) {
+    int pos = 0;
+
+    for (int i = 0; i < lobby->count; i++) {
+        Seat *seat = lobby_at(lobby, i);
+        if (!seat_connected(seat)) continue;
+
+        pos++;
+        if (seat->queue_pos != pos) {
+            char msg[32];
+            int len = snprintf(msg, sizeof(msg), "QUEUE %d\n", pos);
+            seat_send(seat, msg, len);
+            seat->queue_pos = pos;
+        }
+    }
+    atomic_store(&lobby_waiting, pos);
+}
+
+static int lobby_ready(Lobby *lobby) {
+    return lobby->count - lobby->connecting;
+}
+
+// Seat the first `count` connected players at a new table
+void lobby_seat(Lobby *lobby, int count) {
+    Seat seats[MAX_PLAYERS];
+    int taken = 0, kept = 0, i;
+
+    // players still connecting keep their place at the front of the queue
+    for (i = 0; i < lobby->count && taken < count; i++) {
+        Seat *seat = lobby_at(lobby, i);
+        if (seat_connected(seat)) seats[taken++] = *seat;
+        else *lobby_at(lobby, kept++) = *seat;
+    }
+    for (; i < lobby->count; i++) {
+        *lobby_at(lobby, kept++) = *lobby_at(lobby, i);
+    }
+    lobby->count = kept;
+
+    Table *t = table_create(taken, seats);
+    if (t) {
+        printf("Table %d starting with %d players!\n", t->id, taken);
+        lobby_assign_table(t);
+    } else {
+        for (int p = 0; p < taken; p++) seat_release(&seats[p]);
+    }
+    lobby->first_joined = time(NULL);
+}
+
+// Tell queued players no seat is coming. Unless `all`, clients whose pipe is
+// not open yet stay (they may be resuming) and get told once they connect.
+static void lobby_close(Lobby *lobby, bool all) {
+    int kept = 0;
+
+    for (int i = 0; i < lobby->count; i++) {
+        Seat *seat = lobby_at(lobby, i);
+        if (!all && !seat_connected(seat)) {
+            *lobby_at(lobby, kept++) = *seat;
+            continue;
+        }
+        if (seat_connected(seat)) seat_send(seat, "LOBBY_CLOSED\n", 13);
+        seat_release(seat);
+    }
+    lobby->count = kept;
+    if (all) {
+        free(lobby->seats);
+        lobby->seats = NULL;
+        lobby->cap = lobby->head = lobby->connecting = 0;
+    }
+}
+
+// Wait up to `ms` for joins, returns early once a table's worth is connected
+static void lobby_wait(int join_fd, Lobby *lobby, int ms) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (server_running && lobby_ready(lobby) < lobby->table_size) {
+        int left = ms - (int)ms_since(&start);
+        if (left <= 0) break;
+
+        struct pollfd pfd = { .fd = join_fd, .events = POLLIN };
+        // retry pending FIFO opens every 10 ms
+        if (poll(&pfd, 1, lobby->connecting > 0 && left > 10 ? 10 : left) > 0) {
+            lobby_read_joins(join_fd, lobby);
+        }
+        lobby_connect(lobby);
+        lobby_announce(lobby);
+    }
+}
+
+// Original single game lobby: 60 second countdown, then one table
+int lobby_single_game(int join_fd, int table_size) {
+    static Lobby lobby;
+    int countdown = LOBBY_WAIT;
+
+    lobby.table_size = table_size;
+
+    for (int i = countdown; i > 0 && server_running ; i--) { 
+        lobby_wait(join_fd, &lobby, 1000);
+
+        printf("\033[2J\033[H"); // Clear Screen and move cursor to top
+        printf("Initiated Server Client of Ono Card Ono Game\n");
+        printf("Waiting for players to join...\n");
+        printf("Current players: %d\n", lobby_ready(&lobby) < table_size ? lobby_ready(&lobby) : table_size);
+        printf("Time left to join: %d seconds\n", i - 1);
+        printf("Players:\n");
+        for(int p=0, shown=0; p<lobby.count && shown<table_size; p++) {
+            if (!seat_connected(lobby_at(&lobby, p))) continue;
+            printf(" - %s\n", lobby_at(&lobby, p)->name);
+            shown++;
+        }
+        if (lobby_ready(&lobby) > table_size)
+            printf("Queued for the next game: %d\n", lobby_ready(&lobby) - table_size);
+        fflush(stdout);
+
+        if (lobby_ready(&lobby) >= table_size)
+            break;
+    }
+
+    printf("\033[2J\033[H");
+    fflush(stdout);
+
+    int seated = lobby_ready(&lobby) < table_size ? lobby_ready(&lobby) : table_size;
+    int status = 1;
+    if (seated > 1) {
+        printf("Game starting with %d players!\n", seated);
+        lobby_seat(&lobby, seated);
+        status = 0;
+    } else {
+        fprintf(stderr, "Number of players must be between 2 and %d.\n", table_size);
+    }
+
+    // one game only, nobody left in the queue gets a seat, but players of the
+    // running table can still come back through the join FIFO
+    lobby_close(&lobby, false);
+    while (server_running && shards_busy()) {
+        lobby_wait(join_fd, &lobby, 200);
+        lobby_close(&lobby, false);
+    }
+    lobby_close(&lobby, true);
+    return status;
+}
+
+// Sharded mode: keep forming tables until Ctrl+C
+void lobby_serve_forever(int join_fd, int table_size) {
+    static Lobby lobby;
+    int last_shown = -1;
+
+    lobby.table_size = table_size;
+
+    while (server_running) {
+        lobby_wait(join_fd, &lobby, 200);
+
+        while (lobby_ready(&lobby) >= table_size) {
+            lobby_seat(&lobby, table_size);
+        }
+        if (lobby_ready(&lobby) > 1 && time(NULL) - lobby.first_joined >= LOBBY_WAIT) {
+            lobby_seat(&lobby, lobby_ready(&lobby));
+        }
+        lobby_announce(&lobby);
+
+        if (lobby.count != last_shown) {
+            printf("Lobby: %d player(s) waiting\n", lobby.count);
+            fflush(stdout);
+            last_shown = lobby.count;
+        }
+    }
+
+    lobby_close(&lobby, true);
+}
+
+// Admin endpoint: a Unix socket taking one command per line (nc -U /tmp/ono_admin.sock).
+// Everything it shows comes from the seqlock views, so looking at a busy table never
+// takes its game_lock; commands that change a table are run by the table's reactor.
+typedef struct {
+    int fd;
+    char buf[256];
+    size_t len;
+} AdminConn;
+
+atomic_int admin_running;
+pthread_t admin_tid;
+int admin_fd = -1;
+
+// Consistent copy of a view, false if the slot is free or never published
+static bool view_read(TableView *v, TableInfo *out) {
+    for (int tries = 0; tries < 100; tries++) {
+        unsigned before = atomic_load_explicit(&v->seq, memory_order_acquire);
+        if (!atomic_load(&v->in_use) || before == 0) return false;
+        if (before & 1) {
+            sched_yield(); // the reactor is mid-publish
+            continue;
+        }
+        memcpy(out, &v->info, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&v->seq, memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+static TableView *admin_find_view(int id, TableInfo *out) {
+    for (int i = 0; i < ADMIN_VIEWS; i++) {
+        if (view_read(&table_views[i], out) && out->table_id == id) return &table_views[i];
+    }
+    return NULL;
+}
+
+static bool admin_find_table(int id, TableInfo *out) {
+    return admin_find_view(id, out) != NULL;
+}
+
+// Seat by number or by player name
+static int admin_find_seat(TableInfo *info, const char *who) {
+    char *end;
+    long seat = strtol(who, &end, 10);
+    if (*end == '\0' && end != who) return seat >= 0 && seat < info->num_players ? (int)seat : -1;
+
+    for (int p = 0; p < info->num_players; p++) {
+        if (strcmp(info->players[p].name, who) == 0) return p;
+    }
+    return -1;
+}
+
+// Win-probability estimator. A coordinator thread watches the admin views and,
+// for every table that moved since it last looked, plays random rollouts from
+// what a spectator can see: the pile card, whose turn it is, the direction and
+// each seat's hand size. Hidden hands are dealt from the table's shuffled decks
+// (less the pile card) and played out by random bots with the normal rules.
+// Workers run rollouts until the time budget is spent, and the share of wins
+// per seat is published next to the view. Tables are never locked or slowed,
+// but the rollouts keep cores busy, so it only runs when -o asks for it.
+int odds_threads = 0;
+
+typedef struct {
+    pthread_t tid;
+    unsigned int seed;
+    GameState *game;        // reused from rollout to rollout, headless
+    int deck_cap;
+    unsigned long wins[MAX_PLAYERS];
+    int rollouts;
+} OddsWorker;
+
+static OddsWorker *odds_workers;
+static pthread_t odds_tid;
+static pthread_barrier_t odds_start, odds_done;
+static atomic_int odds_running;
+
+// the estimate being worked on, only written while the workers wait at odds_start
+static TableInfo odds_job;
+static Card *odds_pool;
+static int odds_pool_len;
+static struct timespec odds_deadline;
+
+// Deal the hidden hands and play the game out, returns the winning seat
+static int odds_rollout(OddsWorker *w) {
+    GameState *game = w->game;
+    TableInfo *info = &odds_job;
+    int n = info->num_players;
+
+    memcpy(game->deck.deckCards, odds_pool, sizeof(Card) * odds_pool_len);
+    game->deck.size = odds_pool_len;
+    game->deck.top_index = 0;
+    deckShuffle(&game->deck);
+
+    game->num_players = n;
+    game->game_over = 0;
+    game->winner_pid = 0;
+    game->direction = info->direction;
+    game->current_card_idx = 0;
+    game->played_cards[0] = info->top;
+    for (int p = 0; p < n; p++) {
+        Player *P = &game->players[p];
+        P->is_active = 1;
+        P->pid = p + 1;
+        P->hand_size = 0;
+        memset(&P->hand_index, 0, sizeof(P->hand_index));
+    }
+    seat_ring_init(game);
+    for (int p = 0; p < n; p++) {
+        if (!info->players[p].active) {
+            player_leave(game, p);
+            continue;
+        }
+        for (int c = 0; c < info->players[p].hand_size; c++)
+            player_add_card(&game->players[p], deckDraw(&game->deck));
+    }
+    game->current_player = info->current_player;
+    game->next_player = seat_step(game, game->current_player, game->direction);
+
+    for (int turns = 0; !game->game_over && turns < ODDS_MAX_TURNS; turns++) {
+        int player = game->current_player;
+        bot_choose_move(game, player, BOT_RANDOM, &w->seed, game->stored_move, sizeof(game->stored_move));
+        game_apply_move(game, player);
+    }
+    if (game->game_over) return game->winner_pid - 1;
+
+    int best = -1;
+    for (int p = 0; p < n; p++) {
+        if (game->players[p].is_active && (best == -1 || player_score(&game->players[p]) < player_score(&game->players[best])))
+            best = p;
+    }
+    return best;
+}
+
+void *odds_worker_func(void *arg) {
+    OddsWorker *w = (OddsWorker *)arg;
+
+    while (1) {
+        pthread_barrier_wait(&odds_start);
+        if (!atomic_load(&odds_running)) break;
+
+        memset(w->wins, 0, sizeof(w->wins));
+        w->rollouts = 0;
+        if (odds_pool_len > w->deck_cap) {
+            Card *grown = realloc(w->game->deck.deckCards, sizeof(Card) * odds_pool_len);
+            if (grown) {
+                w->game->deck.deckCards = grown;
+                w->deck_cap = odds_pool_len;
+            }
+        }
+
+        // check the clock every few rollouts, a rollout is a few microseconds
+        struct timespec now;
+        do {
+            for (int i = 0; i < 8 && odds_pool_len <= w->deck_cap; i++) {
+                int winner = odds_rollout(w);
+                if (winner >= 0) w->wins[winner]++;
+                w->rollouts++;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &now);
+        } while (odds_pool_len <= w->deck_cap && timespec_before(&now, &odds_deadline));
+
+        pthread_barrier_wait(&odds_done);
+    }
+    return NULL;
+}
+
+// Estimate one table with every worker, then publish it next to the view
+static void odds_estimate(TableView *v, const TableInfo *info) {
+    Deck full = { .seed = (unsigned int)info->moves };
+
+    odds_job = *info;
+    deckInit(&full, info->deck_size / DECK_SIZE);
+    odds_pool_len = 0;
+    bool top_removed = false;
+    for (int i = 0; i < full.size; i++) {
+        Card *c = &full.deckCards[i];
+        // a wild on the pile has had its colour changed, match it by value
+        if (!top_removed && c->value == info->top.value
+            && (c->colour == info->top.colour || c->colour == CARD_COLOUR_BLACK)) {
+            top_removed = true;
+            continue;
+        }
+        odds_pool[odds_pool_len++] = *c;
+    }
+    deckFree(&full);
+
+    clock_gettime(CLOCK_MONOTONIC, &odds_deadline);
+    timespec_add_ms(&odds_deadline, ODDS_BUDGET_MS);
+    pthread_barrier_wait(&odds_start);
+    pthread_barrier_wait(&odds_done);
+
+    unsigned long wins[MAX_PLAYERS] = {0};
+    int rollouts = 0;
+    for (int i = 0; i < odds_threads; i++) {
+        rollouts += odds_workers[i].rollouts;
+        for (int p = 0; p < info->num_players; p++) wins[p] += odds_workers[i].wins[p];
+    }
+
+    unsigned seq = atomic_load_explicit(&v->odds_seq, memory_order_relaxed);
+    atomic_store_explicit(&v->odds_seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    v->odds.table_id = info->table_id;
+    v->odds.moves = info->moves;
+    v->odds.rollouts = rollouts;
+    for (int p = 0; p < info->num_players; p++) v->odds.win[p] = rollouts ? (float)wins[p] / rollouts : 0;
+    atomic_store_explicit(&v->odds_seq, seq + 2, memory_order_release);
+}
+
+// Tables are taken in view order, each one again only once it has moved on
+void *odds_thread_func(void *arg) {
+    (void)arg;
+    static TableInfo info;
+    static int done_table[ADMIN_VIEWS];
+    static unsigned long done_moves[ADMIN_VIEWS];
+
+    while (atomic_load(&odds_running)) {
+        bool worked = false;
+
+        for (int i = 0; i < ADMIN_VIEWS && atomic_load(&odds_running); i++) {
+            if (!view_read(&table_views[i], &info) || info.phase != TABLE_PLAYING) continue;
+            if (done_table[i] == info.table_id && done_moves[i] == info.moves) continue;
+
+            // a seat with no cards left has already won
+            int live = 0;
+            bool decided = false;
+            for (int p = 0; p < info.num_players; p++) {
+                if (!info.players[p].active) continue;
+                live++;
+                decided |= info.players[p].hand_size == 0;
+            }
+            if (live < 2 || decided || info.deck_size < DECK_SIZE || info.deck_size > DECK_SIZE * MAX_PLAYERS) continue;
+
+            odds_estimate(&table_views[i], &info);
+            done_table[i] = info.table_id;
+            done_moves[i] = info.moves;
+            worked = true;
+        }
+        if (!worked) usleep(ODDS_BUDGET_MS * 1000);
+    }
+    return NULL;
+}
+
+// Latest estimate for the table in this view, false if there is none for it yet
+static bool odds_read(TableView *v, int table_id, TableOdds *out) {
+    for (int tries = 0; tries < 100; tries++) {
+        unsigned before = atomic_load_explicit(&v->odds_seq, memory_order_acquire);
+        if (before == 0) return false;
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+        memcpy(out, &v->odds, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&v->odds_seq, memory_order_relaxed) == before) return out->table_id == table_id;
+    }
+    return false;
+}
+
+void odds_start_workers(void) {
+    if (odds_threads < 1) return;
+
+    odds_pool = malloc(sizeof(Card) * DECK_SIZE * MAX_PLAYERS);
+    odds_workers = calloc(odds_threads, sizeof(OddsWorker));
+    if (!odds_pool || !odds_workers) {
+        perror("Odds estimator unavailable");
+        free(odds_pool);
+        free(odds_workers);
+        odds_threads = 0;
+        return;
+    }
+
+    pthread_barrier_init(&odds_start, NULL, odds_threads + 1);
+    pthread_barrier_init(&odds_done, NULL, odds_threads + 1);
+    atomic_store(&odds_running, 1);
+    for (int i = 0; i < odds_threads; i++) {
+        OddsWorker *w = &odds_workers[i];
+        w->seed = (unsigned int)time(NULL) * 2654435761u + i;
+        w->game = calloc(1, sizeof(GameState));
+        w->game->quiet = 1;
+        w->game->deck.seed = w->seed ^ 0x9e3779b9u;
+        pthread_create(&w->tid, NULL, odds_worker_func, w);
+    }
+    pthread_create(&odds_tid, NULL, odds_thread_func, NULL);
+}
+
+void odds_stop_workers(void) {
+    if (odds_threads < 1) return;
+
+    atomic_store(&odds_running, 0);
+    pthread_join(odds_tid, NULL);
+    pthread_barrier_wait(&odds_start); // workers see odds_running and leave
+    for (int i = 0; i < odds_threads; i++) {
+        pthread_join(odds_workers[i].tid, NULL);
+        game_free(odds_workers[i].game);
+        free(odds_workers[i].game);
+    }
+    pthread_barrier_destroy(&odds_start);
+    pthread_barrier_destroy(&odds_done);
+    free(odds_workers);
+    free(odds_pool);
+}
+
+static const char *admin_phase_name(TablePhase phase) {
+    return phase == TABLE_PLAYING ? "playing" : phase == TABLE_DRAINING ? "draining" : "finished";
+}
+
+static void admin_list(int fd) {
+    TableInfo info;
+    int shown = 0;
+
+    for (int i = 0; i < ADMIN_VIEWS; i++) {
+        if (!view_read(&table_views[i], &info)) continue;
+        dprintf(fd, "table %d: reactor %d, %s, %d players, %s to play, pile %s, %lu moves\n",
+            info.table_id, info.shard, admin_phase_name(info.phase), info.num_players,
+            info.players[info.current_player].name, info.pile, info.moves);
+        shown++;
+    }
+    dprintf(fd, "%d table(s)\n", shown);
+}
+
+static void admin_show(int fd, int id) {
+    TableInfo info;
+    TableOdds odds;
+    TableView *v = admin_find_view(id, &info);
+
+    if (!v) {
+        dprintf(fd, "ERR no table %d\n", id);
+        return;
+    }
+    dprintf(fd, "table %d on reactor %d, %s\n", info.table_id, info.shard, admin_phase_name(info.phase));
+    dprintf(fd, "pile: %s, direction: %s, %d cards left in the deck, %lu moves\n", info.pile,
+        info.direction == 1 ? "clockwise" : "anti-clockwise", info.deck_left, info.moves);
+    for (int p = 0; p < info.num_players; p++) {
+        dprintf(fd, "seat %d%s %s (PID %d): %d cards, %d points, %s, outbox %d msgs / %zu bytes\n", p,
+            p == info.current_player ? " *" : "", info.players[p].name, info.players[p].pid,
+            info.players[p].hand_size, info.players[p].score,
+            !info.players[p].active ? "out" : info.players[p].away ? "away" : "playing",
+            info.players[p].queued_msgs, info.players[p].queued_bytes);
+    }
+    if (odds_read(v, id, &odds)) {
+        dprintf(fd, "chance to win (%d rollouts at move %lu):", odds.rollouts, odds.moves);
+        for (int p = 0; p < info.num_players; p++) {
+            if (info.players[p].active) dprintf(fd, " %s %.0f%%", info.players[p].name, odds.win[p] * 100);
+        }
+        dprintf(fd, "\n");
+    }
+}
+
+static void admin_stats(int fd) {
+    int queued = 0;
+    unsigned long dropped = 0;
+    pthread_mutex_lock(&logq->lock);
+    queued = logq->len;
+    pthread_mutex_unlock(&logq->lock);
+    for (int i = 0; i < num_shards; i++) {
+        Shard *s = &shards[i];
+        queued += atomic_load(&s->log_tail) - atomic_load(&s->log_head);
+        dropped += atomic_load(&s->log_dropped);
+    }
+    dprintf(fd, "logger: %d message(s) queued, %lu dropped by reactors\n", queued, dropped);
+    dprintf(fd, "lobby: %d player(s) waiting\n", atomic_load(&lobby_waiting));
+
+    pthread_mutex_lock(&sessions_lock);
+    int used = sessions_used;
+    pthread_mutex_unlock(&sessions_lock);
+    dprintf(fd, "sessions: %d of %d slots used\n", used, SESSION_SLOTS);
+    dprintf(fd, "arenas: %d pooled, %ld KB mapped\n", arena_pool_count(),
+        atomic_load(&arena_bytes_mapped) / 1024);
+    pthread_mutex_lock(&input_pool_lock);
+    int workers = input_pool_len;
+    pthread_mutex_unlock(&input_pool_lock);
+    pthread_mutex_lock(&deck_pool_lock);
+    int decks = deck_pool_len;
+    pthread_mutex_unlock(&deck_pool_lock);
+    dprintf(fd, "ready: %d input worker(s), %d shuffled deck(s)\n", workers, decks);
+
+    for (int i = 0; i < num_shards; i++) {
+        Shard *s = &shards[i];
+        dprintf(fd, "reactor %d: %d live tables, %lu finished, %lu moves\n", s->id,
+            atomic_load(&s->live_tables), s->tables_played, s->moves);
+    }
+
+    TableInfo info;
+    int tables = 0, msgs = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < ADMIN_VIEWS; i++) {
+        if (!view_read(&table_views[i], &info)) continue;
+        tables++;
+        for (int p = 0; p < info.num_players; p++) {
+            msgs += info.players[p].queued_msgs;
+            bytes += info.players[p].queued_bytes;
+        }
+    }
+    dprintf(fd, "outboxes: %d msgs / %zu bytes queued over %d table(s)\n", msgs, bytes, tables);
+}
+
+// kick/draw/end: check the table and seat against the view, the reactor checks again
+static void admin_command(int fd, AdminOp op, int id, const char *who, int count) {
+    TableInfo info;
+    AdminCmd cmd = { .op = op, .table_id = id, .count = count };
+
+    if (!admin_find_table(id, &info)) {
+        dprintf(fd, "ERR no table %d\n", id);
+        return;
+    }
+    if (op != ADMIN_END && (cmd.seat = admin_find_seat(&info, who)) < 0) {
+        dprintf(fd, "ERR no player %s at table %d\n", who, id);
+        return;
+    }
+
+    cmd.reply_fd = dup(fd);
+    if (cmd.reply_fd == -1 || !admin_push(&shards[info.shard], &cmd)) {
+        if (cmd.reply_fd != -1) close(cmd.reply_fd);
+        dprintf(fd, "ERR reactor %d is busy, try again\n", info.shard);
+    }
+}
+
+// Returns false when the connection should be closed
+static bool admin_handle(int fd, char *line) {
+    char verb[16] = "", who[NAME_SIZE] = "";
+    int id = 0, count = 1;
+    int args = sscanf(line, "%15s %d %49s %d", verb, &id, who, &count);
+
+    if (args < 1) return true;
+    if (strcmp(verb, "quit") == 0) return false;
+
+    if (strcmp(verb, "list") == 0) {
+        admin_list(fd);
+    } else if (strcmp(verb, "show") == 0 && args >= 2) {
+        admin_show(fd, id);
+    } else if (strcmp(verb, "stats") == 0) {
+        admin_stats(fd);
+    } else if (strcmp(verb, "kick") == 0 && args >= 3) {
+        admin_command(fd, ADMIN_KICK, id, who, 0);
+    } else if (strcmp(verb, "draw") == 0 && args >= 3) {
+        admin_command(fd, ADMIN_DRAW, id, who, count > 0 ? count : 1);
+    } else if (strcmp(verb, "end") == 0 && args >= 2) {
+        admin_command(fd, ADMIN_END, id, NULL, 0);
+    } else {
+        dprintf(fd, "commands: list | show <table> | stats | kick <table> <seat|name> |"
+            " draw <table> <seat|name> [n] | end <table> | quit\n");
+    }
+    return true;
+}
+
+void *admin_thread_func(void *arg) {
+    (void)arg;
+    AdminConn conns[ADMIN_CLIENTS];
+    int n = 0;
+
+    while (atomic_load(&admin_running)) {
+        struct pollfd pfds[1 + ADMIN_CLIENTS];
+        pfds[0].fd = admin_fd;
+        pfds[0].events = POLLIN;
+        for (int i = 0; i < n; i++) {
+            pfds[1 + i].fd = conns[i].fd;
+            pfds[1 + i].events = POLLIN;
+        }
+        if (poll(pfds, 1 + n, 200) <= 0) continue;
+
+        // newest first, so removing one (swap with the last) keeps the rest in step
+        for (int i = n - 1; i >= 0; i--) {
+            if (pfds[1 + i].revents == 0) continue;
+            AdminConn *c = &conns[i];
+            ssize_t got = read(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len);
+            bool open = got > 0;
+
+            if (open) {
+                c->len += got;
+                c->buf[c->len] = '\0';
+                char *line = c->buf, *nl;
+                while (open && (nl = strchr(line, '\n')) != NULL) {
+                    *nl = '\0';
+                    open = admin_handle(c->fd, line);
+                    line = nl + 1;
+                }
+                c->len = c->buf + c->len - line;
+                if (c->len == sizeof(c->buf) - 1) c->len = 0; // overlong line, drop it
+                memmove(c->buf, line, c->len);
+            }
+            if (!open) {
+                close(c->fd);
+                conns[i] = conns[--n];
+            }
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            int fd = accept(admin_fd, NULL, NULL);
+            if (fd != -1 && n == ADMIN_CLIENTS) {
+                dprintf(fd, "ERR too many admin connections\n");
+                close(fd);
+            } else if (fd != -1) {
+                conns[n++] = (AdminConn){ .fd = fd };
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) close(conns[i].fd);
+    return NULL;
+}
+
+// Only the user running the server may connect (the socket is mode 0600)
+void admin_start(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strncpy(addr.sun_path, ADMIN_SOCKET, sizeof(addr.sun_path) - 1);
+
+    admin_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(ADMIN_SOCKET);
+    if (admin_fd == -1 || bind(admin_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1
+        || chmod(ADMIN_SOCKET, 0600) == -1 || listen(admin_fd, ADMIN_CLIENTS) == -1) {
+        perror("Admin socket unavailable");
+        if (admin_fd != -1) close(admin_fd);
+        admin_fd = -1;
+        return;
+    }
+
+    atomic_store(&admin_running, 1);
+    pthread_create(&admin_tid, NULL, admin_thread_func, NULL);
+}
+
+void admin_stop(void) {
+    if (admin_fd == -1) return;
+
+    atomic_store(&admin_running, 0);
+    pthread_join(admin_tid, NULL);
+    close(admin_fd);
+    unlink(ADMIN_SOCKET);
+    admin_fd = -1;
+}
+
+#ifndef ONO_NO_MAIN
+char join_path[256] = JOIN_FIFO; // where clients ask to join, -j
+
+// Game starts
+int main(int argc, char *argv[]) {
+    signal(SIGINT, signal_handler); // handles server shutdown via Ctrl+C
+    signal(SIGPIPE, SIG_IGN); // Ignore SIGPIPE to prevent crashes on broken pipes
+
+    // -r <n> runs n reactor threads and keeps seating tables, -c pins them to CPUs,
+    // -t <n> is the number of players per table, -s/-a/-k set log rotation,
+    // -g <seconds> is how long a disconnected player's seat is held,
+    // -H <file> is where finished games are appended for histq,
+    // -d <n> shuffles n decks together at every table (default: one per 10 seats),
+    // -o <n> runs the win-probability estimator on n threads (off by default),
+    // -e answers HINT with the endgame solver, -j <path> moves the join FIFO
+    int reactors = 0;
+    int table_size = TABLE_SIZE;
+    bool pin = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:ct:s:a:k:g:H:d:o:ej:")) != -1) {
+        switch (opt) {
+        case 'r':
+            reactors = atoi(optarg);
+            if (reactors < 1 || reactors > MAX_SHARDS) {
+                fprintf(stderr, "Reactor count must be between 1 and %d.\n", MAX_SHARDS);
+                return 1;
+            }
+            break;
+        case 'c':
+            pin = true;
+            break;
+        case 't':
+            table_size = atoi(optarg);
+            if (table_size < 2 || table_size > MAX_PLAYERS) {
+                fprintf(stderr, "Table size must be between 2 and %d.\n", MAX_PLAYERS);
+                return 1;
+            }
+            break;
+        case 's':
+            log_rotation.max_bytes = atol(optarg) * 1024L * 1024L;
+            break;
+        case 'a':
+            log_rotation.max_age = atoi(optarg) * 60;
+            break;
+        case 'k':
+            log_rotation.keep = atoi(optarg);
+            if (log_rotation.keep < 1) log_rotation.keep = 1;
+            break;
+        case 'g':
+            resume_grace_ms = atoi(optarg) * 1000;
+            if (resume_grace_ms < 0) resume_grace_ms = 0;
+            break;
+        case 'H':
+            snprintf(history_path, sizeof(history_path), "%s", optarg);
+            break;
+        case 'd':
+            table_decks = atoi(optarg);
+            if (table_decks < 1) table_decks = 0;
+            break;
+        case 'o':
+            odds_threads = atoi(optarg);
+            if (odds_threads < 0) odds_threads = 0;
+            break;
+        case 'e':
+            endgame_hints = true;
+            break;
+        case 'j':
+            snprintf(join_path, sizeof(join_path), "%s", optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-r reactors] [-c] [-t table size] [-s rotate MB] [-a rotate minutes] [-k keep] [-g grace seconds] [-H history file] [-d decks] [-o odds threads] [-e] [-j join fifo]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    logq = mmap(NULL, sizeof(LogQueue), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if(logq == MAP_FAILED) {
+      perror("mmap failed");
+      return 1;
+    }
+
+    // Initialize Sync Premitives in Shared Memory
+    sem_init(&logq->count, 1, 0); 
+    sem_init(&logq->space_left, 1, LOG_QUEUE_SIZE);
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&logq->lock, &attr);
+
+    history_open();
+    rotate_start();
+    pthread_t log_tid;
+    pthread_create(&log_tid, NULL, logger_thread_func, (void *)logq);
+
+    unlink(join_path); // Remove any existing FIFO
+    if (mkfifo(join_path, 0666) == -1) {
+        perror("Failed to create join FIFO");
+        enqueue_log("Failed to create join FIFO");
+        return 1;
+    }
+
+    int join_fd = open(join_path, O_RDONLY | O_NONBLOCK);
+    if (join_fd == -1) {
+        perror("Failed to open join FIFO");
+        enqueue_log("Failed to open join FIFO");
+        unlink(join_path);
+        return 1;
+    }
+
+    // a second writer keeps the FIFO from reporting POLLHUP between clients
+    int keepalive_fd = open(join_path, O_WRONLY | O_NONBLOCK);
+
+    echo_moves = reactors == 0;
+    shards_start(reactors > 0 ? reactors : 1, pin);
+    // a long-running server keeps input workers and shuffled decks ready for its tables
+    if (reactors > 0) input_pool_start(2 * table_size, deck_count(table_size));
+    admin_start();
+    odds_start_workers();
+    enqueue_log("Server started, waiting for players to join.");
+
+    int status = 0;
+    if (reactors > 0) {
+        printf("Serving tables of %d on %d reactor(s), Ctrl+C to stop\n", table_size, reactors);
+        lobby_serve_forever(join_fd, table_size);
+    } else {
+        status = lobby_single_game(join_fd, table_size);
+    }
+    odds_stop_workers();
+    admin_stop();
+    if (keepalive_fd != -1) close(keepalive_fd);
+    close(join_fd);
+    unlink(join_path);
+
+    atomic_store(&lobby_open, 0);
+    for (int i = 0; i < num_shards; i++) {
+        write(shards[i].wake_pipe[1], "q", 1);
+        pthread_join(shards[i].tid, NULL);
+    }
+    input_pool_stop();
+    shards_report();
+
+    // the logger queue lives in shared memory, so stop it before unmapping
+    enqueue_log("SERVER_SHUTDOWN");
+    pthread_join(log_tid, NULL);
+    logfile_close(&scores_log);
+    rotate_stop();
+    if (history_fd != -1) close(history_fd);
+
+    if(munmap(logq, sizeof(LogQueue)) == -1){
+        perror("freeing shared memory failed");
+    }
+    return status;
+}
+#endif // ONO_NO_MAIN
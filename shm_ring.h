@@ -0,0 +1,105 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+// Shared memory transport for clients on the same host.
+// The client creates /dev/shm/ono_<pid>, the server maps it at join time.
+// Each direction is a single producer / single consumer ring, and a
+// sleeping consumer is woken with a futex instead of a pipe write.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SHM_RING_SLOTS 32
+#define SHM_RING_MSG_LEN 1024
+#define SHM_CHANNEL_MAGIC 0x4f4e4f31 // "ONO1"
+
+typedef struct {
+    uint32_t len;
+    char data[SHM_RING_MSG_LEN];
+} ShmRingSlot;
+
+typedef struct {
+    atomic_uint head;       // next slot to read, only the consumer moves it
+    atomic_uint tail;       // next slot to write, only the producer moves it
+    atomic_uint seq;        // futex word, bumped on every push
+    atomic_uint waiters;    // consumer is (about to be) asleep on seq
+    ShmRingSlot slots[SHM_RING_SLOTS];
+} ShmRing;
+
+typedef struct {
+    uint32_t magic;
+    atomic_int closed;      // set by whichever side leaves first
+    ShmRing request;        // client -> server (moves)
+    ShmRing response;       // server -> client (PILE/HAND, TURN ...)
+} ShmChannel;
+
+static inline void shm_channel_name(char *buffer, size_t size, int pid) {
+    snprintf(buffer, size, "/ono_%d", pid);
+}
+
+static inline void shm_ring_wake(ShmRing *ring) {
+    // no syscall unless the consumer is actually sleeping
+    if (atomic_load(&ring->waiters) > 0) {
+        syscall(SYS_futex, &ring->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+// Returns false when the ring is full
+static inline bool shm_ring_push(ShmRing *ring, const char *data, size_t len) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (tail - head == SHM_RING_SLOTS) return false;
+    if (len > SHM_RING_MSG_LEN) len = SHM_RING_MSG_LEN;
+
+    ShmRingSlot *slot = &ring->slots[tail % SHM_RING_SLOTS];
+    memcpy(slot->data, data, len);
+    slot->len = (uint32_t)len;
+
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    atomic_fetch_add(&ring->seq, 1);
+    return true;
+}
+
+// Copies the oldest message out, returns its length or -1 when empty
+static inline int shm_ring_pop(ShmRing *ring, char *out, size_t size) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head == tail) return -1;
+
+    ShmRingSlot *slot = &ring->slots[head % SHM_RING_SLOTS];
+    size_t len = slot->len < size ? slot->len : size;
+    memcpy(out, slot->data, len);
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return (int)len;
+}
+
+static inline bool shm_ring_empty(ShmRing *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_relaxed) ==
+           atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+// Sleep until something is pushed or timeout_ms passes (-1 = forever)
+static inline void shm_ring_wait(ShmRing *ring, int timeout_ms) {
+    unsigned seen = atomic_load(&ring->seq);
+
+    atomic_fetch_add(&ring->waiters, 1);
+    // a push between the load above and the wait changes seq, so the wait returns at once
+    if (shm_ring_empty(ring)) {
+        struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+        syscall(SYS_futex, &ring->seq, FUTEX_WAIT, seen, timeout_ms < 0 ? NULL : &ts, NULL, 0);
+    }
+    atomic_fetch_sub(&ring->waiters, 1);
+}
+
+#endif // SHM_RING_H
@@ -0,0 +1,750 @@
+// Soak harness: runs the server for hours against synthetic clients and
+// injects faults: clients killed at any moment, SIGINT in the middle of a
+// turn, input or output FIFOs closed on one side, readers that stall and
+// clients that send garbage. With -R the server itself gets SIGINT mid-game
+// every so often and is started again. Every interval it reports how long
+// tables took to move again after a fault, the server's processes (zombies
+// among them), FIFOs left in /tmp and throughput against the first interval.
+//
+//   ./soak -d 120 -c 40                   (two hours, 40 clients)
+//   ./soak -d 480 -f 0.3 -R 30 -- -r 4    (restart the server every 30 minutes)
+//
+// The server (-s, default ./server) runs in a scratch directory with -g 0, so
+// a dropped player's turn is skipped at once, and -r 1 so it keeps seating
+// tables; arguments after -- go to it as well. It needs the join FIFO and
+// admin socket in /tmp to itself. Exits with status 2 if a table got stuck,
+// the server crashed or left processes behind.
+// -p is how long a client thinks before each move.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define JOIN_FIFO "/tmp/join_fifo"
+#define ADMIN_SOCKET "/tmp/ono_admin.sock"
+#define SOAK_MAX_CLIENTS 512
+#define SOAK_MAX_ARGS 32
+#define SOAK_POLL_MS 20
+#define SOAK_STUCK_MS 30000     // a table not moving this long after a fault is stuck
+#define SOAK_STALL_MS 8000      // a stalled reader stops reading this long (the server allows 5 s)
+#define SOAK_KILL_MS 15000      // a client marked for killing goes within this long of starting
+#define SOAK_SEATING_MS 250     // how often clients not yet seated are looked for
+#define SOAK_SAMPLES 65536      // recovery latencies kept per interval
+#define SOAK_TRACKED 1024       // faults waiting for their table to move
+#define SOAK_REPLY_LEN 65536
+
+typedef enum FaultKind {
+    FAULT_NONE = 0,
+    FAULT_KILL,         // SIGKILL from the harness, at any moment
+    FAULT_SIGINT,       // SIGINT while it is the client's turn
+    FAULT_HALF_IN,      // stops writing: closes its end of the input FIFO, still reads
+    FAULT_HALF_OUT,     // stops reading: closes its end of the output FIFO, still there
+    FAULT_STALL,        // sits on its turn for SOAK_STALL_MS without reading
+    FAULT_GARBAGE,      // binary junk, an overlong line and broken moves, then plays on
+    FAULT_KINDS
+} FaultKind;
+
+static const char *fault_names[FAULT_KINDS] = { "none", "kill", "sigint", "half-in", "half-out", "stall", "garbage" };
+
+// One per client slot, shared with the client process
+typedef struct {
+    pid_t pid;                  // 0 = slot empty
+    FaultKind fault;
+    int fault_turn;             // the client's TURN the fault strikes on
+    atomic_llong struck_ns;     // when it struck, 0 = not yet
+} SoakSlot;
+
+typedef struct {
+    SoakSlot slots[SOAK_MAX_CLIENTS];
+    atomic_long turns;          // TURNs answered, all clients together
+    atomic_long finished;       // clients that saw GAME_OVER
+    atomic_long invalid;        // INVALID_MOVE replies
+} SoakShared;
+
+// A fault whose table has not moved since
+typedef struct {
+    FaultKind kind;
+    pid_t pid;
+    long long struck_ns;
+    int table;                  // -1 until the client is found at a table
+    unsigned long moves;        // the table's move count when it was found
+    char to_play[64];           // and whose turn it was
+} Tracked;
+
+typedef struct {
+    long long start_ns;
+    long turns;
+    long faults[FAULT_KINDS];
+    long latencies;             // samples[] in use
+    long long samples[SOAK_SAMPLES]; // recovery latencies, ns
+    long long worst[FAULT_KINDS];    // slowest recovery by fault
+    int stuck;
+    int unplaced;               // faults on a client never seen at a table
+    int cleaned;                // FIFOs of killed clients removed
+} Interval;
+
+static SoakShared *shared;
+static int num_clients = 20;
+static long long respawn_at[SOAK_MAX_CLIENTS];
+static long long kill_at[SOAK_MAX_CLIENTS];
+static bool tracked_slot[SOAK_MAX_CLIENTS];
+static int slot_table[SOAK_MAX_CLIENTS];    // table id the client sits at, -1 = not seen at one
+static Tracked tracked[SOAK_TRACKED];
+static int tracked_len = 0;
+static double fault_rate = 0.2;
+static int think_ms = 20;          // a client's pause before each move
+static unsigned int seed = 1;
+
+static const char *server_path = "./server";
+static char *server_args[SOAK_MAX_ARGS];
+static char workdir[256];
+static pid_t server_pid = 0;
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_sigint(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static long long now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static long long rand_ms(int from, int to) {
+    return (from + rand_r(&seed) % (to - from + 1)) * 1000000LL;
+}
+
+// ---- synthetic client ----
+
+static char client_out[64], client_in[64];
+
+static void client_exit(int status) {
+    unlink(client_out);
+    unlink(client_in);
+    _exit(status);
+}
+
+static int hex_digit(char c) {
+    return c >= 'a' ? c - 'a' + 10 : c - '0';
+}
+
+// First playable card in the masks of "TURN <hand> <playable> <wild>"
+static void client_move(const char *turn, char *out, size_t size, unsigned int *rs) {
+    char playable[300], wild[300];
+    int hand;
+
+    if (sscanf(turn, "TURN %d %299s %299s", &hand, playable, wild) == 3) {
+        for (int d = 0; playable[d] && wild[d]; d++) {
+            for (int b = 0; b < 4; b++) {
+                if (!(hex_digit(playable[d]) & (1 << b))) continue;
+                int colour = hex_digit(wild[d]) & (1 << b) ? 1 + rand_r(rs) % 4 : 0;
+                snprintf(out, size, "MOVE %d %d\n", d * 4 + b + 1, hand == 2 ? 1 : colour);
+                return;
+            }
+        }
+    }
+    snprintf(out, size, "DRAW\n");
+}
+
+static void client_garbage(int fd, unsigned int *rs) {
+    char junk[400];
+
+    for (size_t i = 0; i < sizeof(junk) - 1; i++) junk[i] = 1 + rand_r(rs) % 255;
+    junk[sizeof(junk) - 1] = '\n';
+    (void)!write(fd, junk, sizeof(junk));
+    const char *broken = "\n\nMOVE\nMOVE 999 9\nMOVE -3 -3\nmove 1\nJUMP 1\nDRAW DRAW DRAW\n";
+    (void)!write(fd, broken, strlen(broken));
+}
+
+// Returns false once the client is done with this turn for good
+static bool client_strike(SoakSlot *slot, int *rfd, int *wfd, unsigned int *rs) {
+    atomic_store(&slot->struck_ns, now_ns());
+
+    switch (slot->fault) {
+    case FAULT_SIGINT:
+        raise(SIGINT);
+        client_exit(1);
+    case FAULT_HALF_IN:
+        close(*wfd);
+        *wfd = -1;
+        return false;
+    case FAULT_HALF_OUT:
+        close(*rfd);
+        usleep(SOAK_STALL_MS * 1000);
+        client_exit(0);
+    case FAULT_STALL:
+        usleep(SOAK_STALL_MS * 1000);
+        return true;
+    case FAULT_GARBAGE:
+        client_garbage(*wfd, rs);
+        return true;
+    default:
+        return true;
+    }
+}
+
+static void client_main(int index) {
+    SoakSlot *slot = &shared->slots[index];
+    pid_t pid = getpid();
+    unsigned int rs = (unsigned int)pid;
+    int fd;
+
+    snprintf(client_out, sizeof(client_out), "/tmp/client_%d", pid);
+    snprintf(client_in, sizeof(client_in), "/tmp/client_%d_in", pid);
+    unlink(client_out);
+    unlink(client_in);
+    if (mkfifo(client_out, 0666) == -1 || mkfifo(client_in, 0666) == -1) client_exit(1);
+
+    // a lobby that never seats us, or a server that went away, ends it
+    alarm(120);
+    while ((fd = open(JOIN_FIFO, O_WRONLY)) == -1) usleep(50000);
+    dprintf(fd, "%d soak%d\n", pid, index);
+    close(fd);
+
+    int rfd = open(client_out, O_RDONLY);
+    int wfd = open(client_in, O_RDWR);
+    if (rfd == -1 || wfd == -1) client_exit(1);
+    alarm(0);
+
+    char buffer[8192];
+    size_t len = 0;
+    int turns = 0;
+
+    while (1) {
+        ssize_t n = read(rfd, buffer + len, sizeof(buffer) - len);
+        if (n <= 0) client_exit(0);
+        len += n;
+
+        char *line = buffer;
+        char *nl;
+        while ((nl = memchr(line, '\n', buffer + len - line)) != NULL) {
+            *nl = '\0';
+            if (strncmp(line, "TURN", 4) == 0) {
+                char move[64];
+                bool answer = true;
+
+                if (slot->fault != FAULT_NONE && slot->fault != FAULT_KILL && ++turns == slot->fault_turn)
+                    answer = client_strike(slot, &rfd, &wfd, &rs);
+                if (answer && wfd != -1) {
+                    usleep((think_ms / 2 + rand_r(&rs) % (think_ms + 1)) * 1000);
+                    client_move(line, move, sizeof(move), &rs);
+                    (void)!write(wfd, move, strlen(move));
+                    atomic_fetch_add(&shared->turns, 1);
+                }
+            } else if (strcmp(line, "INVALID_MOVE") == 0) {
+                atomic_fetch_add(&shared->invalid, 1);
+            } else if (strcmp(line, "GAME_OVER") == 0) {
+                atomic_fetch_add(&shared->finished, 1);
+                client_exit(0);
+            } else if (strcmp(line, "KICKED") == 0 || strcmp(line, "LOBBY_CLOSED") == 0) {
+                client_exit(0);
+            }
+            line = nl + 1;
+        }
+        len -= line - buffer;
+        memmove(buffer, line, len);
+        if (len == sizeof(buffer)) len = 0;
+    }
+}
+
+static void client_spawn(int index, long long now) {
+    SoakSlot *slot = &shared->slots[index];
+
+    slot->fault = FAULT_NONE;
+    if (rand_r(&seed) % 1000 < fault_rate * 1000) slot->fault = 1 + rand_r(&seed) % (FAULT_KINDS - 1);
+    slot->fault_turn = 1 + rand_r(&seed) % 6;
+    atomic_store(&slot->struck_ns, 0);
+    kill_at[index] = slot->fault == FAULT_KILL ? now + rand_ms(500, SOAK_KILL_MS) : 0;
+    tracked_slot[index] = false;
+    slot_table[index] = -1;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        client_main(index);
+    }
+    slot->pid = pid > 0 ? pid : 0;
+    if (pid < 0) respawn_at[index] = now + rand_ms(1000, 2000);
+}
+
+// ---- server and what it leaves behind ----
+
+// Processes in a process group, and how many of them are zombies
+static int group_processes(pid_t pgid, int *zombies) {
+    DIR *dir = opendir("/proc");
+    struct dirent *e;
+    int count = 0;
+
+    *zombies = 0;
+    if (!dir) return 0;
+    while ((e = readdir(dir)) != NULL) {
+        char path[300], stat[512];
+        if (e->d_name[0] < '0' || e->d_name[0] > '9') continue;
+        snprintf(path, sizeof(path), "/proc/%s/stat", e->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd == -1) continue;
+        ssize_t n = read(fd, stat, sizeof(stat) - 1);
+        close(fd);
+        if (n <= 0) continue;
+        stat[n] = '\0';
+
+        // "pid (comm) state ppid pgrp ...", comm may hold anything
+        char *p = strrchr(stat, ')');
+        char state;
+        int ppid, pgrp;
+        if (!p || sscanf(p + 1, " %c %d %d", &state, &ppid, &pgrp) != 3 || pgrp != pgid) continue;
+        if (atoi(e->d_name) == pgid) continue;
+        count++;
+        if (state == 'Z') (*zombies)++;
+    }
+    closedir(dir);
+    return count;
+}
+
+// FIFOs in /tmp named after a client process that is gone
+static int stale_fifos(void) {
+    DIR *dir = opendir("/tmp");
+    struct dirent *e;
+    int count = 0;
+
+    if (!dir) return 0;
+    while ((e = readdir(dir)) != NULL) {
+        int pid;
+        if (sscanf(e->d_name, "client_%d", &pid) != 1 || pid <= 0) continue;
+        if (kill(pid, 0) == -1 && errno == ESRCH) count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+// Send one admin command, the reply (up to `size`) ends when the server hangs up
+static bool admin_query(const char *command, char *reply, size_t size) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    size_t len = 0;
+
+    if (fd == -1) return false;
+    strncpy(addr.sun_path, ADMIN_SOCKET, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return false;
+    }
+    dprintf(fd, "%s\nquit\n", command);
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    while (len < size - 1 && poll(&pfd, 1, 1000) > 0) {
+        ssize_t n = read(fd, reply + len, size - 1 - len);
+        if (n <= 0) break;
+        len += n;
+    }
+    reply[len] = '\0';
+    close(fd);
+    return true;
+}
+
+static void server_start(void) {
+    char log_path[300];
+    snprintf(log_path, sizeof(log_path), "%s/server.out", workdir);
+
+    server_pid = fork();
+    if (server_pid == 0) {
+        setpgid(0, 0);
+        int out = open(log_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (out != -1) {
+            dup2(out, STDOUT_FILENO);
+            dup2(out, STDERR_FILENO);
+            close(out);
+        }
+        if (chdir(workdir) == -1) _exit(127);
+        signal(SIGINT, SIG_DFL);
+        execv(server_args[0], server_args);
+        _exit(127);
+    }
+    setpgid(server_pid, server_pid);
+
+    // ready once the admin console answers
+    char reply[256];
+    for (int tries = 0; tries < 100; tries++) {
+        if (admin_query("stats", reply, sizeof(reply))) return;
+        usleep(50000);
+    }
+    fprintf(stderr, "soak: the server did not come up, see %s\n", log_path);
+}
+
+typedef struct {
+    int restarts;
+    int crashes;
+    int hung;                   // needed SIGKILL to stop
+    long long shutdown_max_ns;
+    int leaked_processes;       // still running once the server was gone
+} ServerStats;
+
+static ServerStats server_stats;
+
+// SIGINT mid-game, as Ctrl+C would; whatever the server leaves is counted and killed
+static void server_stop(void) {
+    long long start = now_ns();
+    int status;
+
+    kill(server_pid, SIGINT);
+    while (waitpid(server_pid, &status, WNOHANG) == 0) {
+        if (now_ns() - start > 20000000000LL) {
+            server_stats.hung++;
+            kill(server_pid, SIGKILL);
+            waitpid(server_pid, &status, 0);
+            break;
+        }
+        usleep(10000);
+    }
+    long long took = now_ns() - start;
+    if (took > server_stats.shutdown_max_ns) server_stats.shutdown_max_ns = took;
+
+    usleep(200000); // children that are on their way out
+    int zombies;
+    int left = group_processes(server_pid, &zombies);
+    if (left > 0) {
+        server_stats.leaked_processes += left;
+        fprintf(stderr, "soak: %d process(es) left running by the server\n", left);
+        kill(-server_pid, SIGKILL);
+    }
+    server_pid = 0;
+}
+
+// ---- fault tracking ----
+
+typedef struct {
+    int id;
+    unsigned long moves;
+    char to_play[64];
+    bool playing;
+} TableMoves;
+
+static int admin_tables(TableMoves *tables, int max) {
+    static char reply[SOAK_REPLY_LEN];
+    int count = 0;
+
+    if (!admin_query("list", reply, sizeof(reply))) return -1;
+    for (char *line = strtok(reply, "\n"); line && count < max; line = strtok(NULL, "\n")) {
+        TableMoves *t = &tables[count];
+        char *last = strrchr(line, ',');
+        if (sscanf(line, "table %d:", &t->id) != 1 || !last || sscanf(last, ", %lu moves", &t->moves) != 1) continue;
+        t->playing = strstr(line, ", playing,") != NULL;
+        char *name = strstr(line, " players, ");
+        t->to_play[0] = '\0';
+        if (name) sscanf(name, " players, %63s to play", t->to_play);
+        count++;
+    }
+    return count;
+}
+
+// Tables the live clients sit at, looked up with "show" for the ones not placed yet
+static void admin_seat_clients(TableMoves *tables, int count) {
+    static char reply[SOAK_REPLY_LEN];
+    bool unplaced = false;
+
+    for (int i = 0; i < num_clients; i++) unplaced |= shared->slots[i].pid > 0 && slot_table[i] < 0;
+    if (!unplaced) return;
+
+    for (int t = 0; t < count; t++) {
+        char command[32];
+        snprintf(command, sizeof(command), "show %d", tables[t].id);
+        if (!admin_query(command, reply, sizeof(reply))) continue;
+        for (char *p = strstr(reply, "(PID "); p; p = strstr(p + 1, "(PID ")) {
+            pid_t pid = atoi(p + 5);
+            for (int i = 0; i < num_clients; i++) {
+                if (shared->slots[i].pid == pid && slot_table[i] < 0) slot_table[i] = tables[t].id;
+            }
+        }
+    }
+}
+
+static void track_faults(Interval *iv, long long now) {
+    static long long next_seating = 0;
+    TableMoves tables[1024];
+    int count = admin_tables(tables, 1024);
+    if (count < 0) return;
+
+    bool struck = false;
+    for (int i = 0; i < num_clients; i++) struck |= atomic_load(&shared->slots[i].struck_ns) != 0 && !tracked_slot[i];
+    if (struck || now >= next_seating) {
+        admin_seat_clients(tables, count);
+        next_seating = now + SOAK_SEATING_MS * 1000000LL;
+    }
+
+    // faults that struck since the last look
+    for (int i = 0; i < num_clients; i++) {
+        SoakSlot *slot = &shared->slots[i];
+        long long struck_ns = atomic_load(&slot->struck_ns);
+        if (struck_ns == 0 || tracked_slot[i]) continue;
+        tracked_slot[i] = true;
+        iv->faults[slot->fault]++;
+
+        if (slot_table[i] < 0) {
+            iv->unplaced++;
+        } else if (tracked_len < SOAK_TRACKED) {
+            Tracked *f = &tracked[tracked_len++];
+            *f = (Tracked){ slot->fault, slot->pid, struck_ns, slot_table[i], 0, "" };
+            for (int t = 0; t < count; t++) {
+                if (tables[t].id != f->table) continue;
+                f->moves = tables[t].moves;
+                snprintf(f->to_play, sizeof(f->to_play), "%s", tables[t].to_play);
+            }
+        }
+    }
+
+    // a table that made a move, moved on to the next player or ended has recovered
+    for (int i = 0; i < tracked_len; i++) {
+        Tracked *f = &tracked[i];
+        bool recovered = true;
+        for (int t = 0; t < count; t++) {
+            if (tables[t].id != f->table) continue;
+            recovered = !tables[t].playing || tables[t].moves > f->moves || strcmp(tables[t].to_play, f->to_play) != 0;
+        }
+        if (!recovered && now - f->struck_ns < SOAK_STUCK_MS * 1000000LL) continue;
+
+        if (recovered) {
+            if (iv->latencies < SOAK_SAMPLES) iv->samples[iv->latencies++] = now - f->struck_ns;
+            if (now - f->struck_ns > iv->worst[f->kind]) iv->worst[f->kind] = now - f->struck_ns;
+        } else {
+            iv->stuck++;
+            fprintf(stderr, "soak: table %d stuck for %d s after a %s fault (PID %d)\n",
+                f->table, SOAK_STUCK_MS / 1000, fault_names[f->kind], f->pid);
+        }
+        tracked[i--] = tracked[--tracked_len];
+    }
+}
+
+// Client processes that ended: clean up after the ones a fault took down
+static void reap(Interval *iv, long long now) {
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (pid == server_pid) {
+            // a clean exit is the end of a game (a single-game -s server), not a crash
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                server_stats.crashes++;
+                fprintf(stderr, "soak: the server exited (status %d), starting it again\n", status);
+            }
+            server_pid = 0;
+            continue;
+        }
+        for (int i = 0; i < num_clients; i++) {
+            SoakSlot *slot = &shared->slots[i];
+            if (slot->pid != pid) continue;
+
+            // a killed client cannot unlink its FIFOs, the way the Readme says to
+            if (WIFSIGNALED(status)) {
+                char path[64];
+                snprintf(path, sizeof(path), "/tmp/client_%d", pid);
+                iv->cleaned += unlink(path) == 0;
+                snprintf(path, sizeof(path), "/tmp/client_%d_in", pid);
+                iv->cleaned += unlink(path) == 0;
+            }
+            slot->pid = 0;
+            respawn_at[i] = now + rand_ms(100, 1000);
+        }
+    }
+}
+
+static int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    double first_rate;          // turns/s of the first interval
+    double last_rate;
+    long turns;
+    long faults;
+    long long worst_ns;
+    int stuck;
+    int intervals;
+} Totals;
+
+static void report(Interval *iv, Totals *tot, long long now, long long started) {
+    double seconds = (now - iv->start_ns) / 1e9;
+    long turns = atomic_load(&shared->turns);
+    double rate = seconds > 0 ? (turns - iv->turns) / seconds : 0;
+    long faults = 0;
+    int zombies = 0;
+    int procs = server_pid > 0 ? group_processes(server_pid, &zombies) : 0;
+    long elapsed = (now - started) / 1000000000LL;
+
+    if (tot->intervals++ == 0) tot->first_rate = rate;
+    tot->last_rate = rate;
+    for (int k = 1; k < FAULT_KINDS; k++) faults += iv->faults[k];
+    tot->faults += faults;
+    tot->stuck += iv->stuck;
+
+    qsort(iv->samples, iv->latencies, sizeof(long long), compare_ll);
+    long long p50 = iv->latencies ? iv->samples[iv->latencies / 2] : 0;
+    long long p99 = iv->latencies ? iv->samples[iv->latencies * 99 / 100] : 0;
+    long long max = iv->latencies ? iv->samples[iv->latencies - 1] : 0;
+    if (max > tot->worst_ns) tot->worst_ns = max;
+
+    printf("[%ld:%02ld:%02ld] %.1f turns/s (%.0f%% of the first interval), %ld clients finished, %ld invalid moves\n",
+        elapsed / 3600, elapsed / 60 % 60, elapsed % 60, rate, tot->first_rate > 0 ? 100 * rate / tot->first_rate : 100.0,
+        atomic_load(&shared->finished), atomic_load(&shared->invalid));
+    printf("  faults: %ld (", faults);
+    for (int k = 1; k < FAULT_KINDS; k++) printf("%s%s %ld", k > 1 ? ", " : "", fault_names[k], iv->faults[k]);
+    printf("), %d not seen at a table\n", iv->unplaced);
+    printf("  recovery: p50 %.0f ms, p99 %.0f ms, max %.0f ms over %ld, %d stuck; slowest",
+        p50 / 1e6, p99 / 1e6, max / 1e6, iv->latencies, iv->stuck);
+    for (int k = 1; k < FAULT_KINDS; k++) printf("%s %s %.0f", k > 1 ? "," : "", fault_names[k], iv->worst[k] / 1e6);
+    printf(" ms\n");
+    printf("  server: %d process(es), %d zombie(s); fifos: %d removed after kills, %d stale\n",
+        procs, zombies, iv->cleaned, stale_fifos());
+    fflush(stdout);
+
+    memset(iv, 0, sizeof(*iv));
+    iv->start_ns = now;
+    iv->turns = turns;
+}
+
+int main(int argc, char *argv[]) {
+    double minutes = 10;
+    int interval_s = 60;
+    double restart_minutes = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:c:d:i:f:p:R:w:")) != -1) {
+        switch (opt) {
+        case 's': server_path = optarg; break;
+        case 'c': num_clients = atoi(optarg); break;
+        case 'd': minutes = atof(optarg); break;
+        case 'i': interval_s = atoi(optarg); break;
+        case 'f': fault_rate = atof(optarg); break;
+        case 'p': think_ms = atoi(optarg); break;
+        case 'R': restart_minutes = atof(optarg); break;
+        case 'w': snprintf(workdir, sizeof(workdir), "%s", optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-s server] [-c clients] [-d minutes] [-i report seconds] [-f fault rate]"
+                " [-p think ms] [-R restart minutes] [-w work dir] [-- server args]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_clients < 2) num_clients = 2;
+    if (num_clients > SOAK_MAX_CLIENTS) num_clients = SOAK_MAX_CLIENTS;
+    if (interval_s < 1) interval_s = 1;
+    if (think_ms < 0) think_ms = 0;
+
+    // the server binary by absolute path, it runs from the work directory
+    static char server_abs[4096];
+    if (!realpath(server_path, server_abs)) {
+        perror("soak: server binary");
+        return 1;
+    }
+    if (workdir[0] == '\0') snprintf(workdir, sizeof(workdir), "/tmp/ono_soak.%d", getpid());
+    mkdir(workdir, 0755);
+
+    int nargs = 0;
+    server_args[nargs++] = server_abs;
+    server_args[nargs++] = "-g";
+    server_args[nargs++] = "0";
+    server_args[nargs++] = "-r";    // keep seating tables; -- -r <n> overrides it
+    server_args[nargs++] = "1";
+    for (int i = optind; i < argc && nargs < SOAK_MAX_ARGS - 1; i++) server_args[nargs++] = argv[i];
+    server_args[nargs] = NULL;
+
+    shared = mmap(NULL, sizeof(SoakShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("soak: mmap");
+        return 1;
+    }
+    static Interval iv;
+    Totals tot = {0};
+
+    signal(SIGINT, on_sigint);
+    signal(SIGPIPE, SIG_IGN);
+    seed = (unsigned int)getpid();
+
+    printf("Soak: %d clients for %g minutes, fault rate %.2f, server in %s\n", num_clients, minutes, fault_rate, workdir);
+    fflush(stdout);
+    server_start();
+
+    long long started = now_ns();
+    long long end = started + (long long)(minutes * 60e9);
+    long long next_report = started + interval_s * 1000000000LL;
+    long long next_restart = restart_minutes > 0 ? started + (long long)(restart_minutes * 60e9) : 0;
+    iv.start_ns = started;
+
+    while (!stop) {
+        long long now = now_ns();
+        if (now >= end) break;
+
+        // faults are looked at before reaping, while the PIDs still name the clients
+        track_faults(&iv, now);
+        reap(&iv, now);
+        if (server_pid == 0) server_start();
+
+        for (int i = 0; i < num_clients; i++) {
+            SoakSlot *slot = &shared->slots[i];
+            if (slot->pid == 0 && now >= respawn_at[i]) client_spawn(i, now);
+            if (slot->pid > 0 && kill_at[i] && now >= kill_at[i]) {
+                atomic_store(&slot->struck_ns, now);
+                kill(slot->pid, SIGKILL);
+                kill_at[i] = 0;
+            }
+        }
+
+        if (next_restart && now >= next_restart) {
+            server_stats.restarts++;
+            server_stop();
+            server_start();
+            next_restart = now_ns() + (long long)(restart_minutes * 60e9);
+        }
+        if (now >= next_report) {
+            report(&iv, &tot, now, started);
+            next_report += interval_s * 1000000000LL;
+        }
+        usleep(SOAK_POLL_MS * 1000);
+    }
+
+    long long now = now_ns();
+    report(&iv, &tot, now, started);
+    server_stop();
+    for (int i = 0; i < num_clients; i++) {
+        if (shared->slots[i].pid > 0) kill(shared->slots[i].pid, SIGKILL);
+    }
+    for (int tries = 0; tries < 200; tries++) {
+        bool left = false;
+        reap(&iv, now);
+        for (int i = 0; i < num_clients; i++) left |= shared->slots[i].pid > 0;
+        if (!left) break;
+        usleep(10000);
+    }
+
+    printf("\nSoak summary: %.1f minutes, %ld turns, %ld faults, worst recovery %.0f ms, %d stuck table(s)\n",
+        (now - started) / 60e9, atomic_load(&shared->turns), tot.faults, tot.worst_ns / 1e6, tot.stuck);
+    printf("throughput: %.1f turns/s in the first interval, %.1f in the last (%.0f%%)\n",
+        tot.first_rate, tot.last_rate, tot.first_rate > 0 ? 100 * tot.last_rate / tot.first_rate : 100.0);
+    printf("server: %d restart(s), slowest shutdown %.0f ms, %d crash(es), %d hung, %d process(es) left behind\n",
+        server_stats.restarts, server_stats.shutdown_max_ns / 1e6, server_stats.crashes, server_stats.hung,
+        server_stats.leaked_processes);
+    printf("fifos: %d stale in /tmp\n", stale_fifos());
+
+    bool failed = tot.stuck > 0 || server_stats.crashes > 0 || server_stats.hung > 0 || server_stats.leaked_processes > 0;
+    return failed ? 2 : 0;
+}
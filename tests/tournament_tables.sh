@@ -0,0 +1,37 @@
+#!/bin/sh
+# Odd rosters at tables of two: every table must seat at least two players,
+# and a knockout must still end with exactly one champion.
+# Run from the top of the tree after `make tournament` (or with `make check`).
+
+roster=$(mktemp)
+trap 'rm -f "$roster"' EXIT
+status=0
+
+for players in 3 5 7 9; do
+    : > "$roster"
+    for i in $(seq 1 "$players"); do echo "p$i random" >> "$roster"; done
+
+    for format in roundrobin knockout; do
+        for seed in 1 2 3; do
+            out=$(./tournament -f "$format" -t 2 -s "$seed" -r 3 -w 2 "$roster") || {
+                echo "FAIL: $players players, $format, seed $seed: tournament exited $?"
+                status=1
+                continue
+            }
+            # "round R table T: winner W after N turns (a 3, b 0)" lists one score per seat
+            lone=$(echo "$out" | grep '^  round .* table ' | grep -v ', ')
+            if [ -n "$lone" ]; then
+                echo "FAIL: $players players, $format, seed $seed: table of one"
+                echo "$lone"
+                status=1
+            fi
+            if [ "$format" = knockout ] && [ "$(echo "$out" | grep -c '^Champion: ')" -ne 1 ]; then
+                echo "FAIL: $players players, knockout, seed $seed: not exactly one champion"
+                status=1
+            fi
+        done
+    done
+done
+
+[ $status -eq 0 ] && echo "tournament tables: ok"
+exit $status
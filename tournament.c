@@ -0,0 +1,433 @@
+// Tournament driver: plays a roster of bots through round-robin or
+// knockout brackets. Every table of a round is a task on a work-stealing
+// pool, so a round takes as long as its slowest game.
+//
+// Roster file: one player per line, "<name> [first|random|greedy|solver]".
+//
+//   ./tournament -f knockout -t 4 -w 8 roster.txt
+
+#define ONO_NO_MAIN
+#include "server.c"
+
+#define MAX_ROSTER 4096
+#define TASK_DEQUE_SIZE 4096
+#define MAX_WORKERS 64
+#define MAX_GAME_TURNS 2000
+
+typedef struct {
+    char name[NAME_SIZE];
+    BotStrategy strategy;
+    int alive;              // still in the knockout bracket
+    int games, wins;
+    long penalty;           // sum of player_score() over all games
+} Entrant;
+
+typedef struct {
+    int seats[MAX_PLAYERS]; // roster indexes
+    int num_seats;
+    unsigned int seed;
+    int winner;             // roster index, filled in by the worker
+    int scores[MAX_PLAYERS];
+    int turns;
+    double elapsed_ms;
+} GameTask;
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, thieves take from the top
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(GameTask *) tasks[TASK_DEQUE_SIZE];
+} TaskDeque;
+
+typedef struct {
+    int id;
+    pthread_t tid;
+    TaskDeque deque;
+    unsigned int seed;
+    unsigned long played, stolen;
+} Worker;
+
+Entrant roster[MAX_ROSTER];
+int roster_size = 0;
+
+Worker workers[MAX_WORKERS];
+int num_workers = 1;
+
+// the round currently being played
+GameTask *round_tasks;
+int round_task_count;
+atomic_int round_done;
+pthread_barrier_t round_start, round_end;
+volatile int pool_running = 1;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+void deque_push(TaskDeque *d, GameTask *task) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    atomic_store_explicit(&d->tasks[b % TASK_DEQUE_SIZE], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+}
+
+GameTask *deque_pop(TaskDeque *d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    GameTask *task = atomic_load_explicit(&d->tasks[b % TASK_DEQUE_SIZE], memory_order_relaxed);
+    if (t == b) {
+        // last task, race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            task = NULL;
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+GameTask *deque_steal(TaskDeque *d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b) return NULL;
+
+    GameTask *task = atomic_load_explicit(&d->tasks[t % TASK_DEQUE_SIZE], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return task;
+}
+
+// Play one table to the end with the normal rules, bots on every seat
+void play_game(GameTask *task, GameState *game, EndgameSolver *solver) {
+    double start = now_ms();
+
+    memset(game, 0, sizeof(*game));
+    game->quiet = 1;
+    game->num_players = task->num_seats;
+    game->deck.seed = task->seed;
+    unsigned int bot_seed = task->seed * 2654435761u;
+
+    for (int i = 0; i < task->num_seats; i++) {
+        Entrant *e = &roster[task->seats[i]];
+        strncpy(game->players[i].player_name, e->name, NAME_SIZE - 1);
+        game->players[i].pid = task->seats[i] + 1; // roster index stands in for the pid
+    }
+    game_deal(game, deck_count(game->num_players));
+
+    int turns = 0;
+    while (!game->game_over && turns < MAX_GAME_TURNS) {
+        int player = game->current_player;
+        BotStrategy strategy = roster[task->seats[player]].strategy;
+
+        if (strategy == BOT_SOLVER) bot_solver_move(solver, game, player, &bot_seed, game->stored_move, sizeof(game->stored_move));
+        else bot_choose_move(game, player, strategy, &bot_seed, game->stored_move, sizeof(game->stored_move));
+        game_apply_move(game, player);
+        turns++;
+    }
+
+    // a game that hits the turn cap goes to the lowest penalty score
+    int best = 0;
+    for (int i = 0; i < task->num_seats; i++) {
+        task->scores[i] = player_score(&game->players[i]);
+        if (task->scores[i] < task->scores[best]) best = i;
+    }
+
+    task->winner = game->winner_pid > 0 ? game->winner_pid - 1 : task->seats[best];
+    task->turns = turns;
+    task->elapsed_ms = now_ms() - start;
+    game_free(game);
+}
+
+void *worker_thread_func(void *arg) {
+    Worker *w = (Worker *)arg;
+    GameState *game = malloc(sizeof(GameState));
+    EndgameSolver *solver = endgame_solver_new(); // for solver bots, NULL leaves them greedy
+
+    while (1) {
+        pthread_barrier_wait(&round_start);
+        if (!pool_running) break;
+
+        // deal this worker's share into its own deque
+        for (int i = w->id; i < round_task_count; i += num_workers) {
+            deque_push(&w->deque, &round_tasks[i]);
+        }
+        pthread_barrier_wait(&round_start);
+
+        while (atomic_load(&round_done) < round_task_count) {
+            GameTask *task = deque_pop(&w->deque);
+
+            if (task == NULL && num_workers > 1) {
+                int victim = rand_r(&w->seed) % num_workers;
+                if (victim != w->id) {
+                    task = deque_steal(&workers[victim].deque);
+                    if (task) w->stolen++;
+                }
+            }
+
+            if (task == NULL) {
+                sched_yield();
+                continue;
+            }
+
+            play_game(task, game, solver);
+            w->played++;
+            atomic_fetch_add(&round_done, 1);
+        }
+        pthread_barrier_wait(&round_end);
+    }
+
+    endgame_solver_free(solver);
+    free(game);
+    return NULL;
+}
+
+// Runs every task of the round on the pool and waits for the slowest one
+void run_round(GameTask *tasks, int count) {
+    round_tasks = tasks;
+    round_task_count = count;
+    atomic_store(&round_done, 0);
+
+    pthread_barrier_wait(&round_start); // workers fill their deques
+    pthread_barrier_wait(&round_start); // everyone starts playing and stealing
+    pthread_barrier_wait(&round_end);
+}
+
+void record_results(GameTask *tasks, int count, int round, bool knockout) {
+    for (int g = 0; g < count; g++) {
+        GameTask *task = &tasks[g];
+
+        for (int i = 0; i < task->num_seats; i++) {
+            Entrant *e = &roster[task->seats[i]];
+            e->games++;
+            e->penalty += task->scores[i];
+            if (task->seats[i] == task->winner) {
+                e->wins++;
+            } else if (knockout) {
+                e->alive = 0;
+            }
+        }
+
+        printf("  round %d table %d: winner %s after %d turns (", round, g + 1, roster[task->winner].name, task->turns);
+        for (int i = 0; i < task->num_seats; i++) {
+            printf("%s%s %d", i ? ", " : "", roster[task->seats[i]].name, task->scores[i]);
+        }
+        printf(")\n");
+    }
+}
+
+static void shuffle_ints(int *a, int n, unsigned int *seed) {
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand_r(seed) % (i + 1);
+        int tmp = a[i];
+        a[i] = a[j];
+        a[j] = tmp;
+    }
+}
+
+// Split `ids` into tables of at most table_size (three with tables of two and an
+// odd count), never leaving a table of one
+int make_tables(int *ids, int n, int table_size, GameTask *tasks, unsigned int seed, int round) {
+    int count = 0;
+    int pos = 0;
+
+    while (n - pos >= 2) {
+        int left = n - pos;
+        int size = left < table_size ? left : table_size;
+        // never leave one player over: take one fewer so two are left for the
+        // last table, or with tables of two seat the odd one out as a third
+        if (left - size == 1) size += size > 2 ? -1 : 1;
+
+        GameTask *task = &tasks[count];
+        memset(task, 0, sizeof(*task));
+        task->num_seats = size;
+        task->seed = seed ^ (unsigned int)(round * 7919 + count * 104729 + 1);
+        for (int i = 0; i < size; i++) task->seats[i] = ids[pos + i];
+
+        pos += size;
+        count++;
+    }
+    return count;
+}
+
+void print_round_time(int round, int tables, GameTask *tasks, double wall_ms) {
+    double sum = 0, slowest = 0;
+    for (int g = 0; g < tables; g++) {
+        sum += tasks[g].elapsed_ms;
+        if (tasks[g].elapsed_ms > slowest) slowest = tasks[g].elapsed_ms;
+    }
+    printf("Round %d: %d tables in %.2f ms (slowest game %.2f ms, all games back to back %.2f ms)\n\n",
+        round, tables, wall_ms, slowest, sum);
+}
+
+int load_roster(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror("Failed to open roster");
+        return -1;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp) && roster_size < MAX_ROSTER) {
+        char name[NAME_SIZE];
+        char strategy[16] = "first";
+
+        if (line[0] == '#' || sscanf(line, "%49s %15s", name, strategy) < 1) continue;
+
+        Entrant *e = &roster[roster_size++];
+        memset(e, 0, sizeof(*e));
+        snprintf(e->name, NAME_SIZE, "%s", name);
+        e->strategy = bot_strategy_from_name(strategy);
+        e->alive = 1;
+    }
+    fclose(fp);
+    return roster_size;
+}
+
+static int compare_standings(const void *a, const void *b) {
+    const Entrant *x = &roster[*(const int *)a];
+    const Entrant *y = &roster[*(const int *)b];
+
+    if (x->wins != y->wins) return y->wins - x->wins;
+    // fewer penalty points per game breaks ties
+    double px = x->games ? (double)x->penalty / x->games : 0;
+    double py = y->games ? (double)y->penalty / y->games : 0;
+    return (px > py) - (px < py);
+}
+
+int main(int argc, char *argv[]) {
+    bool knockout = false;
+    int table_size = 4;
+    int rounds = 0;
+    unsigned int seed = (unsigned int)time(NULL);
+    int opt;
+
+    num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "f:t:w:r:s:")) != -1) {
+        switch (opt) {
+        case 'f':
+            knockout = strcmp(optarg, "knockout") == 0;
+            break;
+        case 't':
+            table_size = atoi(optarg);
+            break;
+        case 'w':
+            num_workers = atoi(optarg);
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 's':
+            seed = (unsigned int)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-f roundrobin|knockout] [-t table size] [-w workers] [-r rounds] [-s seed] roster.txt\n", argv[0]);
+        return 1;
+    }
+    if (table_size < 2 || table_size > MAX_PLAYERS) {
+        fprintf(stderr, "Table size must be between 2 and %d.\n", MAX_PLAYERS);
+        return 1;
+    }
+    if (num_workers < 1) num_workers = 1;
+    if (num_workers > MAX_WORKERS) num_workers = MAX_WORKERS;
+
+    if (load_roster(argv[optind]) < 2) {
+        fprintf(stderr, "The roster needs at least 2 players.\n");
+        return 1;
+    }
+
+    // round robin default: enough rounds for everyone to meet everyone at two-player tables
+    if (rounds <= 0) rounds = roster_size - 1;
+
+    pthread_barrier_init(&round_start, NULL, num_workers + 1);
+    pthread_barrier_init(&round_end, NULL, num_workers + 1);
+    for (int i = 0; i < num_workers; i++) {
+        workers[i].id = i;
+        workers[i].seed = seed + i;
+        pthread_create(&workers[i].tid, NULL, worker_thread_func, &workers[i]);
+    }
+
+    printf("%s tournament: %d players, tables of %d, %d workers, seed %u\n\n",
+        knockout ? "Knockout" : "Round-robin", roster_size, table_size, num_workers, seed);
+
+    static int ids[MAX_ROSTER];
+    static GameTask tasks[MAX_ROSTER / 2 + 1];
+    double started = now_ms();
+    int round = 0;
+
+    while (1) {
+        int n = 0;
+        for (int i = 0; i < roster_size; i++) {
+            if (roster[i].alive) ids[n++] = i;
+        }
+
+        if (knockout ? n < 2 : round >= rounds) break;
+        round++;
+
+        if (!knockout && table_size == 2 && n % 2 == 0) {
+            // circle method: the first player stays put, the rest rotate one seat per
+            // round, so n - 1 rounds pair everyone with everyone exactly once
+            int circle[MAX_ROSTER];
+            circle[0] = ids[0];
+            for (int i = 1; i < n; i++) circle[i] = ids[1 + (i - 1 + round - 1) % (n - 1)];
+            for (int i = 0; i < n / 2; i++) {
+                ids[2 * i] = circle[i];
+                ids[2 * i + 1] = circle[n - 1 - i];
+            }
+        } else {
+            unsigned int shuffle_seed = seed ^ (unsigned int)round;
+            shuffle_ints(ids, n, &shuffle_seed);
+        }
+
+        int tables = make_tables(ids, n, table_size, tasks, seed, round);
+        double round_start_ms = now_ms();
+        run_round(tasks, tables);
+        double wall = now_ms() - round_start_ms;
+
+        record_results(tasks, tables, round, knockout);
+        print_round_time(round, tables, tasks, wall);
+    }
+
+    pool_running = 0;
+    pthread_barrier_wait(&round_start);
+    for (int i = 0; i < num_workers; i++) pthread_join(workers[i].tid, NULL);
+
+    int order[MAX_ROSTER];
+    for (int i = 0; i < roster_size; i++) order[i] = i;
+    qsort(order, roster_size, sizeof(int), compare_standings);
+
+    if (knockout) {
+        for (int i = 0; i < roster_size; i++) {
+            if (roster[i].alive) printf("Champion: %s (%s)\n\n", roster[i].name, bot_strategy_name(roster[i].strategy));
+        }
+    }
+
+    printf("Standings after %d rounds (%.1f ms):\n", round, now_ms() - started);
+    for (int i = 0; i < roster_size; i++) {
+        Entrant *e = &roster[order[i]];
+        printf("%3d. %-20s %-7s %3d wins / %3d games, %.1f penalty points per game\n", i + 1, e->name,
+            bot_strategy_name(e->strategy), e->wins, e->games, e->games ? (double)e->penalty / e->games : 0.0);
+    }
+
+    printf("\nWorkers:\n");
+    for (int i = 0; i < num_workers; i++) {
+        printf(" - worker %d: %lu games, %lu stolen\n", i, workers[i].played, workers[i].stolen);
+    }
+    return 0;
+}